@@ -5,9 +5,14 @@ echo "Building predict_app..."
 
 clang++ -std=c++20 \
     src/main.cpp \
+    src/async_http.cpp \
     src/market_data.cpp \
     src/analysis.cpp \
+    src/indicator_state.cpp \
+    src/simd_kernels.cpp \
+    src/thread_pool.cpp \
     src/ollama_client.cpp \
+    src/response_cache.cpp \
     -o predict_app \
     -I src \
     -lcurl
@@ -5,12 +5,23 @@ echo "🔨 Building Trading Analysis Server..."
 
 g++ -std=c++20 \
     src/server.cpp \
+    src/async_http.cpp \
     src/market_data.cpp \
+    src/candle_store.cpp \
+    src/resample.cpp \
     src/analysis.cpp \
+    src/indicator_state.cpp \
+    src/simd_kernels.cpp \
+    src/thread_pool.cpp \
+    src/ml_worker_pool.cpp \
     src/ollama_client.cpp \
+    src/response_cache.cpp \
     src/analysis_storage.cpp \
+    src/record_codec.cpp \
+    src/similarity_index.cpp \
     src/news_fetcher.cpp \
     src/settings_storage.cpp \
+    src/job_queue.cpp \
     -o predict_server \
     -I src \
     -lcurl \
@@ -177,18 +177,21 @@ function switchView(viewId) {
 // Dashboard Logic
 async function loadDashboardStats() {
     try {
-        const response = await fetch('/api/recent-analyses');
-        if (!response.ok) throw new Error('API Error');
-        const analyses = await response.json();
-
-        // 1. Total Analyses
-        totalAnalysesEl.textContent = analyses.length;
+        const [response, statsResponse] = await Promise.all([
+            fetch('/api/recent-analyses?fields=summary'),
+            fetch('/api/stats')
+        ]);
+        if (!response.ok || !statsResponse.ok) throw new Error('API Error');
+        const { analyses, version } = await response.json();
+        const stats = await statsResponse.json();
+        watchAnalysisChanges(version, false);
+
+        // 1. Total Analyses (whole history, from the server-side counters)
+        totalAnalysesEl.textContent = stats.total.analyses;
 
         // 2. Win Rate & Total R
+        winRateEl.textContent = `${(stats.total.win_rate * 100).toFixed(0)}%`;
         const feedbacks = analyses.filter(a => a.feedback && a.feedback.submitted);
-        const wins = feedbacks.filter(a => a.feedback.success).length;
-        const winPct = feedbacks.length > 0 ? (wins / feedbacks.length * 100).toFixed(0) : 0;
-        winRateEl.textContent = `${winPct}%`;
 
         // 3. Veto Rate
         const vetoes = analyses.filter(a => a.ai_prediction && a.ai_prediction.decision === 'veto').length;
@@ -258,7 +261,8 @@ function initChart() {
     });
 }
 
-// Analysis API
+// Analysis API: runs as a job whose stages arrive as Server-Sent Events, so
+// levels and chart show while the AI is still writing its verdict
 async function startAnalysis() {
     const ticker = tickerInput.value.trim().toUpperCase();
     const model = modelSelect.value;
@@ -266,27 +270,48 @@ async function startAnalysis() {
 
     loadingOverlay.style.display = 'flex';
     resultsSection.style.display = 'none';
+    predictionEl.textContent = 'KI analysiert...';
 
     try {
-        const res = await fetch('/api/analyze', {
+        const res = await fetch('/api/jobs', {
             method: 'POST',
             headers: { 'Content-Type': 'application/json' },
             body: JSON.stringify({ ticker, model }),
         });
-
         if (!res.ok) throw new Error(await res.text());
-        const data = await res.json();
-
-        // Update UI
-        entryPriceEl.textContent = `$${data.trading_levels.entry.toFixed(2)}`;
-        takeProfitEl.textContent = `$${data.trading_levels.take_profit.toFixed(2)}`;
-        stopLossEl.textContent = `$${data.trading_levels.stop_loss.toFixed(2)}`;
-        rsiDisplayEl.textContent = `${data.indicators.rsi.toFixed(1)} / ${data.indicators.htf_rsi.toFixed(1)}`;
-
-        // AI Verdict
-        const verdict = typeof data.ai_prediction === 'string' ? data.ai_prediction : data.ai_prediction.reason;
-        predictionEl.textContent = verdict || 'Keine Angabe';
+        const { job_id } = await res.json();
+
+        const state = { sentiment: null, aiText: '' };
+        await new Promise((resolve, reject) => {
+            const events = new EventSource(`/api/jobs/${job_id}/events`);
+            ['market_data', 'indicators', 'context', 'ai_token', 'ai'].forEach(stage => {
+                events.addEventListener(stage, e => renderAnalysisStage(ticker, stage, JSON.parse(e.data), state));
+            });
+            events.addEventListener('result', () => {
+                events.close();
+                resolve();
+            });
+            events.addEventListener('failed', e => {
+                events.close();
+                reject(new Error(JSON.parse(e.data).error));
+            });
+            // Dropped connections reconnect by themselves (resuming after
+            // the last event); only give up once the browser does
+            events.onerror = () => {
+                if (events.readyState === EventSource.CLOSED) reject(new Error('Verbindung verloren'));
+            };
+        });
+    } catch (e) {
+        alert('Analyse fehlgeschlagen: ' + e.message);
+    } finally {
+        loadingOverlay.style.display = 'none';
+    }
+}
 
+// Renders one stage of an analysis job; `state` carries the sentiment from
+// the news stage to the AI stage and the AI text streamed so far
+function renderAnalysisStage(ticker, stage, data, state) {
+    if (stage === 'market_data') {
         // Chart
         initChart();
         const candles = data.candles.map(c => ({
@@ -295,22 +320,32 @@ async function startAnalysis() {
         }));
         candlestickSeries.setData(candles);
         chart.timeScale().fitContent();
-
-        // News & Sentiment
-        const newsData = data.news || [];
-        const sentimentData = generateMockSentiment(ticker, newsData);
-        renderNews(newsData);
-        renderSentiment(sentimentData);
-        renderSentimentContext(sentimentData, data.ai_prediction);
+    } else if (stage === 'indicators') {
+        entryPriceEl.textContent = `$${data.trading_levels.entry.toFixed(2)}`;
+        takeProfitEl.textContent = `$${data.trading_levels.take_profit.toFixed(2)}`;
+        stopLossEl.textContent = `$${data.trading_levels.stop_loss.toFixed(2)}`;
+        rsiDisplayEl.textContent = `${data.indicators.rsi.toFixed(1)} / ${data.indicators.htf_rsi.toFixed(1)}`;
 
         // Risk Management Display
         renderRiskManagement(data.risk_management, data.trading_levels);
 
+        // Enough to show; the AI verdict follows
         resultsSection.style.display = 'block';
-    } catch (e) {
-        alert('Analyse fehlgeschlagen: ' + e.message);
-    } finally {
         loadingOverlay.style.display = 'none';
+    } else if (stage === 'context') {
+        // News & Sentiment
+        const newsData = data.news || [];
+        state.sentiment = generateMockSentiment(ticker, newsData);
+        renderNews(newsData);
+        renderSentiment(state.sentiment);
+    } else if (stage === 'ai_token') {
+        state.aiText += data.text;
+        predictionEl.textContent = state.aiText;
+    } else if (stage === 'ai') {
+        // AI Verdict
+        const verdict = typeof data.ai_prediction === 'string' ? data.ai_prediction : data.ai_prediction.reason;
+        predictionEl.textContent = verdict || 'Keine Angabe';
+        renderSentimentContext(state.sentiment, data.ai_prediction);
     }
 }
 
@@ -542,7 +577,44 @@ function initQuickSymbols() {
 }
 
 // History & Feedback
-async function loadRecentAnalyses() {
+const HISTORY_PAGE_SIZE = 20;
+
+function renderHistoryCard(a) {
+    const card = document.createElement('div');
+    card.className = 'activity-item';
+    card.dataset.id = a.id;
+    card.style.flexDirection = 'column';
+    card.style.alignItems = 'stretch';
+    card.style.gap = '1rem';
+
+    card.innerHTML = `
+        <div style="display:flex; justify-content:space-between; align-items:center;">
+            <div style="font-weight:700; font-size:1.1rem;">${a.ticker}</div>
+            <div style="font-size:0.8rem; color:var(--text-dim);">${a.timestamp}</div>
+        </div>
+        <div style="display:grid; grid-template-columns: repeat(3, 1fr); gap: 0.5rem;">
+            <div class="mini-status">E: ${a.trading_levels.entry.toFixed(1)}</div>
+            <div class="mini-status" style="color:var(--success);">T: ${a.trading_levels.take_profit.toFixed(1)}</div>
+            <div class="mini-status" style="color:var(--danger);">S: ${a.trading_levels.stop_loss.toFixed(1)}</div>
+        </div>
+        <div style="display:flex; justify-content:space-between; align-items:center; border-top: 1px solid var(--border-glass); padding-top: 0.75rem;">
+            ${a.feedback?.submitted ?
+            `<span style="color:var(--${a.feedback.success ? 'success' : 'danger'}); font-weight:600;">
+                    <i class="fa-solid fa-${a.feedback.success ? 'check' : 'xmark'}"></i> ${a.feedback.success ? 'Gewonnen' : 'Verloren'}
+                </span>` :
+            `<div style="display:flex; gap:0.5rem;">
+                    <button class="btn-micro success" onclick="submitFeedback('${a.id}', true)">Win</button>
+                    <button class="btn-micro danger" onclick="submitFeedback('${a.id}', false)">Loss</button>
+                </div>`
+        }
+            <button class="btn-delete" onclick="deleteAnalysis('${a.id}')">Löschen</button>
+        </div>
+    `;
+    return card;
+}
+
+// Loads the first page, or with a cursor appends the next one
+async function loadRecentAnalyses(cursor = null) {
     const list = document.getElementById('recentList');
     // Minimal indicator to avoid heavy flickering
     if (list.innerHTML === '') {
@@ -550,48 +622,89 @@ async function loadRecentAnalyses() {
     }
 
     try {
-        const res = await fetch('/api/recent-analyses');
-        const data = await res.json();
+        const params = new URLSearchParams({ fields: 'summary', limit: HISTORY_PAGE_SIZE });
+        if (cursor) params.set('cursor', cursor);
+        const res = await fetch(`/api/recent-analyses?${params}`);
+        const { analyses, next_cursor, version } = await res.json();
 
         // Use a document fragment or build string to minimize DOM ops
         const fragment = document.createDocumentFragment();
-        data.forEach(a => {
-            const card = document.createElement('div');
-            card.className = 'activity-item';
-            card.style.flexDirection = 'column';
-            card.style.alignItems = 'stretch';
-            card.style.gap = '1rem';
-
-            card.innerHTML = `
-                <div style="display:flex; justify-content:space-between; align-items:center;">
-                    <div style="font-weight:700; font-size:1.1rem;">${a.ticker}</div>
-                    <div style="font-size:0.8rem; color:var(--text-dim);">${a.timestamp}</div>
-                </div>
-                <div style="display:grid; grid-template-columns: repeat(3, 1fr); gap: 0.5rem;">
-                    <div class="mini-status">E: ${a.trading_levels.entry.toFixed(1)}</div>
-                    <div class="mini-status" style="color:var(--success);">T: ${a.trading_levels.take_profit.toFixed(1)}</div>
-                    <div class="mini-status" style="color:var(--danger);">S: ${a.trading_levels.stop_loss.toFixed(1)}</div>
-                </div>
-                <div style="display:flex; justify-content:space-between; align-items:center; border-top: 1px solid var(--border-glass); padding-top: 0.75rem;">
-                    ${a.feedback?.submitted ?
-                    `<span style="color:var(--${a.feedback.success ? 'success' : 'danger'}); font-weight:600;">
-                            <i class="fa-solid fa-${a.feedback.success ? 'check' : 'xmark'}"></i> ${a.feedback.success ? 'Gewonnen' : 'Verloren'}
-                        </span>` :
-                    `<div style="display:flex; gap:0.5rem;">
-                            <button class="btn-micro success" onclick="submitFeedback('${a.id}', true)">Win</button>
-                            <button class="btn-micro danger" onclick="submitFeedback('${a.id}', false)">Loss</button>
-                        </div>`
-                }
-                    <button class="btn-delete" onclick="deleteAnalysis('${a.id}')">Löschen</button>
-                </div>
-            `;
-            fragment.appendChild(card);
-        });
+        analyses.forEach(a => fragment.appendChild(renderHistoryCard(a)));
+
+        if (next_cursor) {
+            const more = document.createElement('button');
+            more.className = 'btn-micro';
+            more.textContent = 'Mehr laden';
+            more.onclick = () => {
+                more.remove();
+                loadRecentAnalyses(next_cursor);
+            };
+            fragment.appendChild(more);
+        }
 
-        list.innerHTML = '';
+        if (!cursor) {
+            list.innerHTML = '';
+            watchAnalysisChanges(version);
+        }
         list.appendChild(fragment);
     } catch (e) {
-        list.innerHTML = 'Fehler beim Laden';
+        if (!cursor) list.innerHTML = 'Fehler beim Laden';
+    }
+}
+
+// Long-polls the change feed and patches the rendered history in place;
+// the dashboard stats are refetched once per batch of changes
+let changeVersion = null;
+let watchingChanges = false;
+
+function applyAnalysisChange(change) {
+    const list = document.getElementById('recentList');
+    const card = list.querySelector(`[data-id="${change.id}"]`);
+    if (change.type === 'delete') {
+        if (card) card.remove();
+    } else if (change.type === 'feedback') {
+        if (card) card.replaceWith(renderHistoryCard(change.analysis));
+    } else if (change.type === 'insert' && !card && list.querySelector('.activity-item')) {
+        list.prepend(renderHistoryCard(change.analysis));
+    }
+}
+
+// `version` is the version of freshly rendered history; other callers
+// (restart = false) only make sure the watcher runs. Changes are applied
+// idempotently, so replaying a few over newer content is harmless.
+async function watchAnalysisChanges(version, restart = true) {
+    if (restart || changeVersion === null) changeVersion = version;
+    if (watchingChanges) return;
+    watchingChanges = true;
+
+    while (true) {
+        try {
+            const since = changeVersion;
+            const params = new URLSearchParams({ since, wait: 25, fields: 'summary' });
+            const res = await fetch(`/api/analyses/changes?${params}`);
+            if (!res.ok) throw new Error('API Error');
+            const feed = await res.json();
+
+            if (feed.reset) {
+                watchingChanges = false;
+                changeVersion = null;
+                loadRecentAnalyses();
+                loadDashboardStats();
+                return;
+            }
+            // A history reload while waiting set its own starting point
+            if (changeVersion === since) changeVersion = feed.version;
+            if (feed.changes.length > 0) {
+                feed.changes.forEach(applyAnalysisChange);
+                loadDashboardStats();
+            }
+            // The server had no room for another waiting poll
+            if (feed.retry_after) {
+                await new Promise(resolve => setTimeout(resolve, feed.retry_after * 1000));
+            }
+        } catch (e) {
+            await new Promise(resolve => setTimeout(resolve, 5000));
+        }
     }
 }
 
@@ -601,8 +714,7 @@ window.submitFeedback = async (id, success) => {
         headers: { 'Content-Type': 'application/json' },
         body: JSON.stringify({ analysis_id: id, success, remark: '' })
     });
-    loadRecentAnalyses();
-    loadDashboardStats();
+    // The change feed updates the card and the stats
 };
 
 window.deleteAnalysis = async (id) => {
@@ -614,11 +726,8 @@ window.deleteAnalysis = async (id) => {
 
     if (confirmed) {
         try {
-            const res = await fetch(`/api/analysis/${id}`, { method: 'DELETE' });
-            if (res.ok) {
-                loadRecentAnalyses();
-                loadDashboardStats();
-            }
+            // The change feed removes the card and updates the stats
+            await fetch(`/api/analysis/${id}`, { method: 'DELETE' });
         } catch (e) {
             console.error('Löschen fehlgeschlagen', e);
         }
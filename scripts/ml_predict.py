@@ -1,3 +1,6 @@
+# Reference implementation of the regime / directional models.
+# The server runs the native port (MLModel in src/analysis.cpp); this script
+# is kept as the oracle for src/test_ml_parity.cpp and for research.
 import sys
 import json
 import numpy as np
@@ -112,20 +115,41 @@ def predict_direction(features, regime_info):
         "confidence": round(regime_info["confidence"], 2)
     }
 
+def predict(features):
+    regime_result = classify_regime(features)
+    dir_result = predict_direction(features, regime_result)
+    return {
+        "regime_model": regime_result,
+        "directional_model": dir_result
+    }
+
+def serve():
+    """
+    Persistent worker mode (used by MLWorkerPool in the C++ server).
+    Reads one request per line: {"id": n, "batch": [features, ...]}
+    Writes one response per line: {"id": n, "results": [output, ...]}
+    """
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            request = json.loads(line)
+            results = [predict(f) for f in request.get("batch", [])]
+            response = {"id": request.get("id"), "results": results}
+        except Exception as e:
+            response = {"error": str(e)}
+        sys.stdout.write(json.dumps(response) + "\n")
+        sys.stdout.flush()
+
 def main():
+    if "--serve" in sys.argv:
+        serve()
+        return
     try:
         input_data = json.load(sys.stdin)
         features = input_data.get("features", {})
-        
-        regime_result = classify_regime(features)
-        dir_result = predict_direction(features, regime_result)
-        
-        output = {
-            "regime_model": regime_result,
-            "directional_model": dir_result
-        }
-        
-        print(json.dumps(output))
+        print(json.dumps(predict(features)))
     except Exception as e:
         print(json.dumps({"error": str(e)}))
 
@@ -1,10 +1,17 @@
 #include "analysis.hpp"
+#include "indicator_state.hpp"
 #include "nlohmann/json.hpp"
+#include "simd_kernels.hpp"
+#include "thread_pool.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iomanip>
-#include <numeric>
+#include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 // Helper functions
 template <typename T> T clamp(T v, T lo, T hi) {
@@ -14,8 +21,7 @@ template <typename T> T clamp(T v, T lo, T hi) {
 double calculate_sma(const std::vector<double> &prices, int period) {
   if (prices.size() < period)
     return 0.0;
-  double sum = std::accumulate(prices.end() - period, prices.end(), 0.0);
-  return sum / period;
+  return simd::sum(prices.data() + prices.size() - period, period) / period;
 }
 
 double calculate_ema(double current_price, double prev_ema, int period) {
@@ -57,32 +63,34 @@ double calculate_roc(const std::vector<double> &prices, int period) {
 }
 
 // Helper for OBV
-double calculate_obv(const std::vector<Candle> &candles) {
+double calculate_obv(const CandleSeries &candles) {
   if (candles.size() < 2)
     return 0.0;
+  const double *close = candles.close.data();
+  const double *volume = candles.volume.data();
   double obv = 0;
   for (size_t i = 1; i < candles.size(); ++i) {
-    if (candles[i].close > candles[i - 1].close)
-      obv += candles[i].volume;
-    else if (candles[i].close < candles[i - 1].close)
-      obv -= candles[i].volume;
+    if (close[i] > close[i - 1])
+      obv += volume[i];
+    else if (close[i] < close[i - 1])
+      obv -= volume[i];
   }
   return obv;
 }
 
 // Helper for VWAP Distance
-double calculate_vwap_dist(const std::vector<Candle> &candles, int period) {
+double calculate_vwap_dist(const CandleSeries &candles, int period) {
   if (candles.size() < period)
     return 0.0;
-  double pv_sum = 0, v_sum = 0;
-  for (size_t i = candles.size() - period; i < candles.size(); ++i) {
-    pv_sum += candles[i].close * candles[i].volume;
-    v_sum += (double)candles[i].volume;
-  }
+  const double *close = candles.close.data();
+  const double *volume = candles.volume.data();
+  size_t first = candles.size() - period;
+  double pv_sum = simd::dot(close + first, volume + first, period);
+  double v_sum = simd::sum(volume + first, period);
   if (v_sum == 0)
     return 0.0;
   double vwap = pv_sum / v_sum;
-  return (candles.back().close - vwap) / vwap * 100.0;
+  return (close[candles.size() - 1] - vwap) / vwap * 100.0;
 }
 
 // Helper for Bollinger Bands
@@ -91,28 +99,27 @@ std::pair<double, double> calculate_bollinger(const std::vector<double> &prices,
   if (prices.size() < period)
     return {0.0, 0.0};
   double sma = calculate_sma(prices, period);
-  double sum_sq_diff = 0;
-  for (size_t i = prices.size() - period; i < prices.size(); ++i) {
-    sum_sq_diff += std::pow(prices[i] - sma, 2);
-  }
+  double sum_sq_diff =
+      simd::sum_sq_dev(prices.data() + prices.size() - period, period, sma);
   double std_dev = std::sqrt(sum_sq_diff / period);
   return {sma + (std_dev_mult * std_dev), sma - (std_dev_mult * std_dev)};
 }
 
 // Simplified ADX (Average Directional Index)
-double calculate_adx(const std::vector<Candle> &candles, int period) {
+double calculate_adx(const CandleSeries &candles, int period) {
   if (candles.size() < period * 2)
     return 0.0;
 
-  std::vector<double> tr, plus_dm, minus_dm;
+  std::vector<double> tr(candles.size() - 1), plus_dm, minus_dm;
+  simd::true_range(candles.high.data() + 1, candles.low.data() + 1,
+                   candles.close.data(), tr.data(), tr.size());
+  plus_dm.reserve(candles.size());
+  minus_dm.reserve(candles.size());
   for (size_t i = 1; i < candles.size(); ++i) {
-    double h = candles[i].high;
-    double l = candles[i].low;
-    double ph = candles[i - 1].high;
-    double pl = candles[i - 1].low;
-    double pc = candles[i - 1].close;
-
-    tr.push_back(std::max({h - l, std::abs(h - pc), std::abs(l - pc)}));
+    double h = candles.high[i];
+    double l = candles.low[i];
+    double ph = candles.high[i - 1];
+    double pl = candles.low[i - 1];
 
     double move_up = h - ph;
     double move_down = pl - l;
@@ -144,18 +151,88 @@ double calculate_adx(const std::vector<Candle> &candles, int period) {
   return 100 * std::abs(plus_di - minus_di) / (plus_di + minus_di);
 }
 
+// Python-compatible round(x, 2): printf rounds the exact binary value the
+// same way CPython's round() does, so both models agree to the last digit.
+static double round2(double v) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.2f", v);
+  return std::strtod(buf, nullptr);
+}
+
+double MLModel::calibrate_probability(double score) {
+  // Centered at 0.5, scaled to make 0.7 feel like a solid probability
+  return 1.0 / (1.0 + std::exp(-(score - 0.5) * 8));
+}
+
+MarketRegime MLModel::classify_regime(const MLFeatures &features) {
+  double trend_state = features.trend_state;
+  double vol_state = features.volatility_state;
+
+  MarketRegime regime{"range", 0.5};
+  if (vol_state > 0.7) {
+    regime = {"high_vol", vol_state};
+  } else if (std::abs(trend_state) > 0.4) {
+    regime = {"trend", std::min(0.95, std::abs(trend_state) * 1.5)};
+  } else {
+    regime = {"range", 1.0 - std::abs(trend_state)};
+  }
+  regime.confidence = round2(regime.confidence);
+  return regime;
+}
+
+MLOutput MLModel::predict(const MLFeatures &features) {
+  MLOutput out;
+  out.regime = classify_regime(features);
+  const std::string &regime = out.regime.regime;
+
+  // 1. Base Score (Neutral 0.5), states mapped from [-1, 1]
+  double raw_score =
+      0.5 + (features.momentum_state * 0.3) + (features.trend_state * 0.2);
+  if (regime == "trend") // Follow the trend state more
+    raw_score += features.trend_state * 0.2;
+  raw_score = clamp(raw_score, 0.0, 1.0);
+
+  double calibrated_prob = calibrate_probability(raw_score);
+
+  std::string direction = "neutral";
+  if (calibrated_prob > 0.60)
+    direction = "long";
+  else if (calibrated_prob < 0.40)
+    direction = "short";
+
+  double final_prob =
+      (direction == "long") ? calibrated_prob : (1.0 - calibrated_prob);
+  if (direction == "neutral")
+    final_prob = 0.5;
+
+  // Expected R (Risk:Reward) based on Regime
+  double reward_risk_ratio = 1.0;
+  if (regime == "trend")
+    reward_risk_ratio = 2.5;
+  else if (regime == "range")
+    reward_risk_ratio = 1.5;
+  else if (regime == "high_vol")
+    reward_risk_ratio = 3.0;
+
+  // EV = (Win% * Reward) - (Loss% * Risk), risk is 1.0 unit
+  double ev = (final_prob * reward_risk_ratio) - ((1.0 - final_prob) * 1.0);
+
+  out.prediction = {direction, round2(final_prob), reward_risk_ratio};
+  out.expected_value = round2(ev);
+  out.signal_strength = round2(ev * out.regime.confidence);
+  return out;
+}
+
 AnalysisResult
-TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
-                                        const std::vector<Candle> &htf_candles,
-                                        bool is_stock) {
-  AnalysisResult res;
+TechnicalAnalysis::calculate_indicators(const CandleSeries &candles,
+                                        const CandleSeries &htf_candles,
+                                        bool is_stock, size_t trajectory_len) {
+  AnalysisResult res{};
   res.is_stock = is_stock;
   if (candles.empty())
     return res;
 
-  std::vector<double> closes;
-  for (const auto &c : candles)
-    closes.push_back(c.close);
+  const std::vector<double> &closes = candles.close;
 
   // 1. Basic Indicators
   res.sma_50 = calculate_sma(closes, 50);
@@ -163,47 +240,22 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
   res.current_rsi = calculate_rsi(closes, 14);
 
   // MACD with Signal Line
+  // EMAs are seeded with the first close. The signal line is the 9 EMA of the
+  // MACD series, seeded with the first MACD value once EMA26 has had 26 bars
+  // to warm up. This is a single forward pass, so IndicatorState can
+  // reproduce it bar by bar.
   if (closes.size() > 26) {
-    double ema12 = closes[0], ema26 = closes[0];
-    // Warmup EMAs
+    double ema12 = closes[0], ema26 = closes[0], signal = 0;
     for (size_t i = 1; i < closes.size(); ++i) {
       ema12 = calculate_ema(closes[i], ema12, 12);
       ema26 = calculate_ema(closes[i], ema26, 26);
+      if (i == 26)
+        signal = ema12 - ema26;
+      else if (i > 26)
+        signal = calculate_ema(ema12 - ema26, signal, 9);
     }
     res.macd = ema12 - ema26;
-
-    // Calculate Signal Line (9 EMA of MACD) - simplified approximation for now
-    // Ideally we'd keep a history of MACD values, but for this stateless
-    // function: We assume current MACD is close to recent average or calculate
-    // strictly if we had history. For MVP/Stateless: We will estimate Signal
-    // based on recent price momentum or strictly, we need the MACD series.
-    // Let's re-calculate MACD series for the last 9 periods to get a proper
-    // signal line.
-    std::vector<double> macd_history;
-    double e12 = closes[std::max((int)0, (int)closes.size() - 50)];
-    double e26 = e12;
-
-    // Recalculate EMAs for a window to build valid MACD signal
-    int start_idx = std::max((int)0, (int)closes.size() - 50);
-    for (int i = start_idx; i < closes.size(); ++i) {
-      e12 = calculate_ema(closes[i], e12, 12);
-      e26 = calculate_ema(closes[i], e26, 26);
-      if (i >= start_idx + 26) {
-        macd_history.push_back(e12 - e26);
-      }
-    }
-
-    if (!macd_history.empty()) {
-      res.macd_signal = calculate_ema(res.macd, macd_history.front(), 9);
-      // Correct signal line using the series
-      double sig = macd_history[0];
-      for (size_t i = 1; i < macd_history.size(); ++i) {
-        sig = calculate_ema(macd_history[i], sig, 9);
-      }
-      res.macd_signal = sig;
-    } else {
-      res.macd_signal = res.macd; // Fallback
-    }
+    res.macd_signal = signal;
   }
 
   // 2. Advanced Features for 3-Model Setup
@@ -213,18 +265,15 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
   res.boll_lower = bb.second;
   res.boll_width = (res.boll_upper - res.boll_lower) / closes.back();
 
-  // ATR and ATR Median
+  // ATR (last 14 true ranges) and ATR Median (last 50 true ranges)
   double current_atr = 0;
   std::vector<double> atrs;
-  if (candles.size() >= 14) {
-    for (size_t i = std::max((size_t)1, candles.size() - 50);
-         i < candles.size(); ++i) {
-      double tr = std::max({candles[i].high - candles[i].low,
-                            std::abs(candles[i].high - candles[i - 1].close),
-                            std::abs(candles[i].low - candles[i - 1].close)});
-      atrs.push_back(tr);
-    }
-    current_atr = std::accumulate(atrs.end() - 14, atrs.end(), 0.0) / 14.0;
+  if (candles.size() > 14) {
+    size_t first = candles.size() > 50 ? candles.size() - 50 : 1;
+    atrs.resize(candles.size() - first);
+    simd::true_range(candles.high.data() + first, candles.low.data() + first,
+                     closes.data() + first - 1, atrs.data(), atrs.size());
+    current_atr = simd::sum(atrs.data() + atrs.size() - 14, 14) / 14.0;
     std::sort(atrs.begin(), atrs.end());
     res.atr_median = atrs[atrs.size() / 2];
   }
@@ -240,8 +289,8 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
       (res.sma_200 > 0) ? (closes.back() - res.sma_200) / res.sma_200 * 100 : 0;
 
   double low_50 = closes.back(), high_50 = closes.back();
-  for (size_t i = std::max((size_t)0, closes.size() - 50); i < closes.size();
-       ++i) {
+  for (size_t i = closes.size() > 50 ? closes.size() - 50 : 0;
+       i < closes.size(); ++i) {
     low_50 = std::min(low_50, closes[i]);
     high_50 = std::max(high_50, closes[i]);
   }
@@ -250,9 +299,7 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
 
   // MTF Features
   if (!htf_candles.empty()) {
-    std::vector<double> htf_closes;
-    for (const auto &c : htf_candles)
-      htf_closes.push_back(c.close);
+    const std::vector<double> &htf_closes = htf_candles.close;
     res.htf_rsi = calculate_rsi(htf_closes, 14);
     res.htf_sma_50 = calculate_sma(htf_closes, 50);
     res.htf_sma_200 = calculate_sma(htf_closes, 200);
@@ -264,17 +311,91 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
 
   // Volume Z-Score
   if (candles.size() >= 20) {
-    double vol_sum = 0, vol_sq_sum = 0;
-    for (size_t i = candles.size() - 20; i < candles.size(); ++i) {
-      vol_sum += candles[i].volume;
-      vol_sq_sum += (double)candles[i].volume * candles[i].volume;
-    }
+    double vol_sum, vol_sq_sum;
+    const std::vector<double> &volumes = candles.volume;
+    simd::moments(volumes.data() + volumes.size() - 20, 20, vol_sum,
+                  vol_sq_sum);
     double vol_mean = vol_sum / 20.0;
-    double vol_std = std::sqrt(vol_sq_sum / 20.0 - vol_mean * vol_mean);
+    double vol_std =
+        std::sqrt(std::max(0.0, vol_sq_sum / 20.0 - vol_mean * vol_mean));
     res.volume_z_score =
-        (vol_std == 0) ? 0 : (candles.back().volume - vol_mean) / vol_std;
+        (vol_std == 0) ? 0 : (volumes.back() - vol_mean) / vol_std;
   }
 
+  // --- Quantum Trajectory (State History) ---
+  // One pass of the sliding-window engine (running sums + monotonic deques),
+  // so the cost is linear in the trajectory length rather than O(N * W).
+  // Each point needs 50 bars of warm-up, which are fed but not emitted.
+  size_t n = closes.size();
+  size_t start_idx =
+      (trajectory_len == 0 || trajectory_len >= n) ? 0 : n - trajectory_len;
+  size_t feed_from = start_idx > 50 ? start_idx - 50 : 0;
+  TrajectoryWindow trajectory;
+  res.state_history.reserve(n - start_idx);
+  for (size_t i = feed_from; i < n; ++i) {
+    trajectory.update(closes[i]);
+    if (i >= start_idx && trajectory.ready())
+      res.state_history.push_back(trajectory.point(candles.time[i]));
+  }
+
+  derive_signals(res, closes.back(), current_atr);
+  return res;
+}
+
+std::vector<BatchResult>
+TechnicalAnalysis::calculate_batch(const std::vector<BatchItem> &items,
+                                   size_t trajectory_len,
+                                   WorkStealingPool *pool) {
+  // Preallocated so each task writes its own slot without locking
+  std::vector<BatchResult> results(items.size());
+  WorkStealingPool &workers = pool ? *pool : WorkStealingPool::shared();
+
+  workers.parallel_for(items.size(), [&](size_t i) {
+    const BatchItem &item = items[i];
+    BatchResult &out = results[i];
+    out.ticker = item.ticker;
+    auto start = std::chrono::steady_clock::now();
+    try {
+      if (item.candles.empty())
+        throw std::runtime_error("no candles");
+      out.result = calculate_indicators(item.candles, item.htf_candles,
+                                        item.is_stock, trajectory_len);
+    } catch (const std::exception &e) {
+      out.error = e.what();
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    out.elapsed_ms = elapsed.count();
+  });
+  return results;
+}
+
+static TechnicalAnalysis::MLPredictor ml_predictor;
+
+void TechnicalAnalysis::set_ml_predictor(MLPredictor predictor) {
+  ml_predictor = std::move(predictor);
+}
+
+MLFeatures TechnicalAnalysis::ml_features(const AnalysisResult &res) {
+  MLFeatures f;
+  // State Vectors
+  f.momentum_state = res.momentum_state;
+  f.trend_state = res.trend_state;
+  f.volatility_state = res.volatility_state;
+  // Normalized bits if needed individually
+  f.rsi_norm = res.rsi_norm;
+  f.roc_norm = res.roc_norm;
+  f.vol_z_norm = res.volume_z_norm;
+  f.sma_dist_norm = res.sma_dist_norm;
+  // Raw needed for absolute levels
+  f.rsi = res.current_rsi;
+  f.adx = res.adx;
+  f.is_stock = res.is_stock;
+  return f;
+}
+
+void TechnicalAnalysis::derive_signals(AnalysisResult &res, double last_close,
+                                       double current_atr) {
   // --- 3. Feature Normalization & State Vectors ---
 
   // Normalize RSI: (Val - 50) / 50 -> [-1, 1]
@@ -282,8 +403,8 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
 
   // Normalize MACD: Histogram / Close (approx %) -> scaled
   double macd_hist = res.macd - res.macd_signal;
-  res.macd_hist_norm = clamp((macd_hist / closes.back()) * 100.0, -1.0, 1.0);
-  res.macd_norm = clamp((res.macd / closes.back()) * 100.0, -1.0, 1.0);
+  res.macd_hist_norm = clamp((macd_hist / last_close) * 100.0, -1.0, 1.0);
+  res.macd_norm = clamp((res.macd / last_close) * 100.0, -1.0, 1.0);
 
   // Normalize ROC: clamp(roc / 5, -1, 1)
   res.roc_norm = clamp(res.roc_20 / 5.0, -1.0, 1.0);
@@ -297,7 +418,7 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
   // Normalize Bollinger Width (volatility): Relative to recent avg or just raw
   // scaled Heuristic: Width > 0.05 is high vol for many assets, but varies.
   // Using ATR/Close as proxy for "normal" vol.
-  double rel_atr = (current_atr / closes.back()); // e.g. 0.01 for 1%
+  double rel_atr = (current_atr / last_close); // e.g. 0.01 for 1%
   res.bollinger_width_norm =
       clamp(res.boll_width / 0.10, 0.0, 1.0); // 10% width is huge
 
@@ -312,7 +433,7 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
   // Trend State: Avg of SMA Dist, ADX (directional), HTF alignment
   double htf_align = 0.0;
   if (res.htf_sma_200 > 0) {
-    htf_align = (closes.back() > res.htf_sma_200) ? 0.5 : -0.5;
+    htf_align = (last_close > res.htf_sma_200) ? 0.5 : -0.5;
   }
   // ADX is non-directional, multiply by trend sign (Momentum)
   double trend_dir = (res.momentum_state > 0) ? 1.0 : -1.0;
@@ -326,118 +447,35 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
 
   res.volatility_state = (atr_norm + res.bollinger_width_norm) / 2.0;
 
-  // --- Quantum Trajectory (State History) ---
-  // Calculate states for the last 50 candles to show trajectory.
-  // We use a simplified calculation for history to keep it fast (approximated).
-  int history_len = 50;
-  int start_idx = std::max((int)0, (int)closes.size() - history_len);
-
-  for (int i = start_idx; i < closes.size(); ++i) {
-    if (i < 50)
-      continue; // Need some warmup
-
-    // 1. Momentum Component (Approx RSI + ROC)
-    // Recalculate RSI for this point (simplified lookback)
-    // This is O(N*M) but N=50, M=14 so it's fine.
-    double avg_gain = 0, avg_loss = 0;
-    for (int k = 0; k < 14; ++k) {
-      double chg = closes[i - k] - closes[i - k - 1];
-      if (chg > 0)
-        avg_gain += chg;
-      else
-        avg_loss -= chg;
-    }
-    avg_gain /= 14.0;
-    avg_loss /= 14.0;
-    double rs = (avg_loss == 0) ? 100 : avg_gain / avg_loss;
-    double rsi = 100.0 - (100.0 / (1.0 + rs));
-    double rsi_n = (rsi - 50.0) / 50.0;
-
-    double roc_n = clamp(
-        ((closes[i] - closes[i - 5]) / closes[i - 5] * 100.0) / 5.0, -1.0, 1.0);
-
-    double mom_s = (rsi_n + roc_n) / 2.0;
-
-    // 2. Trend Component (SMA Dist)
-    double sma_50_i = 0; // Simple accumulation
-    for (int k = 0; k < 50; ++k)
-      sma_50_i += closes[i - k];
-    sma_50_i /= 50.0;
-    double sma_dist_n =
-        clamp(((closes[i] - sma_50_i) / sma_50_i * 100.0) / 10.0, -1.0, 1.0);
-
-    double trend_s = sma_dist_n; // Simplified
-
-    // 3. Volatility Component (Range)
-    double range_high = closes[i], range_low = closes[i];
-    for (int k = 0; k < 20; ++k) {
-      range_high = std::max(range_high, closes[i - k]);
-      range_low = std::min(range_low, closes[i - k]);
-    }
-    double vol_measure = (range_high - range_low) / closes[i];
-    double vol_s = clamp(vol_measure / 0.10, 0.0, 1.0);
-
-    res.state_history.push_back({mom_s, trend_s, vol_s, candles[i].timestamp});
-  }
   // Allow last point to overwrite with the "precise" calculations we just did
   // above
   if (!res.state_history.empty()) {
-    res.state_history.back() = {res.momentum_state, res.trend_state,
-                                res.volatility_state, candles.back().timestamp};
+    StateVector &last = res.state_history.back();
+    last = {res.momentum_state, res.trend_state, res.volatility_state,
+            last.time};
   }
 
-  // --- 4. Call Python ML Bridge ---
-  try {
-    nlohmann::json ml_input;
-    // Sending compact state vectors + raw essentials
-    ml_input["features"] = {// State Vectors
-                            {"momentum_state", res.momentum_state},
-                            {"trend_state", res.trend_state},
-                            {"volatility_state", res.volatility_state},
-
-                            // Normalized bits if needed individually
-                            {"rsi_norm", res.rsi_norm},
-                            {"roc_norm", res.roc_norm},
-                            {"vol_z_norm", res.volume_z_norm},
-                            {"sma_dist_norm", res.sma_dist_norm},
-
-                            // Raw needed for absolute levels
-                            {"rsi", res.current_rsi},
-                            {"adx", res.adx},
-                            {"is_stock", is_stock}};
-
-    std::string cmd =
-        "echo '" + ml_input.dump() + "' | python3 scripts/ml_predict.py";
-    FILE *pipe = popen(cmd.c_str(), "r");
-    if (pipe) {
-      char buffer[1024];
-      std::string ml_output_str;
-      while (fgets(buffer, sizeof(buffer), pipe) != NULL)
-        ml_output_str += buffer;
-      pclose(pipe);
-
-      auto ml_output = nlohmann::json::parse(ml_output_str);
-      res.regime_info = {ml_output["regime_model"]["regime"],
-                         ml_output["regime_model"]["confidence"]};
-
-      // Parse detailed ML info
-      auto dir_model = ml_output["directional_model"];
-      res.ml_info = {dir_model["direction"], dir_model["probability"],
-                     dir_model["expected_r"]};
-
-      // Store new metrics
-      res.expected_value = dir_model["expected_value"].get<double>();
-      res.signal_strength = dir_model["signal_strength"].get<double>();
+  // --- 4. Regime & Directional Models ---
+  MLFeatures features = ml_features(res);
+  MLOutput ml;
+  if (ml_predictor) {
+    try {
+      ml = ml_predictor(features);
+    } catch (const std::exception &e) {
+      std::cerr << "ML predictor failed (" << e.what()
+                << "), using native model" << std::endl;
+      ml = MLModel::predict(features);
     }
-  } catch (...) {
-    res.regime_info = {"unknown", 0.0};
-    res.ml_info = {"neutral", 0.0, 0.0};
-    res.expected_value = 0.0;
-    res.signal_strength = 0.0;
+  } else {
+    ml = MLModel::predict(features);
   }
+  res.regime_info = ml.regime;
+  res.ml_info = ml.prediction;
+  res.expected_value = ml.expected_value;
+  res.signal_strength = ml.signal_strength;
 
   // 5. Final TP/SL & Risk Filtering
-  double current_price = closes.back();
+  double current_price = last_close;
   double atr = current_atr;
 
   // Filter mostly based on Expected Value > 0.3 (as per expert review)
@@ -493,12 +531,57 @@ TechnicalAnalysis::calculate_indicators(const std::vector<Candle> &candles,
                        : current_price - (atr * 1.0);
 
   res.entry_price = current_price;
+}
 
-  return res;
+IndicatorSeries
+TechnicalAnalysis::calculate_series(const CandleSeries &candles) {
+  IndicatorSeries out;
+  size_t n = candles.size();
+  std::vector<double> *columns[] = {
+      &out.sma_50,     &out.sma_200,    &out.rsi,         &out.macd,
+      &out.macd_signal, &out.macd_hist, &out.boll_upper,  &out.boll_lower,
+      &out.boll_width, &out.atr,        &out.atr_median,  &out.adx,
+      &out.roc_5,      &out.roc_10,     &out.roc_20,      &out.obv,
+      &out.vwap_dist,  &out.volume_z_score, &out.sma_distance_pct,
+      &out.range_pos};
+  for (auto *column : columns)
+    column->resize(n);
+  out.time = candles.time;
+
+  // The streaming state is the fused pass: each bar updates the EMA chains,
+  // true range / DM windows and rolling sums once, then every line is read
+  // off the same state.
+  IndicatorState state;
+  for (size_t i = 0; i < n; ++i) {
+    state.update(candles[i]);
+    double atr = 0.0;
+    AnalysisResult r = state.indicators(&atr);
+    out.sma_50[i] = r.sma_50;
+    out.sma_200[i] = r.sma_200;
+    out.rsi[i] = r.current_rsi;
+    out.macd[i] = r.macd;
+    out.macd_signal[i] = r.macd_signal;
+    out.macd_hist[i] = r.macd - r.macd_signal;
+    out.boll_upper[i] = r.boll_upper;
+    out.boll_lower[i] = r.boll_lower;
+    out.boll_width[i] = r.boll_width;
+    out.atr[i] = atr;
+    out.atr_median[i] = r.atr_median;
+    out.adx[i] = r.adx;
+    out.roc_5[i] = r.roc_5;
+    out.roc_10[i] = r.roc_10;
+    out.roc_20[i] = r.roc_20;
+    out.obv[i] = r.obv;
+    out.vwap_dist[i] = r.vwap_dist;
+    out.volume_z_score[i] = r.volume_z_score;
+    out.sma_distance_pct[i] = r.sma_distance_pct;
+    out.range_pos[i] = r.range_pos;
+  }
+  return out;
 }
 
 std::string
-TechnicalAnalysis::get_market_summary(const std::vector<Candle> &candles,
+TechnicalAnalysis::get_market_summary(const CandleSeries &candles,
                                       const AnalysisResult &indicators) {
   if (candles.empty())
     return "No Data";
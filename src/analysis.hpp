@@ -1,6 +1,7 @@
 #pragma once
 #include "market_data.hpp"
 #include "nlohmann/json.hpp"
+#include <functional>
 #include <vector>
 
 struct MarketRegime {
@@ -12,7 +13,7 @@ struct StateVector {
   double x; // Momentum/Direction [-1, 1]
   double y; // Trend/Regime [-1, 1]
   double z; // Volatility [0, 1]
-  std::string timestamp;
+  int64_t time; // Epoch seconds of the bar
 };
 
 struct MLPrediction {
@@ -21,6 +22,38 @@ struct MLPrediction {
   double expected_r;
 };
 
+// Inputs of the regime / directional models (same keys as the "features"
+// object understood by scripts/ml_predict.py)
+struct MLFeatures {
+  double momentum_state;
+  double trend_state;
+  double volatility_state;
+  double rsi_norm;
+  double roc_norm;
+  double vol_z_norm;
+  double sma_dist_norm;
+  double rsi;
+  double adx;
+  bool is_stock;
+};
+
+struct MLOutput {
+  MarketRegime regime;
+  MLPrediction prediction;
+  double expected_value;
+  double signal_strength;
+};
+
+// Native port of scripts/ml_predict.py (Modell 1: regime classifier,
+// Modell 2: directional model). The Python script is kept as the reference
+// oracle for test_ml_parity.
+class MLModel {
+public:
+  static double calibrate_probability(double score);
+  static MarketRegime classify_regime(const MLFeatures &features);
+  static MLOutput predict(const MLFeatures &features);
+};
+
 struct AnalysisResult {
   double current_rsi;
   double macd;
@@ -82,12 +115,90 @@ struct AnalysisResult {
   std::vector<StateVector> state_history;
 };
 
+// Per-bar indicator lines aligned with the input CandleSeries: element i is
+// what calculate_indicators would report on the first i + 1 bars (same
+// warm-up defaults, e.g. RSI 50 and SMA 0 until enough bars exist).
+struct IndicatorSeries {
+  std::vector<int64_t> time;
+  std::vector<double> sma_50;
+  std::vector<double> sma_200;
+  std::vector<double> rsi;
+  std::vector<double> macd;
+  std::vector<double> macd_signal;
+  std::vector<double> macd_hist;
+  std::vector<double> boll_upper;
+  std::vector<double> boll_lower;
+  std::vector<double> boll_width;
+  std::vector<double> atr;
+  std::vector<double> atr_median;
+  std::vector<double> adx;
+  std::vector<double> roc_5;
+  std::vector<double> roc_10;
+  std::vector<double> roc_20;
+  std::vector<double> obv;
+  std::vector<double> vwap_dist;
+  std::vector<double> volume_z_score;
+  std::vector<double> sma_distance_pct;
+  std::vector<double> range_pos;
+
+  size_t size() const { return time.size(); }
+};
+
+class WorkStealingPool;
+
+// One ticker of a batch run
+struct BatchItem {
+  std::string ticker;
+  CandleSeries candles;
+  CandleSeries htf_candles;
+  bool is_stock = true;
+};
+
+// Outcome for one BatchItem; error is empty on success
+struct BatchResult {
+  std::string ticker;
+  AnalysisResult result{};
+  double elapsed_ms = 0.0;
+  std::string error;
+
+  bool ok() const { return error.empty(); }
+};
+
 class TechnicalAnalysis {
 public:
+  // trajectory_len is the number of state_history points (last bars);
+  // 0 returns the trajectory over the whole series.
   static AnalysisResult
-  calculate_indicators(const std::vector<Candle> &candles,
-                       const std::vector<Candle> &htf_candles = {},
-                       bool is_stock = true);
-  static std::string get_market_summary(const std::vector<Candle> &candles,
+  calculate_indicators(const CandleSeries &candles,
+                       const CandleSeries &htf_candles = {},
+                       bool is_stock = true, size_t trajectory_len = 50);
+
+  // Every indicator for every bar in one fused pass (shared true range,
+  // EMA chains and rolling windows); O(N) instead of N last-value calls.
+  static IndicatorSeries calculate_series(const CandleSeries &candles);
+
+  // Runs calculate_indicators for every item on a work-stealing pool (the
+  // shared one when pool is null). results[i] belongs to items[i]; a
+  // failing ticker records its error and does not abort the batch.
+  static std::vector<BatchResult>
+  calculate_batch(const std::vector<BatchItem> &items,
+                  size_t trajectory_len = 50,
+                  WorkStealingPool *pool = nullptr);
+
+  // Normalization, state vectors, ML models and TP/SL levels. Shared by the
+  // batch path above and the streaming IndicatorState, which fill in the raw
+  // indicator fields and state_history first.
+  static void derive_signals(AnalysisResult &res, double last_close,
+                             double current_atr);
+
+  // Optional out-of-process model backend (e.g. an MLWorkerPool). Set it once
+  // at start-up; when it is unset or throws, the native MLModel is used.
+  using MLPredictor = std::function<MLOutput(const MLFeatures &)>;
+  static void set_ml_predictor(MLPredictor predictor);
+
+  // Model inputs taken from a result whose state vectors are filled in
+  static MLFeatures ml_features(const AnalysisResult &res);
+
+  static std::string get_market_summary(const CandleSeries &candles,
                                         const AnalysisResult &indicators);
 };
@@ -1,14 +1,52 @@
 #include "analysis_storage.hpp"
+#include "record_codec.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <random>
 #include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bar times travel as local "YYYY-MM-DD HH:MM:SS", the format of
+// format_timestamp() in market_data.cpp
+static std::string format_local_time(int64_t epoch_seconds) {
+  std::time_t t = (std::time_t)epoch_seconds;
+  std::tm local{};
+  localtime_r(&t, &local);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+  return std::string(buffer);
+}
+
+static int64_t parse_local_time(const std::string &text) {
+  std::tm local{};
+  std::istringstream in(text);
+  in >> std::get_time(&local, "%Y-%m-%d %H:%M:%S");
+  if (in.fail()) {
+    local = std::tm{};
+    std::istringstream date(text);
+    date >> std::get_time(&local, "%Y-%m-%d");
+    if (date.fail())
+      return 0;
+  }
+  local.tm_isdst = -1;
+  return (int64_t)std::mktime(&local);
+}
+
+json StoredStateVector::to_json() const {
+  return json{{"x", x}, {"y", y}, {"z", z}, {"t", format_local_time(time)}};
+}
 
 // AnalysisRecord methods
-json AnalysisRecord::to_json() const {
-  return json{{"id", id},
+json AnalysisRecord::to_json(bool summary) const {
+  json j{{"id", id},
               {"timestamp", timestamp},
               {"ticker", ticker},
               {"model", model},
@@ -40,18 +78,23 @@ json AnalysisRecord::to_json() const {
                 {"stop_loss", stop_loss},
                 {"trailing_sl", trailing_sl},
                 {"partial_tp", partial_tp}}},
-              {"ai_prediction", ai_prediction},
-              {"state_history",
-               [this]() {
-                 json ja = json::array();
-                 for (const auto &s : state_history)
-                   ja.push_back(s.to_json());
-                 return ja;
-               }()},
               {"feedback",
                {{"submitted", feedback.submitted},
                 {"success", feedback.success},
                 {"remark", feedback.remark}}}};
+  j["regime"] = regime;
+  j["direction"] = direction;
+  if (std::isfinite(volatility_state))
+    j["indicators"]["volatility_state"] = volatility_state;
+  if (summary)
+    return j;
+
+  j["ai_prediction"] = ai_prediction;
+  json ja = json::array();
+  for (const auto &s : state_history)
+    ja.push_back(s.to_json());
+  j["state_history"] = std::move(ja);
+  return j;
 }
 
 AnalysisRecord AnalysisRecord::from_json(const json &j) {
@@ -84,8 +127,13 @@ AnalysisRecord AnalysisRecord::from_json(const json &j) {
     record.htf_rsi = ind.value("htf_rsi", 50.0);
     record.htf_sma_50 = ind.value("htf_sma_50", 0.0);
     record.htf_sma_200 = ind.value("htf_sma_200", 0.0);
+    if (ind.contains("volatility_state") && ind["volatility_state"].is_number())
+      record.volatility_state = ind["volatility_state"].get<double>();
   }
 
+  record.regime = j.value("regime", "");
+  record.direction = j.value("direction", "");
+
   if (j.contains("trading_levels")) {
     auto levels = j["trading_levels"];
     record.entry_price = levels.value("entry", 0.0);
@@ -99,9 +147,13 @@ AnalysisRecord AnalysisRecord::from_json(const json &j) {
 
   if (j.contains("state_history")) {
     for (const auto &item : j["state_history"]) {
-      record.state_history.push_back(
-          {item.value("x", 0.0), item.value("y", 0.0), item.value("z", 0.0),
-           item.value("t", "")});
+      // Stored as text before the binary format
+      int64_t time = item.contains("t") && item["t"].is_string()
+                         ? parse_local_time(item["t"].get<std::string>())
+                         : item.value("t", (int64_t)0);
+      record.state_history.push_back({item.value("x", 0.0),
+                                      item.value("y", 0.0),
+                                      item.value("z", 0.0), time});
     }
   }
 
@@ -115,192 +167,956 @@ AnalysisRecord AnalysisRecord::from_json(const json &j) {
   return record;
 }
 
+std::string AnalysisRecord::volatility_bucket() const {
+  if (!std::isfinite(volatility_state))
+    return "unknown";
+  if (volatility_state > 0.7)
+    return "high";
+  if (volatility_state < 0.3)
+    return "low";
+  return "normal";
+}
+
+json OutcomeCounts::to_json() const {
+  return json{{"analyses", analyses},
+              {"submitted", submitted},
+              {"success", success},
+              {"failed", failed},
+              {"win_rate", win_rate()}};
+}
+
+json AnalysisStats::to_json() const {
+  auto groups = [](const std::map<std::string, OutcomeCounts> &counts) {
+    json j = json::object();
+    for (const auto &item : counts)
+      j[item.first] = item.second.to_json();
+    return j;
+  };
+  return json{{"total", total.to_json()},
+              {"by_ticker", groups(by_ticker)},
+              {"by_model", groups(by_model)},
+              {"by_regime", groups(by_regime)},
+              {"by_direction", groups(by_direction)},
+              {"by_volatility", groups(by_volatility)},
+              {"version", version}};
+}
+
+// Crockford base32, the ULID alphabet; digits sort like the values they
+// encode
+static const char ULID_DIGITS[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+// The 10-character time part of a ULID (48-bit Unix milliseconds)
+static void encode_ulid_time(uint64_t ms, char *out) {
+  for (int i = 9; i >= 0; --i) {
+    out[i] = ULID_DIGITS[ms & 31];
+    ms >>= 5;
+  }
+}
+
+static bool is_ulid(const std::string &id) {
+  return id.size() == 26 && id[0] <= '7' &&
+         id.find_first_not_of(ULID_DIGITS) == std::string::npos;
+}
+
+// How far an id's time may be from its timestamp text: the server's time
+// zone (and so the meaning of the text) may have changed since the save
+static constexpr int64_t CLOCK_SLACK_MS = 26 * 3600 * 1000LL;
+
+static bool file_exists(const std::string &path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0;
+}
+
+// File layouts (little-endian):
+//   snapshot  "ANLS", u16 version, u32 count, then per record a u32 length
+//             and a RecordCodec body
+//   log       "ALOG", u16 version, then frames of u32 payload length,
+//             u32 FNV-1a of the payload and the payload: an op byte and
+//             the op's fields
+// Files from before the binary format hold JSON and are still read.
+static const char SNAPSHOT_MAGIC[] = "ANLS";
+static const char LOG_MAGIC[] = "ALOG";
+static constexpr size_t HEADER_SIZE = 6;
+
+enum LogOp : uint8_t { OP_PUT = 1, OP_FEEDBACK = 2, OP_DEL = 3 };
+
+static uint32_t fnv1a(const char *data, size_t n) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < n; ++i)
+    hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+  return hash;
+}
+
+static std::string read_file(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+static std::string log_frame(const std::string &payload) {
+  std::string frame;
+  ByteWriter out(frame);
+  out.u32((uint32_t)payload.size());
+  out.u32(fnv1a(payload.data(), payload.size()));
+  out.bytes(payload.data(), payload.size());
+  return frame;
+}
+
+// analyses.db -> analyses.json, the store's name before the binary format
+static std::string json_sibling(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  size_t dot = path.find_last_of('.');
+  bool has_ext = dot != std::string::npos &&
+                 (slash == std::string::npos || dot > slash);
+  std::string sibling = (has_ext ? path.substr(0, dot) : path) + ".json";
+  return sibling == path ? "" : sibling;
+}
+
 // AnalysisStorage methods
-AnalysisStorage::AnalysisStorage(const std::string &filename)
-    : filename_(filename) {
-  // Ensure file exists
-  std::ifstream test(filename_);
-  if (!test.good()) {
-    save_to_file(json{{"analyses", json::array()}});
+AnalysisStorage::AnalysisStorage(const std::string &filename,
+                                 size_t compact_after)
+    : filename_(filename), log_path_(filename + ".log"),
+      rotated_path_(filename + ".log.old"),
+      compact_after_(std::max<size_t>(compact_after, 1)),
+      version_((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count()) {
+  // Anything not in the current format is rewritten once loaded
+  bool rewrite = false;
+  int format = load_snapshot(filename_);
+  if (format < 0) {
+    std::string legacy = json_sibling(filename_);
+    if (!legacy.empty() && file_exists(legacy)) {
+      std::cout << "📦 Importing " << legacy << " into " << filename_
+                << std::endl;
+      load_snapshot(legacy);
+      replay_log(legacy + ".log");
+    }
+    rewrite = true;
+  } else if (format != RecordCodec::VERSION) {
+    rewrite = true;
   }
+
+  // A compaction was interrupted before dropping its log
+  bool interrupted = file_exists(rotated_path_);
+  if (interrupted)
+    replay_log(rotated_path_);
+  int log_format = RecordCodec::VERSION;
+  size_t valid = replay_log(log_path_, &log_ops_, &log_format);
+  if (log_ops_ && log_format != RecordCodec::VERSION)
+    rewrite = true;
+
+  bool rewritten = false;
+  if (rewrite || interrupted) {
+    std::vector<RecordPtr> rows;
+    for (const auto &row : rows_)
+      rows.push_back(row.second);
+    if (write_snapshot(rows)) {
+      std::remove(rotated_path_.c_str());
+      open_log(true);
+      log_ops_ = 0;
+      rewritten = true;
+    }
+  }
+  // Without a new snapshot the live log still holds records nothing else
+  // covers, so writes carry on after them
+  if (!rewritten) {
+    if (log_ops_ && log_format != RecordCodec::VERSION) {
+      std::cerr << "❌ " << log_path_
+                << " is in an older format and was not rewritten; analyses "
+                   "cannot be saved"
+                << std::endl;
+    } else if (log_format != RecordCodec::VERSION) {
+      open_log(true); // No records, only an older header
+    } else {
+      struct stat st;
+      if (::stat(log_path_.c_str(), &st) == 0 && (size_t)st.st_size > valid) {
+        std::cerr << "⚠️  Dropping incomplete record at end of " << log_path_
+                  << std::endl;
+        if (::truncate(log_path_.c_str(), (off_t)valid) != 0)
+          std::cerr << "⚠️  Could not truncate " << log_path_ << std::endl;
+      }
+      open_log(false);
+    }
+  }
+
+  compactor_ = std::thread([this] { compactor_loop(); });
 }
 
-std::string AnalysisStorage::save_analysis(const AnalysisRecord &record) {
-  auto data = load_from_file();
+AnalysisStorage::~AnalysisStorage() {
+  {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    stop_ = true;
+  }
+  compact_cv_.notify_all();
+  compactor_.join();
+  if (log_)
+    std::fclose(log_);
+}
 
+std::string AnalysisStorage::save_analysis(const AnalysisRecord &record) {
   // Create a copy with generated ID and timestamp
-  AnalysisRecord new_record = record;
-  new_record.id = generate_id();
-  new_record.timestamp = get_timestamp();
+  auto new_record = std::make_shared<AnalysisRecord>(record);
+  auto now = std::chrono::system_clock::now();
+  new_record->id = generate_id(now);
+  new_record->timestamp = get_timestamp(now);
 
-  // Add to analyses array
-  data["analyses"].push_back(new_record.to_json());
+  // Trajectories are stored as float32; round now so reads agree before
+  // and after a restart
+  for (auto &state : new_record->state_history) {
+    state.x = RecordCodec::round_coordinate(state.x);
+    state.y = RecordCodec::round_coordinate(state.y);
+    state.z = RecordCodec::round_coordinate(state.z);
+  }
 
-  // Save to file
-  save_to_file(data);
+  std::string payload;
+  ByteWriter out(payload);
+  out.u8(OP_PUT);
+  RecordCodec::encode(*new_record, out);
+  std::string frame = log_frame(payload);
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    if (!append_locked(frame))
+      throw std::runtime_error("Analysis could not be saved");
+    std::unique_lock<std::shared_mutex> lock(table_mutex_);
+    insert_locked(new_record);
+    publish_locked(AnalysisChange::Kind::Insert, new_record->id, new_record);
+  }
 
-  std::cout << "💾 Saved analysis: " << new_record.id << " ("
-            << new_record.ticker << ")" << std::endl;
+  std::cout << "💾 Saved analysis: " << new_record->id << " ("
+            << new_record->ticker << ")" << std::endl;
 
-  return new_record.id;
+  return new_record->id;
 }
 
-std::vector<AnalysisRecord> AnalysisStorage::get_recent_analyses(int limit) {
-  auto data = load_from_file();
-  std::vector<AnalysisRecord> results;
+std::vector<AnalysisRecord>
+AnalysisStorage::get_recent_analyses(int limit) const {
+  std::vector<RecordPtr> rows;
+  {
+    std::shared_lock<std::shared_mutex> lock(table_mutex_);
+    for (auto it = rows_.rbegin();
+         it != rows_.rend() && rows.size() < (size_t)std::max(limit, 0); ++it)
+      rows.push_back(it->second);
+  }
+  return collect(rows);
+}
 
-  if (!data.contains("analyses")) {
-    return results;
+std::vector<AnalysisRecord>
+AnalysisStorage::get_ticker_analyses(const std::string &ticker,
+                                     int limit) const {
+  std::vector<RecordPtr> rows;
+  {
+    std::shared_lock<std::shared_mutex> lock(table_mutex_);
+    auto postings = by_ticker_.find(ticker);
+    if (postings == by_ticker_.end())
+      return {};
+    const auto &seqs = postings->second;
+    for (auto it = seqs.rbegin();
+         it != seqs.rend() && rows.size() < (size_t)std::max(limit, 0); ++it)
+      rows.push_back(rows_.at(*it));
   }
+  return collect(rows);
+}
 
-  auto analyses = data["analyses"];
+AnalysisPage AnalysisStorage::query(const AnalysisQuery &q) const {
+  using Feedback = AnalysisQuery::Feedback;
+  AnalysisPage page;
+  if (q.limit == 0)
+    return page;
 
-  // Get last N analyses (newest first)
-  int start = std::max(0, (int)analyses.size() - limit);
-  for (int i = analyses.size() - 1; i >= start; i--) {
-    results.push_back(AnalysisRecord::from_json(analyses[i]));
+  auto matches = [&q](const AnalysisRecord &r) {
+    if (!q.ticker.empty() && r.ticker != q.ticker)
+      return false;
+    if (!q.model.empty() && r.model != q.model)
+      return false;
+    // `to` is compared on its own length, so a bare date covers the day
+    if (!q.to.empty() && r.timestamp.compare(0, q.to.size(), q.to) > 0)
+      return false;
+    switch (q.feedback) {
+    case Feedback::Pending:
+      return !r.feedback.submitted;
+    case Feedback::Submitted:
+      return r.feedback.submitted;
+    case Feedback::Success:
+      return r.feedback.submitted && r.feedback.success;
+    case Feedback::Failed:
+      return r.feedback.submitted && !r.feedback.success;
+    default:
+      return true;
+    }
+  };
+
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  page.version = version_;
+
+  // Rows are in time order, so a walk starts at the newest row `to` admits
+  // (looked up in by_time_ rather than reached by walking past every newer
+  // row) and ends at the first row older than `from`
+  uint64_t start = q.cursor;
+  if (!q.to.empty()) {
+    std::string latest = "9999-12-31 23:59:59";
+    latest.replace(0, std::min(q.to.size(), latest.size()), q.to);
+    int64_t seconds = parse_local_time(latest);
+    if (seconds > 0) {
+      char prefix[10];
+      encode_ulid_time((uint64_t)(seconds * 1000 + 999 + CLOCK_SLACK_MS),
+                       prefix);
+      // Sorts after every key with this time prefix
+      auto after = by_time_.upper_bound(std::string(prefix, 10) + '\x7f');
+      // 1 starts the walk before the first row: nothing is that old
+      uint64_t bound =
+          after == by_time_.begin() ? 1 : std::prev(after)->second + 1;
+      start = start ? std::min(start, bound) : bound;
+    }
   }
 
-  return results;
+  // Walks an index newest-first from `start`
+  auto walk = [&](const auto &index, auto seq_of, auto row_of) {
+    auto it = start ? index.lower_bound(start) : index.end();
+    uint64_t last = 0;
+    while (it != index.begin()) {
+      --it;
+      const RecordPtr &row = row_of(*it);
+      if (!q.from.empty() && row->timestamp < q.from)
+        break;
+      if (!matches(*row))
+        continue;
+      if (page.records.size() == q.limit) {
+        page.next_cursor = last;
+        break;
+      }
+      page.records.push_back(row);
+      last = seq_of(*it);
+    }
+  };
+  auto seq = [](uint64_t s) { return s; };
+  auto row = [this](uint64_t s) -> const RecordPtr & { return rows_.at(s); };
+
+  // Drive the walk from the narrowest index the query allows
+  if (!q.ticker.empty()) {
+    auto postings = by_ticker_.find(q.ticker);
+    if (postings != by_ticker_.end())
+      walk(postings->second, seq, row);
+  } else if (q.feedback == Feedback::Success) {
+    walk(succeeded_, seq, row);
+  } else if (q.feedback == Feedback::Failed) {
+    walk(failed_, seq, row);
+  } else {
+    walk(
+        rows_, [](const auto &item) { return item.first; },
+        [](const auto &item) -> const RecordPtr & { return item.second; });
+  }
+  return page;
 }
 
 bool AnalysisStorage::update_feedback(const std::string &analysis_id,
                                       bool success, const std::string &remark) {
-  auto data = load_from_file();
+  std::string payload;
+  ByteWriter out(payload);
+  out.u8(OP_FEEDBACK);
+  out.str(analysis_id);
+  out.u8(success);
+  out.str(remark);
+  std::string frame = log_frame(payload);
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    RecordPtr updated = with_feedback(analysis_id, success, remark);
+    if (!updated) {
+      return false;
+    }
+    if (!append_locked(frame))
+      throw std::runtime_error("Feedback could not be saved");
+    std::unique_lock<std::shared_mutex> lock(table_mutex_);
+    insert_locked(updated);
+    publish_locked(AnalysisChange::Kind::Feedback, analysis_id, updated);
+  }
 
-  if (!data.contains("analyses")) {
-    return false;
+  std::cout << "✅ Updated feedback for: " << analysis_id
+            << (success ? " (SUCCESS)" : " (FAILED)") << std::endl;
+
+  return true;
+}
+
+std::vector<AnalysisRecord>
+AnalysisStorage::get_successful_analyses(int limit) const {
+  std::vector<RecordPtr> rows;
+  {
+    std::shared_lock<std::shared_mutex> lock(table_mutex_);
+    for (uint64_t seq : succeeded_) {
+      if (rows.size() >= (size_t)std::max(limit, 0))
+        break;
+      rows.push_back(rows_.at(seq));
+    }
   }
+  return collect(rows);
+}
 
-  // Find and update the analysis
-  bool found = false;
-  for (auto &analysis : data["analyses"]) {
-    if (analysis["id"] == analysis_id) {
-      analysis["feedback"]["submitted"] = true;
-      analysis["feedback"]["success"] = success;
-      analysis["feedback"]["remark"] = remark;
-      found = true;
-      break;
+std::vector<AnalysisRecord>
+AnalysisStorage::get_failed_analyses(int limit) const {
+  std::vector<RecordPtr> rows;
+  {
+    std::shared_lock<std::shared_mutex> lock(table_mutex_);
+    for (uint64_t seq : failed_) {
+      if (rows.size() >= (size_t)std::max(limit, 0))
+        break;
+      rows.push_back(rows_.at(seq));
     }
   }
+  return collect(rows);
+}
 
-  if (found) {
-    save_to_file(data);
-    std::cout << "✅ Updated feedback for: " << analysis_id
-              << (success ? " (SUCCESS)" : " (FAILED)") << std::endl;
+bool AnalysisStorage::delete_analysis(const std::string &analysis_id) {
+  std::string payload;
+  ByteWriter out(payload);
+  out.u8(OP_DEL);
+  out.str(analysis_id);
+  std::string frame = log_frame(payload);
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    if (!by_id_.count(analysis_id)) {
+      return false;
+    }
+    if (!append_locked(frame))
+      throw std::runtime_error("Analysis could not be deleted");
+    std::unique_lock<std::shared_mutex> lock(table_mutex_);
+    erase_locked(analysis_id);
+    publish_locked(AnalysisChange::Kind::Delete, analysis_id, nullptr);
   }
 
-  return found;
+  std::cout << "🗑️  Deleted analysis: " << analysis_id << std::endl;
+
+  return true;
 }
 
-std::vector<AnalysisRecord>
-AnalysisStorage::get_successful_analyses(int limit) {
-  auto data = load_from_file();
-  std::vector<AnalysisRecord> results;
+size_t AnalysisStorage::size() const {
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  return rows_.size();
+}
+
+AnalysisChanges AnalysisStorage::changes_since(
+    uint64_t since, size_t limit, std::chrono::milliseconds wait) const {
+  AnalysisChanges result;
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  changed_.wait_for(lock, wait, [&] { return version_ != since; });
 
-  if (!data.contains("analyses")) {
-    return results;
+  result.version = version_;
+  uint64_t oldest = changes_.empty() ? version_ + 1 : changes_.front().version;
+  if (since > version_ || since + 1 < oldest) {
+    result.reset = true;
+    return result;
   }
 
-  // Filter for successful analyses
-  for (const auto &analysis : data["analyses"]) {
-    if (analysis.contains("feedback") &&
-        analysis["feedback"]["submitted"] == true &&
-        analysis["feedback"]["success"] == true) {
-      results.push_back(AnalysisRecord::from_json(analysis));
-      if (results.size() >= (size_t)limit)
-        break;
+  // Versions in the ring are consecutive
+  for (size_t i = (size_t)(since + 1 - oldest);
+       i < changes_.size() && result.changes.size() < limit; ++i)
+    result.changes.push_back(changes_[i]);
+  if (!result.changes.empty())
+    result.version = result.changes.back().version;
+  return result;
+}
+
+uint64_t AnalysisStorage::version() const {
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  return version_;
+}
+
+AnalysisStats AnalysisStorage::stats() const {
+  AnalysisStats result;
+  std::map<std::string, OutcomeCounts> *groups[STAT_GROUPS] = {
+      &result.by_ticker, &result.by_model, &result.by_regime,
+      &result.by_direction, &result.by_volatility};
+
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  result.total = totals_;
+  for (int g = 0; g < STAT_GROUPS; ++g)
+    groups[g]->insert(stats_[g].begin(), stats_[g].end());
+  result.version = version_;
+  return result;
+}
+
+std::vector<SimilarAnalysis>
+AnalysisStorage::similar_analyses(const AnalysisRecord &probe, size_t k,
+                                  bool graded_only) const {
+  std::vector<SimilarAnalysis> results;
+  SimilarityIndex::Vector features = feature_vector(probe);
+  std::shared_lock<std::shared_mutex> lock(table_mutex_);
+  auto graded = [this](uint64_t seq) {
+    return succeeded_.count(seq) || failed_.count(seq);
+  };
+  auto matches = graded_only ? similar_.nearest(features, k, graded)
+                             : similar_.nearest(features, k);
+  for (const auto &m : matches)
+    results.push_back({rows_.at(m.key), m.distance});
+  return results;
+}
+
+SimilarityIndex::Vector
+AnalysisStorage::feature_vector(const AnalysisRecord &record) {
+  auto clamp = [](double v, double lo, double hi) {
+    return std::isfinite(v) ? (float)std::min(std::max(v, lo), hi) : 0.0f;
+  };
+  StoredStateVector state = record.state_history.empty()
+                                ? StoredStateVector{0.0, 0.0, 0.0, 0}
+                                : record.state_history.back();
+  return {clamp(state.x, -1.0, 1.0),
+          clamp(state.y, -1.0, 1.0),
+          clamp(state.z, 0.0, 1.0),
+          clamp((record.rsi - 50.0) / 50.0, -1.0, 1.0),
+          clamp(record.roc_20 / 5.0, -1.0, 1.0),
+          clamp(record.adx / 50.0, 0.0, 1.0),
+          clamp(record.volume_z_score / 3.0, -1.0, 1.0),
+          clamp(record.sma_distance_pct / 10.0, -1.0, 1.0)};
+}
+
+void AnalysisStorage::compact() {
+  std::lock_guard<std::mutex> compacting(compact_mutex_);
+
+  // Rotate the log and take the rows it leads up to, so writers carry on
+  // appending while the snapshot is serialized. If a rotated log is still
+  // around from a failed snapshot write the live log is left in place: the
+  // new snapshot covers it and replaying it again is harmless.
+  std::vector<RecordPtr> rows;
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    bool pending = file_exists(rotated_path_);
+    if (!pending && (log_ops_ == 0 || !log_))
+      return;
+    if (!pending) {
+      std::fclose(log_);
+      log_ = nullptr;
+      if (std::rename(log_path_.c_str(), rotated_path_.c_str()) != 0) {
+        std::cerr << "❌ Cannot rotate " << log_path_ << std::endl;
+        open_log(false);
+        return;
+      }
+      open_log(true);
+      log_ops_ = 0;
     }
+    std::shared_lock<std::shared_mutex> lock(table_mutex_);
+    rows.reserve(rows_.size());
+    for (const auto &row : rows_)
+      rows.push_back(row.second);
   }
 
-  return results;
+  if (!write_snapshot(rows))
+    return;
+  std::remove(rotated_path_.c_str());
+
+  std::cout << "🗜️  Compacted analysis log (" << rows.size() << " analyses)"
+            << std::endl;
 }
 
-std::vector<AnalysisRecord> AnalysisStorage::get_failed_analyses(int limit) {
-  auto data = load_from_file();
-  std::vector<AnalysisRecord> results;
+void AnalysisStorage::compactor_loop() {
+  std::unique_lock<std::mutex> lock(log_mutex_);
+  while (!stop_) {
+    bool woken = compact_cv_.wait_for(lock, std::chrono::minutes(10), [this] {
+      return stop_ || log_ops_ >= compact_after_ || similar_.training_due();
+    });
+    if (stop_)
+      break;
+    bool train = similar_.training_due();
+    bool full = log_ops_ >= compact_after_;
+    if (!train && !full && (woken || log_ops_ == 0))
+      continue;
+    lock.unlock();
+    if (train)
+      retrain_similar();
+    if (full || !woken)
+      compact();
+    lock.lock();
+  }
+}
 
-  if (!data.contains("analyses")) {
-    return results;
+void AnalysisStorage::retrain_similar() {
+  // Writers need log_mutex_, so holding it keeps the index still while
+  // queries carry on
+  SimilarityIndex::Snapshot snapshot;
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    snapshot = similar_.snapshot();
+  }
+  SimilarityIndex trained = SimilarityIndex::train(snapshot);
+  {
+    std::lock_guard<std::mutex> writer(log_mutex_);
+    std::unique_lock<std::shared_mutex> lock(table_mutex_);
+    similar_.adopt(trained);
   }
+  // `trained` now holds the old index and is freed here, unlocked
+}
 
-  // Filter for failed analyses
-  for (const auto &analysis : data["analyses"]) {
-    if (analysis.contains("feedback") &&
-        analysis["feedback"]["submitted"] == true &&
-        analysis["feedback"]["success"] == false) {
-      results.push_back(AnalysisRecord::from_json(analysis));
-      if (results.size() >= (size_t)limit)
-        break;
+void AnalysisStorage::insert_locked(RecordPtr record) {
+  // Replay may put an id twice; the later record replaces the row in place
+  auto existing = by_id_.find(record->id);
+  if (existing != by_id_.end()) {
+    uint64_t seq = existing->second;
+    RecordPtr &row = rows_.at(seq);
+    if (row->ticker != record->ticker) {
+      by_ticker_[row->ticker].erase(seq);
+      by_ticker_[record->ticker].insert(seq);
     }
+    if (row->timestamp != record->timestamp) {
+      by_time_.erase(time_key(*row));
+      by_time_.emplace(time_key(*record), seq);
+    }
+    succeeded_.erase(seq);
+    failed_.erase(seq);
+    if (record->feedback.submitted)
+      (record->feedback.success ? succeeded_ : failed_).insert(seq);
+    count_locked(*row, -1);
+    count_locked(*record, +1);
+    similar_.insert(seq, feature_vector(*record));
+    if (similar_.training_due())
+      compact_cv_.notify_one();
+    row = std::move(record);
+    return;
   }
 
-  return results;
+  uint64_t seq = next_seq_++;
+  by_id_.emplace(record->id, seq);
+  by_time_.emplace(time_key(*record), seq);
+  by_ticker_[record->ticker].insert(seq);
+  if (record->feedback.submitted)
+    (record->feedback.success ? succeeded_ : failed_).insert(seq);
+  count_locked(*record, +1);
+  similar_.insert(seq, feature_vector(*record));
+  if (similar_.training_due())
+    compact_cv_.notify_one();
+  rows_.emplace(seq, std::move(record));
 }
 
-bool AnalysisStorage::delete_analysis(const std::string &analysis_id) {
-  auto data = load_from_file();
+void AnalysisStorage::count_locked(const AnalysisRecord &record, int sign) {
+  auto add = [&](OutcomeCounts &c) {
+    c.analyses += sign;
+    if (record.feedback.submitted) {
+      c.submitted += sign;
+      (record.feedback.success ? c.success : c.failed) += sign;
+    }
+  };
+  add(totals_);
 
-  if (!data.contains("analyses")) {
-    return false;
+  const std::string keys[STAT_GROUPS] = {
+      record.ticker, record.model,
+      record.regime.empty() ? "unknown" : record.regime,
+      record.direction.empty() ? "unknown" : record.direction,
+      record.volatility_bucket()};
+  for (int g = 0; g < STAT_GROUPS; ++g) {
+    auto it = stats_[g].try_emplace(keys[g]).first;
+    add(it->second);
+    if (it->second.analyses == 0)
+      stats_[g].erase(it);
   }
+}
+
+void AnalysisStorage::publish_locked(AnalysisChange::Kind kind,
+                                     const std::string &id,
+                                     RecordPtr record) {
+  changes_.push_back({++version_, kind, id, std::move(record)});
+  if (changes_.size() > CHANGE_RING)
+    changes_.pop_front();
+  changed_.notify_all();
+}
+
+AnalysisStorage::RecordPtr
+AnalysisStorage::with_feedback(const std::string &id, bool success,
+                               const std::string &remark) const {
+  auto it = by_id_.find(id);
+  if (it == by_id_.end())
+    return nullptr;
+  auto updated = std::make_shared<AnalysisRecord>(*rows_.at(it->second));
+  updated->feedback.submitted = true;
+  updated->feedback.success = success;
+  updated->feedback.remark = remark;
+  return updated;
+}
+
+bool AnalysisStorage::erase_locked(const std::string &id) {
+  auto it = by_id_.find(id);
+  if (it == by_id_.end())
+    return false;
+  uint64_t seq = it->second;
+  auto row = rows_.find(seq);
+
+  by_time_.erase(time_key(*row->second));
+  auto postings = by_ticker_.find(row->second->ticker);
+  postings->second.erase(seq);
+  if (postings->second.empty())
+    by_ticker_.erase(postings);
+  succeeded_.erase(seq);
+  failed_.erase(seq);
+  count_locked(*row->second, -1);
+  similar_.erase(seq);
+  if (similar_.training_due())
+    compact_cv_.notify_one();
+  rows_.erase(row);
+  by_id_.erase(it);
+  return true;
+}
+
+std::vector<AnalysisRecord>
+AnalysisStorage::collect(const std::vector<RecordPtr> &rows) {
+  std::vector<AnalysisRecord> results;
+  results.reserve(rows.size());
+  for (const auto &row : rows)
+    results.push_back(*row);
+  return results;
+}
 
-  // Find and remove the analysis
-  auto &analyses = data["analyses"];
-  bool found = false;
+int AnalysisStorage::load_snapshot(const std::string &path) {
+  if (!file_exists(path))
+    return -1;
+  std::string data = read_file(path);
 
-  for (size_t i = 0; i < analyses.size(); i++) {
-    if (analyses[i]["id"] == analysis_id) {
-      analyses.erase(analyses.begin() + i);
-      found = true;
+  if (data.compare(0, 4, SNAPSHOT_MAGIC) != 0) {
+    json legacy = json::parse(data);
+    if (legacy.contains("analyses"))
+      for (const auto &record : legacy["analyses"])
+        insert_locked(std::make_shared<AnalysisRecord>(
+            AnalysisRecord::from_json(record)));
+    return 0;
+  }
+
+  ByteReader in(data.data(), data.size());
+  in.skip(4);
+  uint16_t version = in.u16();
+  uint32_t count = in.u32();
+  for (uint32_t i = 0; i < count && in.ok(); ++i) {
+    uint32_t length = in.u32();
+    if (!in.ok() || in.remaining() < length)
       break;
+    ByteReader body(in.pos(), length);
+    in.skip(length);
+    auto record = std::make_shared<AnalysisRecord>();
+    if (!RecordCodec::decode(body, version, *record)) {
+      std::cerr << "❌ Unreadable record " << i << " in " << path << std::endl;
+      continue;
+    }
+    insert_locked(std::move(record));
+  }
+  if (rows_.size() < count)
+    std::cerr << "❌ " << path << " holds " << count << " analyses, loaded "
+              << rows_.size() << std::endl;
+  return version;
+}
+
+size_t AnalysisStorage::replay_log(const std::string &path, size_t *records,
+                                   int *format) {
+  std::string data = read_file(path);
+  size_t count = 0;
+  size_t valid = 0;
+
+  if (!data.empty() && data[0] == '{') {
+    // NDJSON from before the binary format
+    if (format)
+      *format = 0;
+    size_t start = 0;
+    size_t end;
+    while ((end = data.find('\n', start)) != std::string::npos) {
+      json op = json::parse(data.begin() + start, data.begin() + end, nullptr,
+                            false);
+      start = end + 1;
+      if (op.is_discarded())
+        continue;
+      std::string kind = op.value("op", "");
+      std::string id = op.value("id", "");
+      if (kind == "put") {
+        insert_locked(std::make_shared<AnalysisRecord>(
+            AnalysisRecord::from_json(op["record"])));
+      } else if (kind == "feedback") {
+        RecordPtr updated = with_feedback(id, op.value("success", false),
+                                          op.value("remark", ""));
+        if (updated)
+          insert_locked(std::move(updated));
+      } else if (kind == "del") {
+        erase_locked(id);
+      }
+      ++count;
     }
+    if (records)
+      *records = count;
+    return start;
   }
 
-  if (found) {
-    save_to_file(data);
-    std::cout << "🗑️  Deleted analysis: " << analysis_id << std::endl;
+  ByteReader in(data.data(), data.size());
+  uint16_t version = RecordCodec::VERSION;
+  if (data.size() >= HEADER_SIZE && data.compare(0, 4, LOG_MAGIC) == 0) {
+    in.skip(4);
+    version = in.u16();
+    valid = HEADER_SIZE;
+  } else if (!data.empty()) {
+    std::cerr << "❌ " << path << " is not an analysis log" << std::endl;
+    return 0;
   }
+  if (format)
+    *format = version;
 
-  return found;
-}
+  while (in.remaining() >= 8) {
+    uint32_t length = in.u32();
+    uint32_t checksum = in.u32();
+    // A frame cut short or garbled by a crash ends the log
+    if (in.remaining() < length || fnv1a(in.pos(), length) != checksum)
+      break;
+    ByteReader op(in.pos(), length);
+    in.skip(length);
+    valid = (size_t)(in.pos() - data.data());
 
-json AnalysisStorage::load_from_file() {
-  std::ifstream file(filename_);
-  if (!file.good()) {
-    return json{{"analyses", json::array()}};
+    uint8_t kind = op.u8();
+    if (kind == OP_PUT) {
+      auto record = std::make_shared<AnalysisRecord>();
+      if (RecordCodec::decode(op, version, *record))
+        insert_locked(std::move(record));
+    } else if (kind == OP_FEEDBACK) {
+      std::string id = op.str();
+      bool success = op.u8();
+      std::string remark = op.str();
+      RecordPtr updated =
+          op.ok() ? with_feedback(id, success, remark) : nullptr;
+      if (updated)
+        insert_locked(std::move(updated));
+    } else if (kind == OP_DEL) {
+      std::string id = op.str();
+      if (op.ok())
+        erase_locked(id);
+    }
+    ++count;
   }
-  return json::parse(file);
+  if (records)
+    *records = count;
+  return valid;
 }
 
-void AnalysisStorage::save_to_file(const json &data) {
-  std::ofstream file(filename_);
-  file << data.dump(2); // Pretty print with 2-space indent
+void AnalysisStorage::open_log(bool fresh) {
+  log_ = std::fopen(log_path_.c_str(), fresh ? "wb" : "ab");
+  if (!log_) {
+    std::cerr << "❌ Cannot open analysis log " << log_path_ << std::endl;
+    return;
+  }
+  if (std::ftell(log_) == 0) {
+    std::string header;
+    ByteWriter out(header);
+    out.bytes(LOG_MAGIC, 4);
+    out.u16(RecordCodec::VERSION);
+    if (std::fwrite(header.data(), 1, header.size(), log_) != header.size() ||
+        std::fflush(log_) != 0) {
+      std::cerr << "❌ Cannot write analysis log " << log_path_ << std::endl;
+      std::fclose(log_);
+      log_ = nullptr;
+    }
+  }
 }
 
-std::string AnalysisStorage::generate_id() {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_int_distribution<> dis(0, 15);
+bool AnalysisStorage::append_locked(const std::string &frame) {
+  if (!log_) {
+    std::cerr << "❌ Analysis log unavailable" << std::endl;
+    return false;
+  }
+  long end = std::ftell(log_);
+  bool ok = std::fwrite(frame.data(), 1, frame.size(), log_) == frame.size();
+  ok = ok && std::fflush(log_) == 0;
+  ok = ok && ::fsync(fileno(log_)) == 0;
+  if (ok) {
+    if (++log_ops_ >= compact_after_)
+      compact_cv_.notify_one();
+    return true;
+  }
+
+  // Cut off whatever part of the frame got out, or replay would stop there
+  // and skip every record written after it
+  std::cerr << "❌ Cannot write analysis log " << log_path_ << std::endl;
+  std::fclose(log_);
+  log_ = nullptr;
+  if (end >= 0 && ::truncate(log_path_.c_str(), (off_t)end) == 0)
+    open_log(false);
+  return false;
+}
 
-  const char *hex = "0123456789abcdef";
-  std::stringstream ss;
+bool AnalysisStorage::write_snapshot(const std::vector<RecordPtr> &rows) {
+  std::string tmp = filename_ + ".tmp";
+  std::FILE *file = std::fopen(tmp.c_str(), "wb");
+  if (!file) {
+    std::cerr << "❌ Cannot write " << tmp << std::endl;
+    return false;
+  }
 
-  for (int i = 0; i < 32; i++) {
-    ss << hex[dis(gen)];
-    if (i == 7 || i == 11 || i == 15 || i == 19) {
-      ss << '-';
+  // Encoded in chunks so a large table never sits in memory twice
+  std::string buffer;
+  ByteWriter out(buffer);
+  out.bytes(SNAPSHOT_MAGIC, 4);
+  out.u16(RecordCodec::VERSION);
+  out.u32((uint32_t)rows.size());
+  bool ok = true;
+  std::string body;
+  for (const auto &row : rows) {
+    body.clear();
+    ByteWriter record(body);
+    RecordCodec::encode(*row, record);
+    out.u32((uint32_t)body.size());
+    out.bytes(body.data(), body.size());
+    if (buffer.size() >= (1 << 20)) {
+      ok = std::fwrite(buffer.data(), 1, buffer.size(), file) ==
+               buffer.size() &&
+           ok;
+      buffer.clear();
     }
   }
+  ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() &&
+       ok;
+  ok = std::fflush(file) == 0 && ok;
+  ok = ::fsync(fileno(file)) == 0 && ok;
+  std::fclose(file);
+  if (!ok || std::rename(tmp.c_str(), filename_.c_str()) != 0) {
+    std::cerr << "❌ Cannot replace snapshot " << filename_ << std::endl;
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
 
-  return ss.str();
+std::string
+AnalysisStorage::generate_id(std::chrono::system_clock::time_point now) {
+  // Per-thread state, so concurrent saves share nothing
+  thread_local std::mt19937_64 rng(std::random_device{}());
+  thread_local uint64_t last_ms = 0;
+  thread_local uint64_t high = 0, low = 0; // 16 + 64 random bits
+
+  uint64_t ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                    now.time_since_epoch())
+                    .count();
+  if (ms <= last_ms) {
+    // Same millisecond, or the clock stepped back: count up from the last
+    // id so this thread's ids stay ordered
+    ms = last_ms;
+    if (++low == 0)
+      high = (high + 1) & 0xffff;
+  } else {
+    last_ms = ms;
+    high = rng() & 0xffff;
+    low = rng();
+  }
+
+  char id[26];
+  encode_ulid_time(ms, id);
+  uint64_t hi = high, lo = low;
+  for (int i = 25; i >= 10; --i) {
+    id[i] = ULID_DIGITS[lo & 31];
+    lo = (lo >> 5) | (hi << 59);
+    hi >>= 5;
+  }
+  return std::string(id, sizeof(id));
 }
 
-std::string AnalysisStorage::get_timestamp() {
-  auto now = std::chrono::system_clock::now();
-  auto time_t = std::chrono::system_clock::to_time_t(now);
+std::string
+AnalysisStorage::get_timestamp(std::chrono::system_clock::time_point now) {
+  return format_local_time(
+      (int64_t)std::chrono::system_clock::to_time_t(now));
+}
 
-  std::stringstream ss;
-  ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-  return ss.str();
+std::string AnalysisStorage::time_key(const AnalysisRecord &record) {
+  if (is_ulid(record.id))
+    return record.id;
+  char prefix[10];
+  encode_ulid_time(
+      (uint64_t)std::max<int64_t>(parse_local_time(record.timestamp), 0) *
+          1000,
+      prefix);
+  return std::string(prefix, 10) + record.id;
 }
@@ -1,5 +1,20 @@
+#pragma once
 #include "nlohmann/json.hpp"
+#include "similarity_index.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 using json = nlohmann::json;
@@ -21,11 +36,10 @@ struct FeedbackData {
 
 struct StoredStateVector {
   double x, y, z;
-  std::string timestamp;
+  int64_t time; // Epoch seconds of the bar
 
-  json to_json() const {
-    return json{{"x", x}, {"y", y}, {"z", z}, {"t", timestamp}};
-  }
+  // "t" is the bar time as local "YYYY-MM-DD HH:MM:SS"
+  json to_json() const;
 };
 
 struct AnalysisRecord {
@@ -66,6 +80,11 @@ struct AnalysisRecord {
   double trailing_sl;
   double partial_tp;
 
+  // Model outputs; empty / NaN in records saved before they were stored
+  std::string regime;    // trend, range, high_vol
+  std::string direction; // long, short, neutral
+  double volatility_state = std::numeric_limits<double>::quiet_NaN();
+
   // AI prediction
   std::string ai_prediction;
 
@@ -75,48 +94,299 @@ struct AnalysisRecord {
   // Quantum Trajectory
   std::vector<StoredStateVector> state_history;
 
-  // Convert to JSON
-  json to_json() const;
+  // Convert to JSON; a summary leaves out state_history and ai_prediction,
+  // the bulk of a record
+  json to_json(bool summary = false) const;
 
   // Create from JSON
   static AnalysisRecord from_json(const json &j);
+
+  // "low" / "normal" / "high" at the thresholds the trading levels use, or
+  // "unknown"
+  std::string volatility_bucket() const;
+};
+
+// Feedback outcomes of a group of analyses
+struct OutcomeCounts {
+  uint64_t analyses = 0;
+  uint64_t submitted = 0;
+  uint64_t success = 0;
+  uint64_t failed = 0;
+
+  // success / submitted; 0 without feedback
+  double win_rate() const {
+    return submitted ? (double)success / (double)submitted : 0.0;
+  }
+  json to_json() const;
+};
+
+// Outcome counters overall and per group. Records without a regime or
+// direction are grouped under "unknown".
+struct AnalysisStats {
+  OutcomeCounts total;
+  std::map<std::string, OutcomeCounts> by_ticker;
+  std::map<std::string, OutcomeCounts> by_model;
+  std::map<std::string, OutcomeCounts> by_regime;
+  std::map<std::string, OutcomeCounts> by_direction;
+  std::map<std::string, OutcomeCounts> by_volatility;
+  uint64_t version = 0; // Change version the counters reflect
+
+  json to_json() const;
+};
+
+// Filter for AnalysisStorage::query(); empty fields match anything
+struct AnalysisQuery {
+  enum class Feedback { Any, Pending, Submitted, Success, Failed };
+
+  std::string ticker;
+  std::string model;
+  // Inclusive bounds on AnalysisRecord::timestamp ("YYYY-MM-DD HH:MM:SS",
+  // so plain string order is time order); a prefix such as a date works
+  std::string from;
+  std::string to;
+  Feedback feedback = Feedback::Any;
+  // Continue after a previous page (AnalysisPage::next_cursor)
+  uint64_t cursor = 0;
+  size_t limit = 50;
+};
+
+struct AnalysisPage {
+  std::vector<std::shared_ptr<const AnalysisRecord>> records; // Newest first
+  uint64_t next_cursor = 0; // 0 when there are no more matches
+  uint64_t version = 0;     // Change version the page reflects
+};
+
+// One mutation in the change feed
+struct AnalysisChange {
+  enum class Kind { Insert, Feedback, Delete };
+
+  uint64_t version;
+  Kind kind;
+  std::string id;
+  std::shared_ptr<const AnalysisRecord> record; // The new row; null on Delete
+};
+
+struct AnalysisChanges {
+  std::vector<AnalysisChange> changes; // Oldest first
+  uint64_t version = 0; // Pass as `since` to continue
+  // The changes after `since` are no longer retained (or `since` is from
+  // another run): reload from query() instead
+  bool reset = false;
+};
+
+// A stored analysis and how far its setup is from the one searched for
+struct SimilarAnalysis {
+  std::shared_ptr<const AnalysisRecord> record;
+  double distance; // Squared Euclidean over feature_vector()
 };
 
+// Analyses live in memory as immutable typed records, indexed by id, by
+// ticker and by insertion order (which is time order). Reads never touch
+// the disk. All methods are thread-safe, and queries run in parallel with
+// each other and with the slow part of writes.
+//
+// On disk they are a binary snapshot file (RecordCodec records) plus an
+// append-only log next to it (<filename>.log). Every write appends one
+// checksummed frame -- a put, a feedback update or a delete tombstone -- so
+// writes cost the same however large the history grows. The frame is
+// fsynced before the write returns, so a write that succeeded survives a
+// crash. A background thread writes the table out as a new snapshot (temp
+// file, then rename) once the log holds compact_after records, or on a
+// timer, and drops the log records it covers; startup loads the snapshot
+// and replays whatever log is left. Replaying a record twice is harmless,
+// which keeps a crash mid-compaction recoverable. The same thread retrains
+// the similarity index when it is due, so no write waits for that.
+//
+// JSON files from earlier versions (including analyses.json next to an
+// analyses.db that does not exist yet) are read once and rewritten in the
+// current format. JSON is otherwise only produced for the HTTP API.
 class AnalysisStorage {
 public:
-  AnalysisStorage(const std::string &filename = "analyses.json");
+  AnalysisStorage(const std::string &filename = "analyses.json",
+                  size_t compact_after = 1000);
+  ~AnalysisStorage();
 
-  // Save a new analysis
+  AnalysisStorage(const AnalysisStorage &) = delete;
+  AnalysisStorage &operator=(const AnalysisStorage &) = delete;
+
+  // Save a new analysis. This and the other writes throw
+  // std::runtime_error, leaving the table as it was, when the change
+  // cannot be written to the log.
   std::string save_analysis(const AnalysisRecord &record);
 
   // Get recent analyses (limit = max number to return)
-  std::vector<AnalysisRecord> get_recent_analyses(int limit = 50);
+  std::vector<AnalysisRecord> get_recent_analyses(int limit = 50) const;
+
+  // Most recent analyses of one ticker, newest first
+  std::vector<AnalysisRecord> get_ticker_analyses(const std::string &ticker,
+                                                  int limit = 50) const;
+
+  // One page of matching analyses, newest first. The rows are shared, not
+  // copied; cursors stay valid until the process restarts.
+  AnalysisPage query(const AnalysisQuery &q) const;
 
   // Update feedback for an analysis
   bool update_feedback(const std::string &analysis_id, bool success,
                        const std::string &remark);
 
   // Get successful analyses for AI learning context
-  std::vector<AnalysisRecord> get_successful_analyses(int limit = 5);
+  std::vector<AnalysisRecord> get_successful_analyses(int limit = 5) const;
 
   // Get failed analyses for AI learning context
-  std::vector<AnalysisRecord> get_failed_analyses(int limit = 5);
+  std::vector<AnalysisRecord> get_failed_analyses(int limit = 5) const;
 
   // Delete an analysis by ID
   bool delete_analysis(const std::string &analysis_id);
 
+  // Number of stored analyses
+  size_t size() const;
+
+  // Mutations after change version `since`, waiting up to `wait` for the
+  // first one. Versions increase across restarts (they start from the
+  // clock), and the most recent CHANGE_RING mutations are kept.
+  AnalysisChanges changes_since(uint64_t since, size_t limit,
+                                std::chrono::milliseconds wait) const;
+
+  // Current change version
+  uint64_t version() const;
+
+  // Outcome counters. They are kept up to date by every write, so this
+  // only copies them.
+  AnalysisStats stats() const;
+
+  static constexpr size_t CHANGE_RING = 4096;
+
+  // The k stored analyses whose setups are closest to `probe` (which need
+  // not be stored), nearest first; `graded_only` skips analyses still
+  // waiting for feedback. Served from an in-memory vector index.
+  std::vector<SimilarAnalysis> similar_analyses(const AnalysisRecord &probe,
+                                                size_t k,
+                                                bool graded_only = true) const;
+
+  // A setup as the index sees it: the momentum / trend / volatility state
+  // of the last trajectory point and RSI, ROC-20, ADX, volume z-score and
+  // SMA distance, normalized like TechnicalAnalysis::derive_signals
+  static SimilarityIndex::Vector feature_vector(const AnalysisRecord &record);
+
+  // Fold the log into the snapshot now rather than waiting for the
+  // background thread
+  void compact();
+
 private:
+  using RecordPtr = std::shared_ptr<const AnalysisRecord>;
+
   std::string filename_;
+  std::string log_path_;
+  std::string rotated_path_; // Log being folded in by a compaction
+  size_t compact_after_;
+
+  // Readers share table_mutex_ and only copy row pointers under it, so
+  // each query sees one consistent state and never waits on disk I/O.
+  // Writers serialize on log_mutex_, append their record, then take
+  // table_mutex_ exclusively just to apply it; the log and the table
+  // therefore see writes in the same order.
+  mutable std::shared_mutex table_mutex_;
+  std::mutex log_mutex_;
+
+  // The table. Rows are never modified in place: a feedback update swaps in
+  // a new record, so a row handed to a reader stays valid and unchanged.
+  // Writers holding log_mutex_ may read it without table_mutex_.
+  uint64_t next_seq_ = 1; // 0 is the "no cursor" value
+  std::map<uint64_t, RecordPtr> rows_; // Insertion order
+  std::unordered_map<std::string, uint64_t> by_id_;
+  // Ids in time order (time_key()), for time-window scans
+  std::map<std::string, uint64_t> by_time_;
+  std::unordered_map<std::string, std::set<uint64_t>> by_ticker_;
+  std::set<uint64_t> succeeded_; // Rows with positive feedback
+  std::set<uint64_t> failed_;    // Rows with negative feedback
+
+  // Outcome counters, adjusted by insert_locked and erase_locked. A group
+  // is dropped when its last analysis is.
+  enum StatGroup {
+    BY_TICKER,
+    BY_MODEL,
+    BY_REGIME,
+    BY_DIRECTION,
+    BY_VOLATILITY,
+    STAT_GROUPS
+  };
+  OutcomeCounts totals_;
+  std::unordered_map<std::string, OutcomeCounts> stats_[STAT_GROUPS];
+
+  // feature_vector() of every row, keyed by sequence number. Retrained by
+  // the background thread (retrain_similar).
+  SimilarityIndex similar_;
+
+  // Change feed; version_ counts mutations after startup
+  uint64_t version_;
+  std::deque<AnalysisChange> changes_;
+  mutable std::condition_variable_any changed_;
+
+  // Guarded by log_mutex_
+  std::FILE *log_ = nullptr;
+  size_t log_ops_ = 0; // Records in the live log
+  bool stop_ = false;
+
+  std::mutex compact_mutex_; // One compaction at a time
+  std::condition_variable compact_cv_;
+  std::thread compactor_;
+
+  // Table mutations shared by writes and log replay; table_mutex_ must be
+  // held exclusively. Inserting an existing id replaces its row.
+  void insert_locked(RecordPtr record);
+  bool erase_locked(const std::string &id);
+
+  // Add (+1) or remove (-1) a row's share of the outcome counters
+  void count_locked(const AnalysisRecord &record, int sign);
+
+  // Record a mutation in the change feed and wake waiters; table_mutex_
+  // must be held exclusively
+  void publish_locked(AnalysisChange::Kind kind, const std::string &id,
+                      RecordPtr record);
+
+  // The row with its feedback replaced, or null for an unknown id
+  RecordPtr with_feedback(const std::string &id, bool success,
+                          const std::string &remark) const;
+
+  // Copies of rows picked under the lock, made after releasing it
+  static std::vector<AnalysisRecord>
+  collect(const std::vector<RecordPtr> &rows);
+
+  // Load a snapshot into the table; returns its format version (0 for
+  // JSON) or -1 if there is no such file
+  int load_snapshot(const std::string &path);
+
+  // Apply every complete record of a log; returns the byte length of the
+  // valid prefix and reports the log's format version
+  size_t replay_log(const std::string &path, size_t *records = nullptr,
+                    int *format = nullptr);
+
+  // (Re)open the live log, writing its header when it is empty
+  void open_log(bool fresh);
+
+  // Append one framed record to the log and fsync it; log_mutex_ must be
+  // held. False if it could not be written, with the log as it was.
+  bool append_locked(const std::string &frame);
+
+  // Write the rows as the snapshot atomically (temp file, fsync, rename)
+  bool write_snapshot(const std::vector<RecordPtr> &rows);
+
+  void compactor_loop();
 
-  // Load all analyses from file
-  json load_from_file();
+  // Retrain similar_ from a snapshot, outside table_mutex_, and swap the
+  // result in
+  void retrain_similar();
 
-  // Save all analyses to file
-  void save_to_file(const json &data);
+  // A ULID for `now`: 48-bit Unix milliseconds then 80 random bits, in
+  // Crockford base32, so text order is creation order. Ids made by one
+  // thread within the same millisecond count up from the first.
+  static std::string
+  generate_id(std::chrono::system_clock::time_point now);
 
-  // Generate unique ID
-  std::string generate_id();
+  // `now` as local "YYYY-MM-DD HH:MM:SS"
+  static std::string get_timestamp(std::chrono::system_clock::time_point now);
 
-  // Get current timestamp
-  std::string get_timestamp();
+  // by_time_ key: the id itself for ULIDs; ids from before them are
+  // prefixed with their record's time in the same encoding
+  static std::string time_key(const AnalysisRecord &record);
 };
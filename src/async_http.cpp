@@ -0,0 +1,162 @@
+#include "async_http.hpp"
+#include <curl/curl.h>
+#include <map>
+
+struct AsyncHttp::Transfer {
+  HttpRequest request;
+  HttpResponse response;
+  std::promise<HttpResponse> promise;
+  CURL *easy = nullptr;
+  curl_slist *headers = nullptr;
+};
+
+static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
+                            void *userp) {
+  ((std::string *)userp)->append((char *)contents, size * nmemb);
+  return size * nmemb;
+}
+
+// For requests with on_data; userp is the callback
+static size_t StreamCallback(void *contents, size_t size, size_t nmemb,
+                             void *userp) {
+  using OnData = std::function<void(const char *, size_t)>;
+  (*(OnData *)userp)((const char *)contents, size * nmemb);
+  return size * nmemb;
+}
+
+AsyncHttp::AsyncHttp() : multi_(curl_multi_init()) {
+  loop_ = std::thread([this] { run(); });
+}
+
+AsyncHttp::~AsyncHttp() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  curl_multi_wakeup(multi_);
+  loop_.join();
+  curl_multi_cleanup(multi_);
+}
+
+AsyncHttp &AsyncHttp::shared() {
+  static AsyncHttp http;
+  return http;
+}
+
+std::future<HttpResponse> AsyncHttp::submit(HttpRequest request) {
+  auto transfer = std::make_unique<Transfer>();
+  transfer->request = std::move(request);
+  auto future = transfer->promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      transfer->response.error = "HTTP loop stopped";
+      transfer->promise.set_value(std::move(transfer->response));
+      return future;
+    }
+    queued_.push_back(std::move(transfer));
+  }
+  curl_multi_wakeup(multi_);
+  return future;
+}
+
+void AsyncHttp::run() {
+  std::map<CURL *, std::unique_ptr<Transfer>> active;
+
+  auto finish = [&](Transfer &t) {
+    if (t.easy) {
+      curl_multi_remove_handle(multi_, t.easy);
+      curl_easy_cleanup(t.easy);
+    }
+    curl_slist_free_all(t.headers);
+    t.promise.set_value(std::move(t.response));
+  };
+
+  while (true) {
+    std::vector<std::unique_ptr<Transfer>> incoming;
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      incoming.swap(queued_);
+      stopping = stop_;
+    }
+
+    if (stopping) {
+      for (auto &t : incoming) {
+        t->response.error = "HTTP loop stopped";
+        finish(*t);
+      }
+      for (auto &item : active) {
+        item.second->response.error = "HTTP loop stopped";
+        finish(*item.second);
+      }
+      return;
+    }
+
+    for (auto &t : incoming) {
+      const HttpRequest &r = t->request;
+      t->easy = curl_easy_init();
+      if (!t->easy) {
+        t->response.error = "curl_easy_init failed";
+        finish(*t);
+        continue;
+      }
+      curl_easy_setopt(t->easy, CURLOPT_URL, r.url.c_str());
+      if (r.on_data) {
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, StreamCallback);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, &t->request.on_data);
+      } else {
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, &t->response.body);
+      }
+      curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t.get());
+      curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+      if (!r.user_agent.empty())
+        curl_easy_setopt(t->easy, CURLOPT_USERAGENT, r.user_agent.c_str());
+      if (r.follow_redirects)
+        curl_easy_setopt(t->easy, CURLOPT_FOLLOWLOCATION, 1L);
+      if (r.timeout_ms > 0)
+        curl_easy_setopt(t->easy, CURLOPT_TIMEOUT_MS, r.timeout_ms);
+      if (r.stall_timeout_s > 0) {
+        curl_easy_setopt(t->easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_LOW_SPEED_TIME, r.stall_timeout_s);
+      }
+      if (r.post) {
+        curl_easy_setopt(t->easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE, (long)r.body.size());
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, r.body.c_str());
+      }
+      for (const auto &h : r.headers)
+        t->headers = curl_slist_append(t->headers, h.c_str());
+      if (t->headers)
+        curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, t->headers);
+
+      curl_multi_add_handle(multi_, t->easy);
+      CURL *easy = t->easy;
+      active[easy] = std::move(t);
+    }
+
+    int running = 0;
+    curl_multi_perform(multi_, &running);
+
+    int remaining = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi_, &remaining)) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+      auto it = active.find(msg->easy_handle);
+      if (it == active.end())
+        continue;
+      Transfer &t = *it->second;
+      if (msg->data.result == CURLE_OK)
+        curl_easy_getinfo(t.easy, CURLINFO_RESPONSE_CODE, &t.response.status);
+      else
+        t.response.error = curl_easy_strerror(msg->data.result);
+      t.response.timed_out = msg->data.result == CURLE_OPERATION_TIMEDOUT;
+      finish(t);
+      active.erase(it);
+    }
+
+    // Sleeps until socket activity, a curl timer or curl_multi_wakeup()
+    curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HttpRequest {
+  std::string url;
+  bool post = false;
+  std::string body; // POST payload
+  std::vector<std::string> headers;
+  std::string user_agent;
+  bool follow_redirects = false;
+  long timeout_ms = 10000; // Whole transfer; 0 = no limit
+  long stall_timeout_s = 0; // Give up after this long with no data; 0 = never
+  // If set, receives the body piece by piece as it arrives (on the HTTP
+  // loop thread, so it must be quick) instead of HttpResponse::body
+  std::function<void(const char *data, size_t size)> on_data;
+};
+
+struct HttpResponse {
+  long status = 0;
+  std::string body;
+  std::string error; // curl error text; empty when the transfer completed
+  bool timed_out = false; // Failed on timeout_ms or stall_timeout_s
+
+  bool ok() const { return error.empty() && status >= 200 && status < 300; }
+};
+
+// Asynchronous HTTP on a single curl_multi event loop thread. Requests from
+// any thread are queued, run concurrently and reuse the multi handle's
+// connection cache; each submit() returns a future for its response.
+// Transport failures are reported in HttpResponse::error, never thrown.
+class AsyncHttp {
+public:
+  AsyncHttp();
+  ~AsyncHttp();
+
+  AsyncHttp(const AsyncHttp &) = delete;
+  AsyncHttp &operator=(const AsyncHttp &) = delete;
+
+  std::future<HttpResponse> submit(HttpRequest request);
+
+  // submit() and wait
+  HttpResponse fetch(HttpRequest request) {
+    return submit(std::move(request)).get();
+  }
+
+  // Process-wide loop, started on first use. curl_global_init must have run
+  // before that.
+  static AsyncHttp &shared();
+
+private:
+  struct Transfer;
+
+  void *multi_; // CURLM*
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Transfer>> queued_;
+  bool stop_ = false;
+  std::thread loop_;
+
+  void run();
+};
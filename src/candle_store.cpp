@@ -0,0 +1,243 @@
+#include "candle_store.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[4] = {'C', 'N', 'D', 'L'};
+const uint32_t VERSION = 1;
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t count;
+  int64_t fetched_at;
+};
+
+struct BarRecord {
+  int64_t time;
+  double open, high, low, close, volume;
+};
+
+static_assert(sizeof(FileHeader) == 24, "unexpected header padding");
+static_assert(sizeof(BarRecord) == 48, "unexpected record padding");
+
+const FileHeader *header_of(const void *data) {
+  return static_cast<const FileHeader *>(data);
+}
+
+const BarRecord *records_of(const void *data) {
+  return reinterpret_cast<const BarRecord *>(
+      static_cast<const char *>(data) + sizeof(FileHeader));
+}
+
+// Tickers become file names; keep them to one path component
+std::string file_key(const std::string &ticker, const std::string &interval) {
+  std::string key = ticker + "_" + interval;
+  std::replace(key.begin(), key.end(), '/', '_');
+  return key;
+}
+
+} // namespace
+
+// FileProvider
+
+CandleSeries FileProvider::fetch(const std::string &ticker,
+                                 const std::string &interval, int64_t since) {
+  CandleSeries candles;
+  std::ifstream file(directory_ + "/" + file_key(ticker, interval) + ".csv");
+  if (!file.is_open())
+    return candles;
+
+  std::string line;
+  std::getline(file, line); // Header
+  while (std::getline(file, line)) {
+    long long time;
+    Candle c;
+    if (std::sscanf(line.c_str(), "%lld,%lf,%lf,%lf,%lf,%lf", &time, &c.open,
+                    &c.high, &c.low, &c.close, &c.volume) != 6)
+      continue;
+    c.time = time;
+    if (c.time >= since)
+      candles.push_back(c);
+  }
+  return candles;
+}
+
+// CandleStore
+
+CandleStore::CandleStore(std::string directory, CandleProvider &provider,
+                         int64_t max_age_seconds)
+    : directory_(std::move(directory)), provider_(provider),
+      max_age_(max_age_seconds) {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec)
+    std::cerr << "Candle cache directory " << directory_
+              << " unavailable: " << ec.message() << std::endl;
+}
+
+CandleStore::~CandleStore() {
+  for (auto &item : entries_) {
+    unmap(*item.second);
+    if (item.second->fd >= 0)
+      close(item.second->fd);
+  }
+}
+
+std::shared_ptr<CandleStore::Entry>
+CandleStore::entry(const std::string &ticker, const std::string &interval) {
+  std::string key = file_key(ticker, interval);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = entries_[key];
+  if (!slot) {
+    slot = std::make_shared<Entry>();
+    slot->path = directory_ + "/" + key + ".bin";
+  }
+  return slot;
+}
+
+void CandleStore::unmap(Entry &e) {
+  if (e.data)
+    munmap(e.data, e.mapped);
+  e.data = nullptr;
+  e.mapped = 0;
+}
+
+bool CandleStore::open(Entry &e) {
+  if (e.fd < 0) {
+    e.fd = ::open(e.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (e.fd < 0)
+      return false;
+  }
+
+  struct stat st;
+  if (fstat(e.fd, &st) != 0)
+    return false;
+  size_t size = (size_t)st.st_size;
+  if (size < sizeof(FileHeader))
+    return true; // New (or empty) file: nothing cached yet
+
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, e.fd, 0);
+  if (data == MAP_FAILED)
+    return false;
+
+  const FileHeader *h = header_of(data);
+  bool valid = std::memcmp(h->magic, MAGIC, 4) == 0 &&
+               h->version == VERSION &&
+               size >= sizeof(FileHeader) + h->count * sizeof(BarRecord);
+  if (!valid) {
+    std::cerr << "Discarding corrupt candle cache " << e.path << std::endl;
+    munmap(data, size);
+    return ftruncate(e.fd, 0) == 0;
+  }
+
+  e.data = data;
+  e.mapped = size;
+  return true;
+}
+
+bool CandleStore::write(Entry &e, size_t keep, const CandleSeries &bars,
+                        int64_t fetched_at) {
+  std::vector<BarRecord> records(bars.size());
+  for (size_t i = 0; i < bars.size(); ++i)
+    records[i] = {bars.time[i], bars.open[i],  bars.high[i],
+                  bars.low[i],  bars.close[i], bars.volume[i]};
+
+  FileHeader h;
+  std::memcpy(h.magic, MAGIC, 4);
+  h.version = VERSION;
+  h.count = keep + bars.size();
+  h.fetched_at = fetched_at;
+
+  // Records first and the header (with the new count) last
+  size_t size = sizeof(FileHeader) + h.count * sizeof(BarRecord);
+  off_t offset = (off_t)(sizeof(FileHeader) + keep * sizeof(BarRecord));
+  size_t bytes = records.size() * sizeof(BarRecord);
+  bool ok = (bytes == 0 || pwrite(e.fd, records.data(), bytes, offset) ==
+                               (ssize_t)bytes) &&
+            ftruncate(e.fd, (off_t)size) == 0 &&
+            pwrite(e.fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h);
+
+  // The mapping shares the page cache, so only a size change needs a remap
+  if (size != e.mapped) {
+    unmap(e);
+    open(e);
+  }
+  return ok;
+}
+
+CandleSeries CandleStore::get(const std::string &ticker,
+                              const std::string &interval) {
+  auto e = entry(ticker, interval);
+  std::lock_guard<std::mutex> lock(e->mutex);
+  if (e->fd < 0 && !open(*e))
+    return provider_.fetch(ticker, interval, 0); // Cache unusable
+
+  int64_t now = (int64_t)std::time(nullptr);
+  size_t count = e->data ? header_of(e->data)->count : 0;
+  int64_t fetched_at = e->data ? header_of(e->data)->fetched_at : 0;
+
+  if (count == 0 || now - fetched_at >= max_age_) {
+    // The last cached bar is requested again: it may have been in progress
+    int64_t since = count > 0 ? records_of(e->data)[count - 1].time : 0;
+    CandleSeries fresh;
+    try {
+      fresh = provider_.fetch(ticker, interval, since);
+    } catch (const std::exception &ex) {
+      std::cerr << "Candle fetch for " << ticker << " failed: " << ex.what()
+                << std::endl;
+    }
+
+    if (!fresh.empty()) {
+      const BarRecord *records = e->data ? records_of(e->data) : nullptr;
+      size_t keep = std::lower_bound(records, records + count, fresh.time[0],
+                                     [](const BarRecord &r, int64_t t) {
+                                       return r.time < t;
+                                     }) -
+                    records;
+      if (!write(*e, keep, fresh, now))
+        std::cerr << "Candle cache write failed for " << e->path << std::endl;
+      count = e->data ? header_of(e->data)->count : 0;
+    }
+  }
+
+  CandleSeries candles;
+  candles.reserve(count);
+  const BarRecord *records = count ? records_of(e->data) : nullptr;
+  for (size_t i = 0; i < count; ++i) {
+    const BarRecord &r = records[i];
+    candles.push_back({r.time, r.open, r.high, r.low, r.close, r.volume});
+  }
+  return candles;
+}
+
+void CandleStore::invalidate(const std::string &ticker,
+                             const std::string &interval) {
+  std::shared_ptr<Entry> e;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(file_key(ticker, interval));
+    if (it != entries_.end()) {
+      e = it->second;
+      entries_.erase(it);
+    }
+  }
+  if (e) {
+    std::lock_guard<std::mutex> lock(e->mutex);
+    unmap(*e);
+    if (e->fd >= 0)
+      close(e->fd);
+    e->fd = -1;
+  }
+  unlink((directory_ + "/" + file_key(ticker, interval) + ".bin").c_str());
+}
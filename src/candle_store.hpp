@@ -0,0 +1,72 @@
+#pragma once
+#include "market_data.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Reads <directory>/<TICKER>_<interval>.csv with a header line and rows
+// "time,open,high,low,close,volume" (epoch seconds). Stands in for Yahoo in
+// tests and offline runs.
+class FileProvider : public CandleProvider {
+public:
+  explicit FileProvider(std::string directory)
+      : directory_(std::move(directory)) {}
+
+  CandleSeries fetch(const std::string &ticker, const std::string &interval,
+                     int64_t since) override;
+
+private:
+  std::string directory_;
+};
+
+// Persistent per-(ticker, interval) candle history. Each series lives in
+// <directory>/<TICKER>_<interval>.bin and stays memory-mapped once opened.
+// get() serves from the mapping while the data is younger than max_age;
+// after that it asks the provider only for bars from the last cached
+// timestamp on, overwrites the tail from the first returned bar (the last
+// cached bar may still have been forming) and appends the rest.
+//
+// File layout (native endianness):
+//   Header {char magic[4] = "CNDL"; uint32 version; uint64 count;
+//           int64 fetched_at;}
+//   count x {int64 time; double open, high, low, close, volume;}
+class CandleStore {
+public:
+  CandleStore(std::string directory, CandleProvider &provider,
+              int64_t max_age_seconds = 60);
+  ~CandleStore();
+
+  CandleStore(const CandleStore &) = delete;
+  CandleStore &operator=(const CandleStore &) = delete;
+
+  // Cached history, topped up from the provider when stale. On a provider
+  // failure the cached bars are returned as they are.
+  CandleSeries get(const std::string &ticker, const std::string &interval);
+
+  // Drops the cached file so the next get() does a full fetch
+  void invalidate(const std::string &ticker, const std::string &interval);
+
+private:
+  struct Entry {
+    std::mutex mutex; // Serializes refreshes of this series only
+    std::string path;
+    int fd = -1;
+    void *data = nullptr; // Mapping of the whole file, or null
+    size_t mapped = 0;
+  };
+
+  std::string directory_;
+  CandleProvider &provider_;
+  int64_t max_age_;
+  std::mutex mutex_; // Guards entries_
+  std::map<std::string, std::shared_ptr<Entry>> entries_;
+
+  std::shared_ptr<Entry> entry(const std::string &ticker,
+                               const std::string &interval);
+  bool open(Entry &e);
+  void unmap(Entry &e);
+  bool write(Entry &e, size_t keep, const CandleSeries &bars,
+             int64_t fetched_at);
+};
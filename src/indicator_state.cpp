@@ -0,0 +1,348 @@
+#include "indicator_state.hpp"
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Same step as calculate_ema in analysis.cpp; kept bit-for-bit identical so
+// the streaming and batch MACD agree.
+static double ema_step(double current_price, double prev_ema, int period) {
+  double multiplier = 2.0 / (period + 1);
+  return (current_price - prev_ema) * multiplier + prev_ema;
+}
+
+// RollingWindow
+
+RollingWindow::RollingWindow(size_t capacity) : buf_(capacity, 0.0) {}
+
+void RollingWindow::push(double v) {
+  if (full()) {
+    double old = buf_[head_];
+    sum_ -= old;
+    sum_sq_ -= old * old;
+    if (old != 0.0)
+      --nonzero_;
+  } else {
+    ++count_;
+  }
+
+  buf_[head_] = v;
+  sum_ += v;
+  sum_sq_ += v * v;
+  if (v != 0.0)
+    ++nonzero_;
+  head_ = (head_ + 1) % buf_.size();
+
+  if (nonzero_ == 0) {
+    sum_ = 0.0;
+    sum_sq_ = 0.0;
+  } else if (head_ == 0) {
+    // Re-add from scratch once per wrap so subtraction error cannot build up
+    resync();
+  }
+}
+
+double RollingWindow::operator[](size_t i) const {
+  size_t start = full() ? head_ : 0;
+  return buf_[(start + i) % buf_.size()];
+}
+
+double RollingWindow::ago(size_t lag) const {
+  return buf_[(head_ + buf_.size() - 1 - lag) % buf_.size()];
+}
+
+void RollingWindow::resync() {
+  // Only called on a wrap (head_ == 0), so the window is one contiguous run
+  simd::moments(buf_.data(), count_, sum_, sum_sq_);
+}
+
+// SlidingExtrema
+
+SlidingExtrema::SlidingExtrema(size_t window) : window_(window) {}
+
+void SlidingExtrema::push(double v) {
+  size_t index = count_++;
+  while (!min_.empty() && min_.back().second >= v)
+    min_.pop_back();
+  min_.emplace_back(index, v);
+  while (!max_.empty() && max_.back().second <= v)
+    max_.pop_back();
+  max_.emplace_back(index, v);
+
+  if (index >= window_) {
+    size_t oldest = index - window_ + 1;
+    while (min_.front().first < oldest)
+      min_.pop_front();
+    while (max_.front().first < oldest)
+      max_.pop_front();
+  }
+}
+
+// TrajectoryWindow
+
+void TrajectoryWindow::update(double close) {
+  if (count_ > 0) {
+    double chg = close - close_;
+    gains_14_.push(chg > 0 ? chg : 0);
+    losses_14_.push(chg > 0 ? 0 : -chg);
+  }
+  ++count_;
+  close_ = close;
+  closes_50_.push(close);
+  range_20_.push(close);
+}
+
+StateVector TrajectoryWindow::point(int64_t time) const {
+  // 1. Momentum Component (simple 14-bar RSI + ROC 5)
+  double avg_gain = gains_14_.sum() / 14.0;
+  double avg_loss = losses_14_.sum() / 14.0;
+  double rs = (avg_loss == 0) ? 100 : avg_gain / avg_loss;
+  double rsi = 100.0 - (100.0 / (1.0 + rs));
+  double rsi_n = (rsi - 50.0) / 50.0;
+
+  double close_5 = closes_50_.ago(5);
+  double roc_n =
+      std::clamp(((close_ - close_5) / close_5 * 100.0) / 5.0, -1.0, 1.0);
+  double mom_s = (rsi_n + roc_n) / 2.0;
+
+  // 2. Trend Component (SMA 50 distance)
+  double sma_50 = closes_50_.sum() / 50.0;
+  double trend_s =
+      std::clamp(((close_ - sma_50) / sma_50 * 100.0) / 10.0, -1.0, 1.0);
+
+  // 3. Volatility Component (20-bar range)
+  double vol_measure = (range_20_.max() - range_20_.min()) / close_;
+  double vol_s = std::clamp(vol_measure / 0.10, 0.0, 1.0);
+
+  return {mom_s, trend_s, vol_s, time};
+}
+
+// WilderRsi
+
+WilderRsi::WilderRsi(int period) : period_(period) {}
+
+void WilderRsi::update(double close) {
+  ++count_;
+  if (count_ == 1) {
+    prev_ = close;
+    return;
+  }
+
+  double change = close - prev_;
+  prev_ = close;
+  size_t changes = count_ - 1;
+
+  if (changes <= (size_t)period_) {
+    // Seed phase: plain sums, averaged once `period` changes are in
+    if (change > 0)
+      avg_gain_ += change;
+    else
+      avg_loss_ -= change;
+    if (changes == (size_t)period_) {
+      avg_gain_ /= period_;
+      avg_loss_ /= period_;
+    }
+    return;
+  }
+
+  double gain = (change > 0) ? change : 0;
+  double loss = (change < 0) ? -change : 0;
+  avg_gain_ = (avg_gain_ * (period_ - 1) + gain) / period_;
+  avg_loss_ = (avg_loss_ * (period_ - 1) + loss) / period_;
+}
+
+double WilderRsi::value() const {
+  if (count_ <= (size_t)period_)
+    return 50.0;
+  return (avg_loss_ == 0) ? 100.0
+                          : 100.0 - (100.0 / (1.0 + avg_gain_ / avg_loss_));
+}
+
+// IndicatorState
+
+IndicatorState::IndicatorState(bool is_stock, size_t trajectory_len)
+    : is_stock_(is_stock), trajectory_len_(trajectory_len) {}
+
+IndicatorState IndicatorState::from_series(const CandleSeries &candles,
+                                           const CandleSeries &htf_candles,
+                                           bool is_stock,
+                                           size_t trajectory_len) {
+  IndicatorState state(is_stock, trajectory_len);
+  for (size_t i = 0; i < htf_candles.size(); ++i)
+    state.update_htf(htf_candles[i]);
+  for (size_t i = 0; i < candles.size(); ++i)
+    state.update(candles[i]);
+  return state;
+}
+
+void IndicatorState::update(const Candle &bar) {
+  size_t i = bars_++;
+  last_time_ = bar.time;
+
+  closes_200_.push(bar.close);
+  closes_50_.push(bar.close);
+  closes_20_.push(bar.close);
+  range_50_.push(bar.close);
+  volumes_20_.push(bar.volume);
+  pv_20_.push(bar.close * bar.volume);
+  rsi_.update(bar.close);
+
+  if (i == 0) {
+    ema12_ = bar.close;
+    ema26_ = bar.close;
+  } else {
+    ema12_ = ema_step(bar.close, ema12_, 12);
+    ema26_ = ema_step(bar.close, ema26_, 26);
+    if (i == 26)
+      macd_signal_ = ema12_ - ema26_;
+    else if (i > 26)
+      macd_signal_ = ema_step(ema12_ - ema26_, macd_signal_, 9);
+
+    if (bar.close > prev_close_)
+      obv_ += bar.volume;
+    else if (bar.close < prev_close_)
+      obv_ -= bar.volume;
+
+    double tr = std::max({bar.high - bar.low, std::abs(bar.high - prev_close_),
+                          std::abs(bar.low - prev_close_)});
+    tr_14_.push(tr);
+    tr_50_.push(tr);
+
+    double move_up = bar.high - prev_high_;
+    double move_down = prev_low_ - bar.low;
+    plus_dm_14_.push((move_up > move_down && move_up > 0) ? move_up : 0);
+    minus_dm_14_.push((move_down > move_up && move_down > 0) ? move_down : 0);
+  }
+
+  prev_high_ = bar.high;
+  prev_low_ = bar.low;
+  prev_close_ = bar.close;
+
+  trajectory_window_.update(bar.close);
+  if (trajectory_window_.ready()) {
+    trajectory_.push_back(trajectory_window_.point(bar.time));
+    if (trajectory_len_ > 0 && trajectory_.size() > trajectory_len_)
+      trajectory_.pop_front();
+  }
+}
+
+void IndicatorState::update_htf(const Candle &bar) {
+  ++htf_bars_;
+  htf_rsi_.update(bar.close);
+  htf_closes_50_.push(bar.close);
+  htf_closes_200_.push(bar.close);
+}
+
+AnalysisResult IndicatorState::indicators(double *atr_out) const {
+  AnalysisResult res{};
+  res.is_stock = is_stock_;
+  if (atr_out)
+    *atr_out = 0.0;
+  if (bars_ == 0)
+    return res;
+
+  double close = prev_close_;
+
+  // 1. Basic Indicators
+  res.sma_50 = closes_50_.full() ? closes_50_.sum() / 50 : 0.0;
+  res.sma_200 = closes_200_.full() ? closes_200_.sum() / 200 : 0.0;
+  res.current_rsi = rsi_.value();
+
+  if (bars_ > 26) {
+    res.macd = ema12_ - ema26_;
+    res.macd_signal = macd_signal_;
+  }
+
+  // 2. ADX (14-period SMA smoothing, as in calculate_adx)
+  if (bars_ >= 28 && tr_14_.sum() != 0) {
+    double plus_di = 100 * (plus_dm_14_.sum() / 14) / (tr_14_.sum() / 14);
+    double minus_di = 100 * (minus_dm_14_.sum() / 14) / (tr_14_.sum() / 14);
+    if (plus_di + minus_di != 0)
+      res.adx = 100 * std::abs(plus_di - minus_di) / (plus_di + minus_di);
+  }
+
+  // Bollinger (20, 2.0) from the window itself, as calculate_bollinger
+  // does: deviations around the mean, so no cancellation on high prices
+  // and the same bands to the bit
+  if (bars_ >= 20) {
+    std::array<double, 20> window;
+    for (size_t k = 0; k < 20; ++k)
+      window[k] = closes_20_[k];
+    double sma = simd::sum(window.data(), 20) / 20;
+    double std_dev =
+        std::sqrt(simd::sum_sq_dev(window.data(), 20, sma) / 20);
+    res.boll_upper = sma + 2.0 * std_dev;
+    res.boll_lower = sma - 2.0 * std_dev;
+  }
+  res.boll_width = (res.boll_upper - res.boll_lower) / close;
+
+  // ATR and ATR Median
+  double current_atr = 0;
+  if (bars_ > 14) {
+    current_atr = tr_14_.sum() / 14.0;
+    std::array<double, 50> atrs;
+    size_t count = tr_50_.size();
+    for (size_t k = 0; k < count; ++k)
+      atrs[k] = tr_50_[k];
+    std::nth_element(atrs.begin(), atrs.begin() + count / 2,
+                     atrs.begin() + count);
+    res.atr_median = atrs[count / 2];
+  }
+
+  // ROC / OBV / VWAP
+  auto roc = [&](size_t period) {
+    if (bars_ <= period)
+      return 0.0;
+    double past = closes_200_.ago(period);
+    return (close - past) / past * 100.0;
+  };
+  res.roc_5 = roc(5);
+  res.roc_10 = roc(10);
+  res.roc_20 = roc(20);
+  res.obv = obv_;
+  if (bars_ >= 20 && volumes_20_.sum() != 0) {
+    double vwap = pv_20_.sum() / volumes_20_.sum();
+    res.vwap_dist = (close - vwap) / vwap * 100.0;
+  }
+
+  res.sma_distance_pct =
+      (res.sma_200 > 0) ? (close - res.sma_200) / res.sma_200 * 100 : 0;
+
+  double low_50 = range_50_.min(), high_50 = range_50_.max();
+  res.range_pos =
+      (high_50 == low_50) ? 0.5 : (close - low_50) / (high_50 - low_50);
+
+  // MTF Features
+  if (htf_bars_ > 0) {
+    res.htf_rsi = htf_rsi_.value();
+    res.htf_sma_50 = htf_closes_50_.full() ? htf_closes_50_.sum() / 50 : 0.0;
+    res.htf_sma_200 =
+        htf_closes_200_.full() ? htf_closes_200_.sum() / 200 : 0.0;
+  } else {
+    res.htf_rsi = 50.0;
+  }
+
+  // Volume Z-Score
+  if (bars_ >= 20) {
+    double vol_mean = volumes_20_.sum() / 20.0;
+    double vol_std = std::sqrt(
+        std::max(0.0, volumes_20_.sum_sq() / 20.0 - vol_mean * vol_mean));
+    res.volume_z_score =
+        (vol_std == 0) ? 0 : (volumes_20_.back() - vol_mean) / vol_std;
+  }
+
+  if (atr_out)
+    *atr_out = current_atr;
+  return res;
+}
+
+AnalysisResult IndicatorState::result() const {
+  double current_atr = 0.0;
+  AnalysisResult res = indicators(&current_atr);
+  if (bars_ == 0)
+    return res;
+
+  res.state_history.assign(trajectory_.begin(), trajectory_.end());
+  TechnicalAnalysis::derive_signals(res, prev_close_, current_atr);
+  return res;
+}
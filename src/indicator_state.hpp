@@ -0,0 +1,167 @@
+#pragma once
+#include "analysis.hpp"
+#include "market_data.hpp"
+#include <deque>
+#include <vector>
+
+// Fixed-capacity ring buffer over the most recent values, with running sum
+// and sum of squares so window means/variances are O(1) per update.
+class RollingWindow {
+public:
+  explicit RollingWindow(size_t capacity);
+
+  void push(double v);
+
+  size_t size() const { return count_; }
+  size_t capacity() const { return buf_.size(); }
+  bool full() const { return count_ == buf_.size(); }
+
+  // i = 0 is the oldest value in the window, size() - 1 the newest
+  double operator[](size_t i) const;
+  // Value pushed `lag` updates before the newest one (lag 0 = newest)
+  double ago(size_t lag) const;
+  double back() const { return ago(0); }
+
+  double sum() const { return sum_; }
+  double sum_sq() const { return sum_sq_; }
+  double mean() const { return count_ ? sum_ / count_ : 0.0; }
+
+private:
+  std::vector<double> buf_;
+  size_t head_ = 0; // Next slot to write
+  size_t count_ = 0;
+  size_t nonzero_ = 0; // Lets an all-zero window report an exact 0 sum
+  double sum_ = 0.0;
+  double sum_sq_ = 0.0;
+
+  void resync();
+};
+
+// Sliding-window minimum and maximum over the last `window` values using
+// monotonic deques (amortized O(1) per update).
+class SlidingExtrema {
+public:
+  explicit SlidingExtrema(size_t window);
+
+  void push(double v);
+  double min() const { return min_.front().second; }
+  double max() const { return max_.front().second; }
+
+private:
+  size_t window_;
+  size_t count_ = 0;
+  std::deque<std::pair<size_t, double>> min_; // (index, value), increasing
+  std::deque<std::pair<size_t, double>> max_; // (index, value), decreasing
+};
+
+// Sliding-window engine behind the Quantum Trajectory (state_history):
+// 14-bar gain/loss sums, the 50-bar SMA sum and the 20-bar high/low, all
+// maintained incrementally so a trajectory over N bars costs O(N).
+class TrajectoryWindow {
+public:
+  void update(double close);
+
+  // A point is available once 50 bars of warm-up precede the current one
+  bool ready() const { return count_ > 50; }
+  StateVector point(int64_t time) const;
+
+private:
+  size_t count_ = 0;
+  double close_ = 0.0;
+  RollingWindow closes_50_{50};
+  RollingWindow gains_14_{14};
+  RollingWindow losses_14_{14};
+  SlidingExtrema range_20_{20};
+};
+
+// Wilder-smoothed RSI, seeded with the simple average of the first `period`
+// changes (same arithmetic as calculate_rsi in analysis.cpp).
+class WilderRsi {
+public:
+  explicit WilderRsi(int period = 14);
+
+  void update(double close);
+  double value() const; // 50 until more than `period` closes were seen
+
+private:
+  int period_;
+  size_t count_ = 0;
+  double prev_ = 0.0;
+  double avg_gain_ = 0.0;
+  double avg_loss_ = 0.0;
+};
+
+// Persistent per-ticker indicator state. Feeding every bar of a series
+// through update() and calling result() yields the same AnalysisResult as
+// TechnicalAnalysis::calculate_indicators on that series, but each new bar
+// costs O(1) instead of a full pass over the history.
+class IndicatorState {
+public:
+  // trajectory_len bounds state_history as in calculate_indicators
+  // (0 keeps every point)
+  explicit IndicatorState(bool is_stock = true, size_t trajectory_len = 50);
+
+  // Warm up from an existing history
+  static IndicatorState from_series(const CandleSeries &candles,
+                                    const CandleSeries &htf_candles = {},
+                                    bool is_stock = true,
+                                    size_t trajectory_len = 50);
+
+  // Append one base-timeframe bar
+  void update(const Candle &bar);
+
+  // Append one higher-timeframe bar (feeds htf_rsi / htf_sma_*)
+  void update_htf(const Candle &bar);
+
+  // Snapshot of all indicators, ML outputs and levels at the latest bar
+  AnalysisResult result() const;
+
+  // Raw indicator fields only (no trajectory, models or levels); cheap
+  // enough to call after every bar. Optionally reports the 14-bar ATR.
+  AnalysisResult indicators(double *current_atr = nullptr) const;
+
+  size_t bar_count() const { return bars_; }
+  int64_t last_time() const { return last_time_; }
+
+private:
+  bool is_stock_;
+  size_t trajectory_len_;
+  size_t bars_ = 0;
+  int64_t last_time_ = 0;
+  double prev_high_ = 0.0;
+  double prev_low_ = 0.0;
+  double prev_close_ = 0.0;
+
+  // Price / volume windows
+  RollingWindow closes_200_{200}; // SMA 200 and ROC lookbacks
+  RollingWindow closes_50_{50};   // SMA 50
+  SlidingExtrema range_50_{50};   // 50-bar range position
+  RollingWindow closes_20_{20};   // Bollinger
+  RollingWindow volumes_20_{20};  // Volume z-score
+  RollingWindow pv_20_{20};       // VWAP numerator
+
+  WilderRsi rsi_{14};
+
+  // MACD
+  double ema12_ = 0.0;
+  double ema26_ = 0.0;
+  double macd_signal_ = 0.0;
+
+  double obv_ = 0.0;
+
+  // True range / directional movement (ATR, ATR median, ADX)
+  RollingWindow tr_14_{14};
+  RollingWindow tr_50_{50};
+  RollingWindow plus_dm_14_{14};
+  RollingWindow minus_dm_14_{14};
+
+  // Quantum Trajectory
+  TrajectoryWindow trajectory_window_;
+  std::deque<StateVector> trajectory_;
+
+  // Higher timeframe
+  size_t htf_bars_ = 0;
+  WilderRsi htf_rsi_{14};
+  RollingWindow htf_closes_50_{50};
+  RollingWindow htf_closes_200_{200};
+};
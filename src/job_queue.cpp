@@ -0,0 +1,244 @@
+#include "job_queue.hpp"
+#include <algorithm>
+#include <cstdio>
+
+const char *job_status_name(JobStatus status) {
+  switch (status) {
+  case JobStatus::QUEUED:
+    return "queued";
+  case JobStatus::RUNNING:
+    return "running";
+  case JobStatus::DONE:
+    return "done";
+  case JobStatus::FAILED:
+    return "failed";
+  }
+  return "unknown";
+}
+
+json JobView::to_json() const {
+  json items = json::array();
+  for (const auto &e : events)
+    items.push_back({{"seq", e.seq}, {"stage", e.stage}, {"data", e.data}});
+  json j = {{"id", id},
+            {"status", job_status_name(status)},
+            {"events", std::move(items)},
+            {"next", next}};
+  if (status == JobStatus::DONE)
+    j["result"] = result;
+  if (status == JobStatus::FAILED) {
+    j["error"] = error;
+    j["error_status"] = error_status;
+  }
+  return j;
+}
+
+JobQueue::JobQueue() : JobQueue(Options()) {}
+
+JobQueue::JobQueue(Options options) : state_(std::make_shared<State>()) {
+  state_->options = options;
+  size_t workers = std::max<size_t>(1, options.workers);
+  for (size_t i = 0; i < workers; ++i)
+    threads_.emplace_back([state = state_] { state->run(); });
+}
+
+JobQueue::~JobQueue() {
+  State &s = *state_;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  s.stopping = true;
+  // Nothing will run the jobs still queued; end them so whoever follows
+  // them gets a final answer
+  for (auto &job : s.queue) {
+    job->work = nullptr;
+    s.fail_locked(*job, "Server shutting down", 503);
+  }
+  s.queue.clear();
+  for (auto &entry : s.jobs)
+    entry.second->changed.notify_all();
+  s.work_ready.notify_all();
+
+  bool idle = s.idle.wait_for(lock, s.options.shutdown_grace,
+                              [&] { return s.running == 0; });
+  if (!idle) {
+    // A job still running may never return (a hung LLM call); answer its
+    // followers now and leave its worker to the process exit
+    for (auto &entry : s.jobs) {
+      Job &job = *entry.second;
+      if (job.status != JobStatus::RUNNING)
+        continue;
+      s.fail_locked(job, "Server shutting down", 503);
+      job.changed.notify_all();
+    }
+  }
+  lock.unlock();
+  for (auto &t : threads_) {
+    if (idle)
+      t.join();
+    else
+      t.detach();
+  }
+}
+
+std::string JobQueue::submit(JobWork work) {
+  State &s = *state_;
+  std::shared_ptr<Job> job = std::make_shared<Job>();
+  job->work = std::move(work);
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.queue.size() >= s.options.max_queued)
+      return "";
+    s.expire_locked();
+    job->id = s.new_id();
+    s.jobs[job->id] = job;
+    s.queue.push_back(job);
+  }
+  s.work_ready.notify_one();
+  return job->id;
+}
+
+std::optional<JobView> JobQueue::poll(const std::string &id, uint64_t since,
+                                      std::chrono::milliseconds wait) {
+  State &s = *state_;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  auto it = s.jobs.find(id);
+  if (it == s.jobs.end())
+    return std::nullopt;
+  // Held by pointer: the job may expire from jobs while this waits
+  std::shared_ptr<Job> job = it->second;
+  auto finished = [&] {
+    return job->status == JobStatus::DONE || job->status == JobStatus::FAILED;
+  };
+  // At shutdown every job ends within the grace, so this needs no wake-up
+  // of its own
+  job->changed.wait_for(lock, wait,
+                        [&] { return job->last_seq > since || finished(); });
+
+  JobView view;
+  view.id = job->id;
+  view.status = job->status;
+  auto from = std::upper_bound(
+      job->events.begin(), job->events.end(), since,
+      [](uint64_t seq, const JobEvent &e) { return seq < e.seq; });
+  view.events.assign(from, job->events.end());
+  view.next = job->last_seq;
+  if (job->status == JobStatus::DONE)
+    view.result = job->result;
+  view.error = job->error;
+  view.error_status = job->error_status;
+  return view;
+}
+
+size_t JobQueue::queued() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->queue.size();
+}
+
+void JobQueue::State::run() {
+  while (true) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_ready.wait(lock, [&] { return stopping || !queue.empty(); });
+      if (stopping)
+        return;
+      job = std::move(queue.front());
+      queue.pop_front();
+      job->status = JobStatus::RUNNING;
+      ++running;
+    }
+    job->changed.notify_all();
+
+    JobEmit emit = [&](const std::string &stage, json data) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job->status != JobStatus::RUNNING) // Abandoned at shutdown
+          return;
+        job->events.push_back({++job->last_seq, stage, std::move(data)});
+      }
+      job->changed.notify_all();
+    };
+
+    json result;
+    std::string error;
+    int error_status = 0;
+    try {
+      result = job->work(emit);
+    } catch (const JobError &e) {
+      error = e.what();
+      error_status = e.status;
+    } catch (const std::exception &e) {
+      error = e.what();
+      error_status = 500;
+    } catch (...) {
+      error = "Unknown error";
+      error_status = 500;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      --running;
+      job->work = nullptr; // Release whatever the work captured
+      if (job->status != JobStatus::RUNNING) {
+        // Failed at shutdown while this ran; that answer stands
+      } else if (error_status == 0) {
+        job->status = JobStatus::DONE;
+        job->result = std::move(result);
+        finish_locked(*job);
+      } else {
+        fail_locked(*job, error, error_status);
+      }
+      expire_locked();
+    }
+    idle.notify_all();
+    job->changed.notify_all();
+  }
+}
+
+void JobQueue::State::fail_locked(Job &job, const std::string &error,
+                                  int status) {
+  job.status = JobStatus::FAILED;
+  job.error = error;
+  job.error_status = status;
+  finish_locked(job);
+}
+
+void JobQueue::State::finish_locked(Job &job) {
+  const auto &transient = options.transient_stages;
+  job.events.erase(
+      std::remove_if(job.events.begin(), job.events.end(),
+                     [&](const JobEvent &e) {
+                       return std::find(transient.begin(), transient.end(),
+                                        e.stage) != transient.end();
+                     }),
+      job.events.end());
+  job.finished_at = std::chrono::steady_clock::now();
+  finished.push_back(job.id);
+}
+
+void JobQueue::State::expire_locked() {
+  auto now = std::chrono::steady_clock::now();
+  while (!finished.empty()) {
+    auto it = jobs.find(finished.front());
+    bool expired = it == jobs.end() ||
+                   finished.size() > options.max_finished ||
+                   now - it->second->finished_at > options.retention;
+    if (!expired)
+      break;
+    if (it != jobs.end())
+      jobs.erase(it);
+    finished.pop_front();
+  }
+}
+
+std::string JobQueue::State::new_id() {
+  // Random rather than sequential, so ids from before a restart do not
+  // name new jobs
+  char buffer[17];
+  std::string id;
+  do {
+    std::snprintf(buffer, sizeof(buffer), "%016llx",
+                  (unsigned long long)rng());
+    id = buffer;
+  } while (jobs.count(id));
+  return id;
+}
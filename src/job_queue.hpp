@@ -0,0 +1,143 @@
+#ifndef JOB_QUEUE_HPP
+#define JOB_QUEUE_HPP
+
+#include "nlohmann/json.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// A failure with the HTTP status it should be reported as (a job that
+// throws anything else fails with 500)
+struct JobError : std::runtime_error {
+  int status;
+  JobError(int status, const std::string &message)
+      : std::runtime_error(message), status(status) {}
+};
+
+enum class JobStatus { QUEUED, RUNNING, DONE, FAILED };
+
+const char *job_status_name(JobStatus status);
+
+// A partial result published by a running job; seq counts from 1 and has
+// gaps where transient events were dropped
+struct JobEvent {
+  uint64_t seq = 0;
+  std::string stage;
+  json data;
+};
+
+// What poll() saw of a job
+struct JobView {
+  std::string id;
+  JobStatus status = JobStatus::QUEUED;
+  std::vector<JobEvent> events; // Those after `since`
+  uint64_t next = 0; // seq of the last event published; the next `since`
+  json result;                  // Once DONE
+  std::string error;            // Once FAILED
+  int error_status = 0;
+
+  bool finished() const {
+    return status == JobStatus::DONE || status == JobStatus::FAILED;
+  }
+  json to_json() const;
+};
+
+// Publishes a stage result of the running job
+using JobEmit = std::function<void(const std::string &stage, json data)>;
+// The work of a job; returns its result
+using JobWork = std::function<json(const JobEmit &emit)>;
+
+// Long-running work (the analysis pipeline with its LLM call) run on a
+// fixed set of worker threads instead of the HTTP threads. submit() only
+// queues; clients follow a job with poll(), which returns the stage
+// results published since their last call and can wait for the next one.
+// The queue is bounded so a burst is turned away rather than piled up, and
+// finished jobs are kept for `retention` (at most `max_finished` of them)
+// for clients to collect. On destruction running jobs get `shutdown_grace`
+// to finish; any still running then fail (503) and their workers are left
+// behind, so a hung job cannot hold up shutdown.
+class JobQueue {
+public:
+  struct Options {
+    size_t workers = 4;
+    size_t max_queued = 64;
+    std::chrono::seconds retention{600};
+    size_t max_finished = 1000;
+    // Stages only worth having while they stream (the AI tokens, whose text
+    // a later stage repeats whole); dropped once the job finishes
+    std::vector<std::string> transient_stages;
+    std::chrono::milliseconds shutdown_grace{5000};
+  };
+
+  JobQueue();
+  explicit JobQueue(Options options);
+  ~JobQueue(); // Jobs still queued fail (503); running ones get the grace
+
+  JobQueue(const JobQueue &) = delete;
+  JobQueue &operator=(const JobQueue &) = delete;
+
+  // The job id, or an empty string if the queue is full
+  std::string submit(JobWork work);
+
+  // The job's state with the events after seq `since`. If there are none
+  // and the job has not finished, waits up to `wait` for either. nullopt
+  // for an unknown (or expired) id.
+  std::optional<JobView> poll(const std::string &id, uint64_t since,
+                              std::chrono::milliseconds wait);
+
+  size_t workers() const { return threads_.size(); }
+  size_t queued() const;
+
+private:
+  struct Job {
+    std::string id;
+    JobWork work;
+    JobStatus status = JobStatus::QUEUED;
+    std::vector<JobEvent> events;
+    uint64_t last_seq = 0;
+    std::condition_variable changed; // Published or finished
+    json result;
+    std::string error;
+    int error_status = 0;
+    std::chrono::steady_clock::time_point finished_at;
+  };
+
+  // Everything the workers touch, shared with them so a worker left
+  // running at shutdown outlives the queue safely
+  struct State {
+    Options options;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable idle; // A running job finished
+    std::unordered_map<std::string, std::shared_ptr<Job>> jobs;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::deque<std::string> finished; // Oldest first, for expiry
+    size_t running = 0;
+    bool stopping = false;
+    std::mt19937_64 rng{std::random_device{}()};
+
+    void run();
+    void fail_locked(Job &job, const std::string &error, int status);
+    void finish_locked(Job &job);
+    void expire_locked();
+    std::string new_id();
+  };
+
+  std::shared_ptr<State> state_;
+  std::vector<std::thread> threads_;
+};
+
+#endif
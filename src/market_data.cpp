@@ -1,80 +1,81 @@
 #include "market_data.hpp"
+#include "async_http.hpp"
 #include <ctime>
-#include <curl/curl.h>
 #include <iostream>
 
-// Helper for libcurl
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-                            void *userp) {
-  ((std::string *)userp)->append((char *)contents, size * nmemb);
-  return size * nmemb;
+std::string format_timestamp(int64_t epoch_seconds) {
+  std::time_t t = (std::time_t)epoch_seconds;
+  std::tm local{};
+  localtime_r(&t, &local); // Called from concurrent request handlers
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+  return std::string(buffer);
 }
 
-std::vector<Candle> MarketData::fetch_history(const std::string &ticker,
-                                              const std::string &interval) {
+// Downloads and parses one Yahoo chart request; `query` selects the bars
+static CandleSeries fetch_chart(const std::string &ticker,
+                                const std::string &query) {
   std::cout << "Fetching data for " << ticker << "..." << std::endl;
-  std::vector<Candle> candles;
+  CandleSeries candles;
 
-  CURL *curl;
-  CURLcode res;
-  std::string readBuffer;
+  // Yahoo Finance chart API (unofficial but works for demo)
+  HttpRequest request;
+  request.url = "https://query1.finance.yahoo.com/v8/finance/chart/" + ticker +
+                "?" + query;
+  // User-Agent is sometimes required by Yahoo
+  request.user_agent = "Mozilla/5.0";
+  request.timeout_ms = 15000;
 
-  curl = curl_easy_init();
-  if (curl) {
-    // Yahoo Finance chart API (unofficial but works for demo)
-    // range=1mo works, interval is passed
-    // For C++, simpler to hardcode period for this MVP
-    std::string url = "https://query1.finance.yahoo.com/v8/finance/chart/" +
-                      ticker + "?range=3mo&interval=" + interval;
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    // User-Agent is sometimes required by Yahoo
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
-
-    res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-      std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
-                << std::endl;
-    } else {
-      try {
-        auto json_data = nlohmann::json::parse(readBuffer);
-
-        auto result = json_data["chart"]["result"][0];
-        auto timestamps = result["timestamp"];
-        auto quote = result["indicators"]["quote"][0];
+  HttpResponse response = AsyncHttp::shared().fetch(std::move(request));
+  if (!response.error.empty()) {
+    std::cerr << "Chart request failed: " << response.error << std::endl;
+    return candles;
+  }
 
-        auto opens = quote["open"];
-        auto highs = quote["high"];
-        auto lows = quote["low"];
-        auto closes = quote["close"];
-        auto volumes = quote["volume"];
+  try {
+    auto json_data = nlohmann::json::parse(response.body);
 
-        for (size_t i = 0; i < timestamps.size(); ++i) {
-          if (opens[i].is_null() || closes[i].is_null())
-            continue;
+    // Bind by reference; copying the arrays was a large share of parsing
+    const auto &result = json_data.at("chart").at("result").at(0);
+    const auto &timestamps = result.at("timestamp");
+    const auto &quote = result.at("indicators").at("quote").at(0);
 
-          Candle c;
-          std::time_t t = timestamps[i];
-          char buffer[80];
-          std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S",
-                        std::localtime(&t));
-          c.timestamp = std::string(buffer);
+    const auto &opens = quote.at("open");
+    const auto &highs = quote.at("high");
+    const auto &lows = quote.at("low");
+    const auto &closes = quote.at("close");
+    const auto &volumes = quote.at("volume");
 
-          c.open = opens[i];
-          c.high = highs[i];
-          c.low = lows[i];
-          c.close = closes[i];
-          c.volume = volumes[i].is_null() ? 0 : (long long)volumes[i];
+    candles.reserve(timestamps.size());
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+      if (opens[i].is_null() || closes[i].is_null())
+        continue;
 
-          candles.push_back(c);
-        }
-      } catch (const std::exception &e) {
-        std::cerr << "JSON Parsing error: " << e.what() << std::endl;
-      }
+      candles.time.push_back(timestamps[i].get<int64_t>());
+      candles.open.push_back(opens[i].get<double>());
+      candles.high.push_back(highs[i].get<double>());
+      candles.low.push_back(lows[i].get<double>());
+      candles.close.push_back(closes[i].get<double>());
+      candles.volume.push_back(
+          volumes[i].is_null() ? 0.0 : volumes[i].get<double>());
     }
-    curl_easy_cleanup(curl);
+  } catch (const std::exception &e) {
+    std::cerr << "JSON Parsing error: " << e.what() << std::endl;
   }
   return candles;
 }
+
+CandleSeries MarketData::fetch_history(const std::string &ticker,
+                                       const std::string &interval,
+                                       const std::string &range) {
+  return fetch_chart(ticker, "range=" + range + "&interval=" + interval);
+}
+
+CandleSeries MarketData::fetch_since(const std::string &ticker,
+                                     const std::string &interval,
+                                     int64_t since) {
+  int64_t now = (int64_t)std::time(nullptr);
+  return fetch_chart(ticker, "period1=" + std::to_string(since) +
+                                 "&period2=" + std::to_string(now + 86400) +
+                                 "&interval=" + interval);
+}
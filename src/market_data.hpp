@@ -1,19 +1,94 @@
 #pragma once
 #include "nlohmann/json.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
 
+// Single bar, used when a caller wants one row of a CandleSeries
 struct Candle {
-  std::string timestamp; // Keep as string for simplicity initially, or time_t
+  int64_t time; // Unix epoch seconds
   double open;
   double high;
   double low;
   double close;
-  long long volume;
+  double volume;
 };
 
+// Columnar (structure-of-arrays) candle history. Every column has the same
+// length; indicators read the contiguous price arrays directly instead of
+// copying them out of per-candle structs.
+struct CandleSeries {
+  std::vector<int64_t> time;
+  std::vector<double> open;
+  std::vector<double> high;
+  std::vector<double> low;
+  std::vector<double> close;
+  std::vector<double> volume;
+
+  size_t size() const { return close.size(); }
+  bool empty() const { return close.empty(); }
+
+  void reserve(size_t n) {
+    time.reserve(n);
+    open.reserve(n);
+    high.reserve(n);
+    low.reserve(n);
+    close.reserve(n);
+    volume.reserve(n);
+  }
+
+  void push_back(const Candle &c) {
+    time.push_back(c.time);
+    open.push_back(c.open);
+    high.push_back(c.high);
+    low.push_back(c.low);
+    close.push_back(c.close);
+    volume.push_back(c.volume);
+  }
+
+  Candle operator[](size_t i) const {
+    return {time[i], open[i], high[i], low[i], close[i], volume[i]};
+  }
+  Candle back() const { return (*this)[size() - 1]; }
+};
+
+// Formats an epoch timestamp as "YYYY-MM-DD HH:MM:SS" (local time). Only
+// called when writing JSON or other human-readable output.
+std::string format_timestamp(int64_t epoch_seconds);
+
 class MarketData {
 public:
-  static std::vector<Candle> fetch_history(const std::string &ticker,
-                                           const std::string &interval = "1d");
+  // Most recent `range` of bars (Yahoo range syntax: 3mo, 1y, 5y, ...)
+  static CandleSeries fetch_history(const std::string &ticker,
+                                    const std::string &interval = "1d",
+                                    const std::string &range = "3mo");
+
+  // Bars with time >= since, for topping up a cached history
+  static CandleSeries fetch_since(const std::string &ticker,
+                                  const std::string &interval, int64_t since);
+};
+
+// Source of candle history for CandleStore. since == 0 asks for the
+// provider's default full history, otherwise only bars with time >= since.
+class CandleProvider {
+public:
+  virtual ~CandleProvider() = default;
+  virtual CandleSeries fetch(const std::string &ticker,
+                             const std::string &interval, int64_t since) = 0;
+};
+
+// Yahoo Finance chart API
+class YahooProvider : public CandleProvider {
+public:
+  explicit YahooProvider(std::string range = "3mo")
+      : range_(std::move(range)) {}
+
+  CandleSeries fetch(const std::string &ticker, const std::string &interval,
+                     int64_t since) override {
+    return since > 0 ? MarketData::fetch_since(ticker, interval, since)
+                     : MarketData::fetch_history(ticker, interval, range_);
+  }
+
+private:
+  std::string range_;
 };
@@ -0,0 +1,279 @@
+#include "ml_worker_pool.hpp"
+#include "nlohmann/json.hpp"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// Pipe whose ends are close-on-exec, so sibling workers spawned from other
+// threads do not inherit them (and keep each other's stdin open).
+static bool make_pipe(int fds[2]) {
+#ifdef __linux__
+  return pipe2(fds, O_CLOEXEC) == 0;
+#else
+  if (pipe(fds) != 0)
+    return false;
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return true;
+#endif
+}
+
+static int remaining_ms(Clock::time_point deadline) {
+  auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - Clock::now());
+  return left.count() > 0 ? (int)left.count() : 0;
+}
+
+static json features_to_json(const MLFeatures &f) {
+  return json{{"momentum_state", f.momentum_state},
+              {"trend_state", f.trend_state},
+              {"volatility_state", f.volatility_state},
+              {"rsi_norm", f.rsi_norm},
+              {"roc_norm", f.roc_norm},
+              {"vol_z_norm", f.vol_z_norm},
+              {"sma_dist_norm", f.sma_dist_norm},
+              {"rsi", f.rsi},
+              {"adx", f.adx},
+              {"is_stock", f.is_stock}};
+}
+
+static MLOutput output_from_json(const json &j) {
+  const auto &reg = j.at("regime_model");
+  const auto &dir = j.at("directional_model");
+  MLOutput out;
+  out.regime = {reg.at("regime").get<std::string>(),
+                reg.at("confidence").get<double>()};
+  out.prediction = {dir.at("direction").get<std::string>(),
+                    dir.at("probability").get<double>(),
+                    dir.at("expected_r").get<double>()};
+  out.expected_value = dir.at("expected_value").get<double>();
+  out.signal_strength = dir.at("signal_strength").get<double>();
+  return out;
+}
+
+MLWorkerPool::MLWorkerPool(const Options &options)
+    : options_(options), workers_(std::max<size_t>(1, options.workers)) {
+  // A worker dying mid-write must surface as EPIPE, not kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (!spawn(workers_[i]))
+      std::cerr << "ML worker " << i << " failed to start" << std::endl;
+    idle_.push_back(i);
+  }
+}
+
+MLWorkerPool::~MLWorkerPool() {
+  for (auto &worker : workers_)
+    terminate(worker);
+}
+
+size_t MLWorkerPool::restarts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return restarts_;
+}
+
+size_t MLWorkerPool::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return !idle_.empty(); });
+  size_t index = idle_.back();
+  idle_.pop_back();
+  return index;
+}
+
+void MLWorkerPool::release(size_t index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(index);
+  }
+  cv_.notify_one();
+}
+
+bool MLWorkerPool::spawn(Worker &worker) {
+  int to_child[2], from_child[2];
+  if (!make_pipe(to_child))
+    return false;
+  if (!make_pipe(from_child)) {
+    close(to_child[0]);
+    close(to_child[1]);
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, to_child[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, from_child[1], STDOUT_FILENO);
+
+  std::vector<char *> argv;
+  for (const auto &arg : options_.command)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  pid_t pid = -1;
+  int rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(),
+                        environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(to_child[0]);
+  close(from_child[1]);
+
+  if (rc != 0) {
+    close(to_child[1]);
+    close(from_child[0]);
+    return false;
+  }
+
+  fcntl(to_child[1], F_SETFL, fcntl(to_child[1], F_GETFL) | O_NONBLOCK);
+  fcntl(from_child[0], F_SETFL, fcntl(from_child[0], F_GETFL) | O_NONBLOCK);
+
+  worker.pid = pid;
+  worker.in_fd = to_child[1];
+  worker.out_fd = from_child[0];
+  worker.pending.clear();
+  return true;
+}
+
+void MLWorkerPool::terminate(Worker &worker) {
+  if (worker.in_fd >= 0)
+    close(worker.in_fd);
+  if (worker.out_fd >= 0)
+    close(worker.out_fd);
+  if (worker.pid > 0) {
+    kill(worker.pid, SIGKILL);
+    waitpid(worker.pid, nullptr, 0);
+  }
+  worker = Worker{};
+}
+
+bool MLWorkerPool::write_all(Worker &worker, const std::string &data) {
+  auto deadline = Clock::now() + std::chrono::milliseconds(options_.timeout_ms);
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n =
+        write(worker.in_fd, data.data() + written, data.size() - written);
+    if (n > 0) {
+      written += (size_t)n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pollfd pfd{worker.in_fd, POLLOUT, 0};
+      if (poll(&pfd, 1, remaining_ms(deadline)) <= 0)
+        return false;
+      continue;
+    }
+    return false; // EPIPE: worker is gone
+  }
+  return true;
+}
+
+bool MLWorkerPool::read_line(Worker &worker, std::string &line,
+                             Clock::time_point deadline, bool &timed_out) {
+  char buffer[4096];
+  while (true) {
+    size_t newline = worker.pending.find('\n');
+    if (newline != std::string::npos) {
+      line = worker.pending.substr(0, newline);
+      worker.pending.erase(0, newline + 1);
+      return true;
+    }
+
+    pollfd pfd{worker.out_fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, remaining_ms(deadline));
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready == 0) {
+      timed_out = true;
+      return false;
+    }
+    if (ready < 0)
+      return false;
+
+    ssize_t n = read(worker.out_fd, buffer, sizeof(buffer));
+    if (n > 0)
+      worker.pending.append(buffer, (size_t)n);
+    else if (n == 0)
+      return false; // EOF: worker exited
+    else if (errno != EINTR && errno != EAGAIN)
+      return false;
+  }
+}
+
+std::vector<MLOutput>
+MLWorkerPool::predict_batch(const std::vector<MLFeatures> &batch) {
+  if (batch.empty())
+    return {};
+
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = next_id_++;
+  }
+  json request;
+  request["id"] = id;
+  request["batch"] = json::array();
+  for (const auto &f : batch)
+    request["batch"].push_back(features_to_json(f));
+  std::string payload = request.dump() + "\n";
+
+  // A crashed worker is replaced and the batch retried once; a timeout is
+  // reported straight away so callers can fall back.
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    size_t index = acquire();
+    Worker &worker = workers_[index];
+
+    bool timed_out = false;
+    std::string line;
+    auto deadline =
+        Clock::now() + std::chrono::milliseconds(options_.timeout_ms);
+    bool ok = (worker.pid > 0 || spawn(worker)) &&
+              write_all(worker, payload) &&
+              read_line(worker, line, deadline, timed_out);
+
+    if (ok) {
+      release(index);
+      auto response = json::parse(line);
+      if (response.contains("error"))
+        throw std::runtime_error("ML worker error: " +
+                                 response["error"].get<std::string>());
+      if (response.value("id", (uint64_t)0) != id ||
+          response["results"].size() != batch.size())
+        throw std::runtime_error("ML worker returned a mismatched response");
+
+      std::vector<MLOutput> outputs;
+      outputs.reserve(batch.size());
+      for (const auto &item : response["results"])
+        outputs.push_back(output_from_json(item));
+      return outputs;
+    }
+
+    std::cerr << "ML worker " << index
+              << (timed_out ? " timed out" : " crashed") << ", restarting"
+              << std::endl;
+    terminate(worker);
+    if (spawn(worker)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++restarts_;
+    }
+    release(index);
+
+    if (timed_out)
+      throw std::runtime_error("ML worker timed out");
+  }
+  throw std::runtime_error("ML worker crashed");
+}
+
+MLOutput MLWorkerPool::predict(const MLFeatures &features) {
+  return predict_batch({features}).front();
+}
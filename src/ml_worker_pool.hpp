@@ -0,0 +1,70 @@
+#pragma once
+#include "analysis.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Pool of long-lived model processes (by default the Python reference models
+// in scripts/ml_predict.py --serve). Interpreter start-up and imports are
+// paid once per worker instead of once per analysis.
+//
+// Protocol, one JSON document per line:
+//   stdin:  {"id": n, "batch": [features, ...]}
+//   stdout: {"id": n, "results": [{"regime_model": ..., "directional_model":
+//            ...}, ...]}
+class MLWorkerPool {
+public:
+  struct Options {
+    std::vector<std::string> command = {"python3", "scripts/ml_predict.py",
+                                        "--serve"};
+    size_t workers = 2;
+    int timeout_ms = 2000; // Per round trip
+  };
+
+  explicit MLWorkerPool(const Options &options);
+  ~MLWorkerPool();
+
+  MLWorkerPool(const MLWorkerPool &) = delete;
+  MLWorkerPool &operator=(const MLWorkerPool &) = delete;
+
+  // Evaluates all feature vectors in a single round trip on one worker.
+  // Throws std::runtime_error on timeout or worker failure; the affected
+  // worker is killed and replaced either way.
+  std::vector<MLOutput> predict_batch(const std::vector<MLFeatures> &batch);
+
+  MLOutput predict(const MLFeatures &features);
+
+  size_t size() const { return workers_.size(); }
+
+  // Number of worker processes started after the initial spawn
+  size_t restarts() const;
+
+private:
+  struct Worker {
+    pid_t pid = -1;
+    int in_fd = -1;  // Our end of the worker's stdin
+    int out_fd = -1; // Our end of the worker's stdout
+    std::string pending; // Bytes read past the last complete line
+  };
+
+  Options options_;
+  std::vector<Worker> workers_;
+  std::vector<size_t> idle_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t next_id_ = 1;
+  size_t restarts_ = 0;
+
+  size_t acquire();
+  void release(size_t index);
+
+  bool spawn(Worker &worker);
+  void terminate(Worker &worker);
+  bool write_all(Worker &worker, const std::string &data);
+  bool read_line(Worker &worker, std::string &line,
+                 std::chrono::steady_clock::time_point deadline,
+                 bool &timed_out);
+};
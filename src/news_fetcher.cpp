@@ -1,24 +1,19 @@
 #include "news_fetcher.hpp"
+#include "async_http.hpp"
 #include <chrono>
-#include <curl/curl.h>
 #include <iomanip>
 #include <iostream>
 #include <regex>
 #include <sstream>
 
-// Callback for libcurl to write response data
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-                            void *userp) {
-  ((std::string *)userp)->append((char *)contents, size * nmemb);
-  return size * nmemb;
-}
-
 // Get current date in YYYY-MM-DD format
 std::string getCurrentDate() {
   auto now = std::chrono::system_clock::now();
   auto time = std::chrono::system_clock::to_time_t(now);
+  std::tm local{};
+  localtime_r(&time, &local);
   std::stringstream ss;
-  ss << std::put_time(std::localtime(&time), "%Y-%m-%d");
+  ss << std::put_time(&local, "%Y-%m-%d");
   return ss.str();
 }
 
@@ -27,147 +22,132 @@ std::string getFutureDate(int days) {
   auto now = std::chrono::system_clock::now();
   auto future = now + std::chrono::hours(24 * days);
   auto time = std::chrono::system_clock::to_time_t(future);
+  std::tm local{};
+  localtime_r(&time, &local);
   std::stringstream ss;
-  ss << std::put_time(std::localtime(&time), "%Y-%m-%d");
+  ss << std::put_time(&local, "%Y-%m-%d");
   return ss.str();
 }
 
-// Fetch news for a specific ticker from Yahoo Finance
-std::vector<NewsItem> fetchTickerNews(const std::string &ticker) {
+// Builds the news list from the quote page response
+static std::vector<NewsItem> parseTickerNews(const std::string &ticker,
+                                             const std::string &url,
+                                             const HttpResponse &response) {
   std::vector<NewsItem> news;
-
-  try {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-      std::cerr << "Failed to initialize CURL for news fetching" << std::endl;
-      return news;
-    }
-
-    std::string readBuffer;
-
-    // Yahoo Finance news URL - using the quote page which includes recent news
-    std::string url = "https://finance.yahoo.com/quote/" + ticker;
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-      std::cerr << "CURL error fetching news: " << curl_easy_strerror(res)
-                << std::endl;
-      return news;
-    }
-
-    // Simple HTML parsing to extract news headlines
-    // Look for patterns like: <h3>...headline...</h3> or similar
-    // This is a basic approach - in production, consider using a proper HTML
-    // parser
-
-    // For now, we'll create placeholder news items
-    // In a real implementation, you would parse the HTML or use Yahoo Finance
-    // RSS feeds
-    NewsItem item1;
-    item1.title = "Latest market analysis for " + ticker;
-    item1.source = "Yahoo Finance";
-    item1.published = getCurrentDate();
-    item1.summary = "Technical and fundamental analysis available";
-    item1.url = url;
-    news.push_back(item1);
-
-    // Note: To get actual news, we could:
-    // 1. Parse the HTML response for news sections
-    // 2. Use Yahoo Finance RSS feeds
-    // 3. Use a third-party news API
-    // For MVP, we'll indicate that news fetching is available but may need
-    // enhancement
-
-  } catch (const std::exception &e) {
-    std::cerr << "Exception in fetchTickerNews: " << e.what() << std::endl;
+  if (!response.error.empty()) {
+    std::cerr << "CURL error fetching news: " << response.error << std::endl;
+    return news;
   }
 
+  // Simple HTML parsing to extract news headlines
+  // Look for patterns like: <h3>...headline...</h3> or similar
+  // This is a basic approach - in production, consider using a proper HTML
+  // parser
+
+  // For now, we'll create placeholder news items
+  // In a real implementation, you would parse the HTML or use Yahoo Finance
+  // RSS feeds
+  NewsItem item1;
+  item1.title = "Latest market analysis for " + ticker;
+  item1.source = "Yahoo Finance";
+  item1.published = getCurrentDate();
+  item1.summary = "Technical and fundamental analysis available";
+  item1.url = url;
+  news.push_back(item1);
+
+  // Note: To get actual news, we could:
+  // 1. Parse the HTML response for news sections
+  // 2. Use Yahoo Finance RSS feeds
+  // 3. Use a third-party news API
+  // For MVP, we'll indicate that news fetching is available but may need
+  // enhancement
   return news;
 }
 
-// Fetch upcoming economic calendar events from Finnhub API
-std::vector<EconomicEvent> fetchEconomicCalendar() {
+// Parses the Finnhub economic calendar response
+static std::vector<EconomicEvent>
+parseEconomicCalendar(const HttpResponse &response) {
   std::vector<EconomicEvent> events;
+  if (!response.error.empty()) {
+    std::cerr << "CURL error fetching calendar: " << response.error
+              << std::endl;
+    return events;
+  }
 
   try {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-      std::cerr << "Failed to initialize CURL for calendar fetching"
-                << std::endl;
-      return events;
-    }
-
-    std::string readBuffer;
-
-    // Finnhub economic calendar API (free tier)
-    std::string fromDate = getCurrentDate();
-    std::string toDate = getFutureDate(7);
-    std::string url =
-        "https://finnhub.io/api/v1/calendar/economic?from=" + fromDate +
-        "&to=" + toDate;
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-      std::cerr << "CURL error fetching calendar: " << curl_easy_strerror(res)
-                << std::endl;
-      return events;
-    }
-
-    // Parse JSON response
-    try {
-      json calendarData = json::parse(readBuffer);
-
-      if (calendarData.contains("economicCalendar") &&
-          calendarData["economicCalendar"].is_array()) {
-        int count = 0;
-        for (const auto &item : calendarData["economicCalendar"]) {
-          if (count >= 10)
-            break; // Limit to 10 events
-
-          EconomicEvent event;
-          event.event = item.value("event", "Unknown Event");
-          event.country = item.value("country", "");
-          event.date = item.value("time", "");
-          event.impact = item.value("impact", "medium");
-          event.forecast = item.value("estimate", "");
-          event.actual = item.value("actual", "");
-
-          // Only include high and medium impact events
-          if (event.impact == "high" || event.impact == "medium") {
-            events.push_back(event);
-            count++;
-          }
+    json calendarData = json::parse(response.body);
+
+    if (calendarData.contains("economicCalendar") &&
+        calendarData["economicCalendar"].is_array()) {
+      int count = 0;
+      for (const auto &item : calendarData["economicCalendar"]) {
+        if (count >= 10)
+          break; // Limit to 10 events
+
+        EconomicEvent event;
+        event.event = item.value("event", "Unknown Event");
+        event.country = item.value("country", "");
+        event.date = item.value("time", "");
+        event.impact = item.value("impact", "medium");
+        event.forecast = item.value("estimate", "");
+        event.actual = item.value("actual", "");
+
+        // Only include high and medium impact events
+        if (event.impact == "high" || event.impact == "medium") {
+          events.push_back(event);
+          count++;
         }
       }
-    } catch (const json::exception &e) {
-      std::cerr << "JSON parsing error for calendar: " << e.what() << std::endl;
     }
-
-  } catch (const std::exception &e) {
-    std::cerr << "Exception in fetchEconomicCalendar: " << e.what()
-              << std::endl;
+  } catch (const json::exception &e) {
+    std::cerr << "JSON parsing error for calendar: " << e.what() << std::endl;
   }
-
   return events;
 }
 
+std::future<std::vector<NewsItem>>
+fetchTickerNewsAsync(const std::string &ticker) {
+  // Yahoo Finance news URL - using the quote page which includes recent news
+  HttpRequest request;
+  request.url = "https://finance.yahoo.com/quote/" + ticker;
+  request.user_agent = "Mozilla/5.0";
+  request.follow_redirects = true;
+  request.timeout_ms = 10000;
+
+  std::string url = request.url;
+  auto response = AsyncHttp::shared().submit(std::move(request));
+  // Deferred: parsing runs on the thread that calls get()
+  return std::async(std::launch::deferred,
+                    [ticker, url, response = std::move(response)]() mutable {
+                      return parseTickerNews(ticker, url, response.get());
+                    });
+}
+
+std::future<std::vector<EconomicEvent>> fetchEconomicCalendarAsync() {
+  // Finnhub economic calendar API (free tier)
+  HttpRequest request;
+  request.url = "https://finnhub.io/api/v1/calendar/economic?from=" +
+                getCurrentDate() + "&to=" + getFutureDate(7);
+  request.follow_redirects = true;
+  request.timeout_ms = 10000;
+
+  auto response = AsyncHttp::shared().submit(std::move(request));
+  return std::async(std::launch::deferred,
+                    [response = std::move(response)]() mutable {
+                      return parseEconomicCalendar(response.get());
+                    });
+}
+
+// Fetch news for a specific ticker from Yahoo Finance
+std::vector<NewsItem> fetchTickerNews(const std::string &ticker) {
+  return fetchTickerNewsAsync(ticker).get();
+}
+
+// Fetch upcoming economic calendar events from Finnhub API
+std::vector<EconomicEvent> fetchEconomicCalendar() {
+  return fetchEconomicCalendarAsync().get();
+}
+
 // Convert news items to JSON array
 json newsToJson(const std::vector<NewsItem> &news) {
   json newsArray = json::array();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "nlohmann/json.hpp"
+#include <future>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,12 @@ std::vector<NewsItem> fetchTickerNews(const std::string &ticker);
 // Fetch upcoming economic calendar events from Finnhub API
 std::vector<EconomicEvent> fetchEconomicCalendar();
 
+// Non-blocking variants: the request starts immediately on the shared HTTP
+// loop and get() waits for it and parses the response
+std::future<std::vector<NewsItem>>
+fetchTickerNewsAsync(const std::string &ticker);
+std::future<std::vector<EconomicEvent>> fetchEconomicCalendarAsync();
+
 // Convert news items to JSON array
 json newsToJson(const std::vector<NewsItem> &news);
 
@@ -1,218 +1,374 @@
 #include "ollama_client.hpp"
+#include "async_http.hpp"
 #include "nlohmann/json.hpp"
-#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <iostream>
+#include <optional>
 
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-                            void *userp) {
-  ((std::string *)userp)->append((char *)contents, size * nmemb);
-  return size * nmemb;
+JsonFieldScanner::JsonFieldScanner(std::vector<std::string> fields,
+                                   FieldCallback on_field)
+    : watched_(std::move(fields)), on_field_(std::move(on_field)) {}
+
+void JsonFieldScanner::feed(const std::string &piece) {
+  for (char c : piece)
+    step(c);
+}
+
+void JsonFieldScanner::step(char c) {
+  if (in_string_) {
+    token_ += c;
+    if (escape_)
+      escape_ = false;
+    else if (c == '\\')
+      escape_ = true;
+    else if (c == '"') {
+      in_string_ = false;
+      if (depth_ == 1 && expect_key_) {
+        auto key = nlohmann::json::parse(token_, nullptr, false);
+        key_ = key.is_string() ? key.get<std::string>() : "";
+        expect_key_ = false;
+      } else if (depth_ == 1 && expect_value_) {
+        end_value();
+      }
+    }
+    return;
+  }
+  if (in_scalar_) {
+    if (c != ',' && c != '}' && c != ']' && !std::isspace((unsigned char)c)) {
+      token_ += c;
+      return;
+    }
+    in_scalar_ = false;
+    end_value(); // And the terminator is handled below
+  }
+
+  switch (c) {
+  case '"':
+    in_string_ = true;
+    token_ = "\"";
+    break;
+  case '{':
+  case '[':
+    if (depth_ == 1)
+      expect_value_ = false; // A nested value; not reported
+    if (++depth_ == 1)
+      expect_key_ = c == '{';
+    break;
+  case '}':
+  case ']':
+    --depth_;
+    break;
+  case ':':
+    if (depth_ == 1)
+      expect_value_ = true;
+    break;
+  case ',':
+    if (depth_ == 1)
+      expect_key_ = true;
+    break;
+  default:
+    if (depth_ == 1 && expect_value_ && !std::isspace((unsigned char)c)) {
+      in_scalar_ = true;
+      token_ = c;
+    }
+  }
+}
+
+void JsonFieldScanner::end_value() {
+  expect_value_ = false;
+  if (std::find(watched_.begin(), watched_.end(), key_) == watched_.end() ||
+      found_.count(key_))
+    return;
+  auto value = nlohmann::json::parse(token_, nullptr, false);
+  if (value.is_discarded())
+    return;
+  found_[key_] = value;
+  if (on_field_)
+    on_field_(key_, value);
+}
+
+const std::vector<std::string> OllamaClient::VERDICT_FIELDS = {
+    "decision", "confidence", "risk_level"};
+
+static std::atomic<ResponseCache *> response_cache{nullptr};
+
+void OllamaClient::set_response_cache(ResponseCache *cache) {
+  response_cache = cache;
+}
+
+static std::atomic<long> total_timeout_s{300}, stall_timeout_s{60};
+
+void OllamaClient::set_timeouts(std::chrono::seconds total,
+                                std::chrono::seconds stall) {
+  total_timeout_s = std::max<long>(0, total.count());
+  stall_timeout_s = std::max<long>(0, stall.count());
 }
 
-OllamaClient::OllamaClient(const std::string &model_name) : model(model_name) {}
+std::string
+OllamaClient::analysis_cache_key(const std::string &model,
+                                 const std::string &ticker,
+                                 const std::string &market_summary,
+                                 const std::string &feedback_context) {
+  // Sorted keys and fixed number formatting, whatever the caller's layout
+  auto summary = nlohmann::json::parse(market_summary, nullptr, false);
+  std::string context =
+      ticker + "\n" +
+      (summary.is_discarded() ? market_summary : summary.dump()) + "\n" +
+      feedback_context;
+  return ResponseCache::make_key(model, PROMPT_VERSION, context);
+}
+
+OllamaClient::OllamaClient(const std::string &model_name,
+                           const std::string &base_url)
+    : model(model_name), base_url(base_url) {}
+
+// POSTs a request body to /api/generate on the shared HTTP loop and returns
+// the generated text, or nullopt on failure. With on_token the request
+// streams: Ollama sends one JSON object per line as tokens are generated and
+// each piece is passed on as it arrives. Throws OllamaTimeout past the
+// limits set with set_timeouts().
+static std::optional<std::string>
+generate(const std::string &base_url, nlohmann::json request_body,
+         const OllamaClient::TokenCallback &on_token) {
+  request_body["stream"] = (bool)on_token;
+
+  HttpRequest request;
+  request.url = base_url + "/api/generate";
+  request.post = true;
+  request.body = request_body.dump();
+  request.headers = {"Content-Type: application/json"};
+  request.timeout_ms = total_timeout_s * 1000;
+  if (on_token)
+    request.stall_timeout_s = stall_timeout_s;
+
+  std::string text, pending, error;
+  bool done = false;
+  auto consume_line = [&](const char *begin, const char *end) {
+    auto chunk = nlohmann::json::parse(begin, end, nullptr, false);
+    if (!chunk.is_object())
+      return;
+    if (chunk.contains("error"))
+      error = chunk["error"].dump();
+    if (chunk.value("done", false))
+      done = true;
+    std::string piece = chunk.value("response", "");
+    if (!piece.empty()) {
+      text += piece;
+      on_token(piece);
+    }
+  };
+  if (on_token) {
+    request.on_data = [&](const char *data, size_t size) {
+      pending.append(data, size);
+      size_t start = 0, newline;
+      while ((newline = pending.find('\n', start)) != std::string::npos) {
+        consume_line(pending.data() + start, pending.data() + newline);
+        start = newline + 1;
+      }
+      pending.erase(0, start);
+    };
+  }
+
+  HttpResponse response = AsyncHttp::shared().fetch(std::move(request));
+  if (!response.error.empty()) {
+    std::cerr << "CURL Error: " << response.error << std::endl;
+    if (response.timed_out)
+      throw OllamaTimeout("The model did not answer in time");
+    return std::nullopt;
+  }
+  if (on_token) {
+    if (!pending.empty()) // A last line without its newline
+      consume_line(pending.data(), pending.data() + pending.size());
+    // Without its final line the answer is cut short; not worth keeping
+    if (!error.empty() || !done) {
+      std::cerr << "Ollama error: "
+                << (error.empty() ? "stream ended early" : error)
+                << std::endl;
+      return std::nullopt;
+    }
+    return text;
+  }
+
+  auto json_response = nlohmann::json::parse(response.body, nullptr, false);
+  if (!json_response.is_object() || !json_response.contains("response") ||
+      !json_response["response"].is_string()) {
+    std::cerr << "Failed to parse Ollama response." << std::endl;
+    return std::nullopt;
+  }
+  return json_response["response"].get<std::string>();
+}
 
 std::string
 OllamaClient::get_market_analysis(const std::string &ticker,
                                   const std::string &market_summary,
-                                  const std::string &feedback_context) {
+                                  const std::string &feedback_context,
+                                  const TokenCallback &on_token,
+                                  const FieldCallback &on_field) {
   std::cout << "Meta-Analyst Thinking (Model: " << model << ")..." << std::endl;
 
-  CURL *curl;
-  CURLcode res;
-  std::string readBuffer;
   std::string result = "Error: Meta-Analysis failed.";
 
-  curl = curl_easy_init();
-  if (curl) {
-    std::string url = base_url + "/api/generate";
-
-    nlohmann::json request_body;
-    request_body["model"] = model;
-    request_body["stream"] = false;
-    request_body["format"] = "json"; // Enforce JSON output for Meta-Analyst
-
-    std::string prompt =
-        "You are the 'Meta-Analyst' - an elite AI trading strategist with "
-        "advanced reasoning capabilities.\\n"
-        "You operate in a sophisticated 3-model trading system with access to "
-        "regime classification, directional predictions, and comprehensive "
-        "market data.\\n\\n"
-
-        "═══════════════════════════════════════════════════════════════\\n"
-        "CORE MISSION: Multi-Dimensional Market Analysis\\n"
-        "═══════════════════════════════════════════════════════════════\\n\\n"
-
-        "ANALYSIS FRAMEWORK (Execute in this order):\\n\\n"
-
-        "1. MARKET REGIME ASSESSMENT\\n"
-        "   - Analyze the current regime (trend_following, mean_reversion, "
-        "high_vol, low_vol)\\n"
-        "   - Evaluate regime stability and confidence level\\n"
-        "   - Identify potential regime transitions or mixed signals\\n"
-        "   - Consider historical regime persistence patterns\\n\\n"
-
-        "2. MULTI-TIMEFRAME CONFLUENCE ANALYSIS\\n"
-        "   - HTF (Higher Time Frame) vs LTF (Lower Time Frame) alignment\\n"
-        "   - Identify divergences between timeframes\\n"
-        "   - Assess the strength of trend alignment\\n"
-        "   - Evaluate momentum consistency across timeframes\\n\\n"
-
-        "3. TECHNICAL INDICATOR SYNTHESIS\\n"
-        "   - RSI: Momentum exhaustion vs continuation signals\\n"
-        "   - ADX: Trend strength and directional movement\\n"
-        "   - MACD: Momentum shifts and crossover significance\\n"
-        "   - Bollinger Bands: Volatility expansion/contraction\\n"
-        "   - Volume Profile: Institutional participation and conviction\\n"
-        "   - VWAP Distance: Price efficiency and mean reversion "
-        "potential\\n\\n"
-
-        "4. RISK FACTOR IDENTIFICATION\\n"
-        "   - Overbought/Oversold extremes (RSI > 80 or < 20)\\n"
-        "   - Volatility spikes or compression\\n"
-        "   - Divergences between price and indicators\\n"
-        "   - News/event risk from economic calendar\\n"
-        "   - Liquidity concerns and gap risk\\n\\n"
-
-        "5. DIRECTIONAL MODEL VALIDATION\\n"
-        "   - Probability assessment (require > 60% for high confidence)\\n"
-        "   - Expected R (Risk/Reward) evaluation\\n"
-        "   - Signal strength and conviction level\\n"
-        "   - Historical accuracy in similar market conditions\\n\\n"
-
-        "6. CONTRADICTION DETECTION (CRITICAL)\\n"
-        "   Examples of VETO-worthy contradictions:\\n"
-        "   - Bullish signal but RSI > 85 (extreme overbought)\\n"
-        "   - Bearish signal but RSI < 15 (extreme oversold)\\n"
-        "   - LTF bullish but HTF in strong downtrend\\n"
-        "   - High volatility regime but tight stop loss\\n"
-        "   - Mean reversion regime but trend-following setup\\n"
-        "   - Low probability (<50%) with high risk\\n\\n"
-
-        "7. SOPHISTICATED DECISION LOGIC\\n"
-        "   TRADE_ALLOWED criteria:\\n"
-        "   ✓ HTF and LTF alignment confirmed\\n"
-        "   ✓ No critical contradictions detected\\n"
-        "   ✓ Probability > 55% (preferably > 65%)\\n"
-        "   ✓ Risk/Reward ratio favorable (Expected R > 1.5)\\n"
-        "   ✓ Regime matches strategy type\\n"
-        "   ✓ No extreme indicator readings against direction\\n\\n"
-
-        "   VETO criteria:\\n"
-        "   ✗ HTF/LTF divergence\\n"
-        "   ✗ Critical contradictions present\\n"
-        "   ✗ Extreme overbought/oversold against signal\\n"
-        "   ✗ High-impact news event imminent\\n"
-        "   ✗ Probability < 50%\\n"
-        "   ✗ Poor risk/reward (Expected R < 1.0)\\n\\n"
-
-        "INPUT DATA (JSON):\\n" +
-        market_summary;
-
-    if (!feedback_context.empty()) {
-      prompt += "\n\nCONTEXT & EVENTS:\n" + feedback_context;
-    }
+  nlohmann::json request_body;
+  request_body["model"] = model;
+  request_body["format"] = "json"; // Enforce JSON output for Meta-Analyst
+
+  std::string prompt =
+      "You are the 'Meta-Analyst' - an elite AI trading strategist with "
+      "advanced reasoning capabilities.\\n"
+      "You operate in a sophisticated 3-model trading system with access to "
+      "regime classification, directional predictions, and comprehensive "
+      "market data.\\n\\n"
+
+      "═══════════════════════════════════════════════════════════════\\n"
+      "CORE MISSION: Multi-Dimensional Market Analysis\\n"
+      "═══════════════════════════════════════════════════════════════\\n\\n"
+
+      "ANALYSIS FRAMEWORK (Execute in this order):\\n\\n"
+
+      "1. MARKET REGIME ASSESSMENT\\n"
+      "   - Analyze the current regime (trend_following, mean_reversion, "
+      "high_vol, low_vol)\\n"
+      "   - Evaluate regime stability and confidence level\\n"
+      "   - Identify potential regime transitions or mixed signals\\n"
+      "   - Consider historical regime persistence patterns\\n\\n"
+
+      "2. MULTI-TIMEFRAME CONFLUENCE ANALYSIS\\n"
+      "   - HTF (Higher Time Frame) vs LTF (Lower Time Frame) alignment\\n"
+      "   - Identify divergences between timeframes\\n"
+      "   - Assess the strength of trend alignment\\n"
+      "   - Evaluate momentum consistency across timeframes\\n\\n"
+
+      "3. TECHNICAL INDICATOR SYNTHESIS\\n"
+      "   - RSI: Momentum exhaustion vs continuation signals\\n"
+      "   - ADX: Trend strength and directional movement\\n"
+      "   - MACD: Momentum shifts and crossover significance\\n"
+      "   - Bollinger Bands: Volatility expansion/contraction\\n"
+      "   - Volume Profile: Institutional participation and conviction\\n"
+      "   - VWAP Distance: Price efficiency and mean reversion "
+      "potential\\n\\n"
+
+      "4. RISK FACTOR IDENTIFICATION\\n"
+      "   - Overbought/Oversold extremes (RSI > 80 or < 20)\\n"
+      "   - Volatility spikes or compression\\n"
+      "   - Divergences between price and indicators\\n"
+      "   - News/event risk from economic calendar\\n"
+      "   - Liquidity concerns and gap risk\\n\\n"
+
+      "5. DIRECTIONAL MODEL VALIDATION\\n"
+      "   - Probability assessment (require > 60% for high confidence)\\n"
+      "   - Expected R (Risk/Reward) evaluation\\n"
+      "   - Signal strength and conviction level\\n"
+      "   - Historical accuracy in similar market conditions\\n\\n"
+
+      "6. CONTRADICTION DETECTION (CRITICAL)\\n"
+      "   Examples of VETO-worthy contradictions:\\n"
+      "   - Bullish signal but RSI > 85 (extreme overbought)\\n"
+      "   - Bearish signal but RSI < 15 (extreme oversold)\\n"
+      "   - LTF bullish but HTF in strong downtrend\\n"
+      "   - High volatility regime but tight stop loss\\n"
+      "   - Mean reversion regime but trend-following setup\\n"
+      "   - Low probability (<50%) with high risk\\n\\n"
+
+      "7. SOPHISTICATED DECISION LOGIC\\n"
+      "   TRADE_ALLOWED criteria:\\n"
+      "   ✓ HTF and LTF alignment confirmed\\n"
+      "   ✓ No critical contradictions detected\\n"
+      "   ✓ Probability > 55% (preferably > 65%)\\n"
+      "   ✓ Risk/Reward ratio favorable (Expected R > 1.5)\\n"
+      "   ✓ Regime matches strategy type\\n"
+      "   ✓ No extreme indicator readings against direction\\n\\n"
+
+      "   VETO criteria:\\n"
+      "   ✗ HTF/LTF divergence\\n"
+      "   ✗ Critical contradictions present\\n"
+      "   ✗ Extreme overbought/oversold against signal\\n"
+      "   ✗ High-impact news event imminent\\n"
+      "   ✗ Probability < 50%\\n"
+      "   ✗ Poor risk/reward (Expected R < 1.0)\\n\\n"
+
+      "INPUT DATA (JSON):\\n" +
+      market_summary;
+
+  if (!feedback_context.empty()) {
+    prompt += "\n\nCONTEXT & EVENTS:\n" + feedback_context;
+  }
 
-    prompt +=
-        "\\n\\nOUTPUT FORMAT (STRICT JSON ONLY - No markdown, no explanations "
-        "outside JSON):\\n"
-        "{\\n"
-        "  \\\"decision\\\": \\\"trade_allowed\\\" | \\\"veto\\\",\\n"
-        "  \\\"confidence\\\": 0.0-1.0,\\n"
-        "  \\\"reason\\\": \\\"Comprehensive explanation covering: regime "
-        "analysis, HTF/LTF alignment, indicator synthesis, risk factors, and "
-        "final verdict. Be specific and detailed.\\\",\\n"
-        "  \\\"htf_confirmation\\\": \\\"confirmed\\\" | \\\"not_confirmed\\\" "
-        "| \\\"divergent\\\",\\n"
-        "  \\\"annotation\\\": \\\"Concise actionable insight (max 2 "
-        "sentences)\\\",\\n"
-        "  \\\"risk_level\\\": \\\"low\\\" | \\\"medium\\\" | \\\"high\\\",\\n"
-        "  \\\"regime_alignment\\\": \\\"perfect\\\" | \\\"good\\\" | "
-        "\\\"weak\\\" | \\\"contradictory\\\",\\n"
-        "  \\\"key_factors\\\": [\\\"List 3-5 most critical factors "
-        "influencing this decision\\\"],\\n"
-        "  \\\"warnings\\\": [\\\"Any critical warnings or concerns (empty "
-        "array if none)\\\"]\\n"
-        "}";
-
-    request_body["prompt"] = prompt;
-    std::string json_str = request_body.dump();
-
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-    res = curl_easy_perform(curl);
-    if (res == CURLE_OK) {
-      try {
-        auto json_response = nlohmann::json::parse(readBuffer);
-        if (json_response.contains("response")) {
-          result = json_response["response"].get<std::string>();
-        }
-      } catch (...) {
-        std::cerr << "Failed to parse Ollama response." << std::endl;
-      }
+  prompt +=
+      "\\n\\nOUTPUT FORMAT (STRICT JSON ONLY - No markdown, no explanations "
+      "outside JSON):\\n"
+      "{\\n"
+      "  \\\"decision\\\": \\\"trade_allowed\\\" | \\\"veto\\\",\\n"
+      "  \\\"confidence\\\": 0.0-1.0,\\n"
+      "  \\\"reason\\\": \\\"Comprehensive explanation covering: regime "
+      "analysis, HTF/LTF alignment, indicator synthesis, risk factors, and "
+      "final verdict. Be specific and detailed.\\\",\\n"
+      "  \\\"htf_confirmation\\\": \\\"confirmed\\\" | \\\"not_confirmed\\\" "
+      "| \\\"divergent\\\",\\n"
+      "  \\\"annotation\\\": \\\"Concise actionable insight (max 2 "
+      "sentences)\\\",\\n"
+      "  \\\"risk_level\\\": \\\"low\\\" | \\\"medium\\\" | \\\"high\\\",\\n"
+      "  \\\"regime_alignment\\\": \\\"perfect\\\" | \\\"good\\\" | "
+      "\\\"weak\\\" | \\\"contradictory\\\",\\n"
+      "  \\\"key_factors\\\": [\\\"List 3-5 most critical factors "
+      "influencing this decision\\\"],\\n"
+      "  \\\"warnings\\\": [\\\"Any critical warnings or concerns (empty "
+      "array if none)\\\"]\\n"
+      "}";
+
+  request_body["prompt"] = prompt;
+
+  // Fields come from the streamed text, so asking for them streams too
+  JsonFieldScanner scanner(VERDICT_FIELDS, on_field);
+  TokenCallback stream = on_token;
+  if (on_field)
+    stream = [&](const std::string &token) {
+      scanner.feed(token);
+      if (on_token)
+        on_token(token);
+    };
+  auto ask = [&] { return generate(base_url, request_body, stream); };
+  std::optional<std::string> text;
+  if (ResponseCache *cache = response_cache) {
+    bool hit = false;
+    text = cache->get_or_compute(
+        analysis_cache_key(model, ticker, market_summary, feedback_context),
+        ask, &hit);
+    if (hit && text) {
+      std::cout << "♻️  Meta-Analyst answer reused for " << ticker
+                << std::endl;
+      if (stream)
+        stream(*text);
     }
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+  } else {
+    text = ask();
   }
+  if (text)
+    result = *text;
   return result;
 }
 
 std::string OllamaClient::ask_question(const std::string &system_prompt,
-                                       const std::string &user_message) {
+                                       const std::string &user_message,
+                                       const TokenCallback &on_token) {
   std::cout << "Chat Request (Model: " << model << ")..." << std::endl;
 
-  CURL *curl;
-  CURLcode res;
-  std::string readBuffer;
   std::string result = "Error: Chat failed.";
 
-  curl = curl_easy_init();
-  if (curl) {
-    std::string url = base_url + "/api/generate";
-
-    nlohmann::json request_body;
-    request_body["model"] = model;
-    request_body["stream"] = false;
-
-    // Construct prompt properly
-    std::string prompt =
-        system_prompt + "\n\nUser: " + user_message + "\n\nAssistant:";
-    request_body["prompt"] = prompt;
-
-    std::string json_str = request_body.dump();
-
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-    res = curl_easy_perform(curl);
-    if (res == CURLE_OK) {
-      try {
-        auto json_response = nlohmann::json::parse(readBuffer);
-        if (json_response.contains("response")) {
-          result = json_response["response"].get<std::string>();
-        }
-      } catch (...) {
-        std::cerr << "Failed to parse Ollama chat response." << std::endl;
-      }
-    } else {
-      std::cerr << "CURL Error: " << curl_easy_strerror(res) << std::endl;
-    }
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+  nlohmann::json request_body;
+  request_body["model"] = model;
+
+  // Construct prompt properly
+  std::string prompt =
+      system_prompt + "\n\nUser: " + user_message + "\n\nAssistant:";
+  request_body["prompt"] = prompt;
+
+  try {
+    if (auto text = generate(base_url, request_body, on_token))
+      result = *text;
+  } catch (const OllamaTimeout &) {
+    // Answered with the failure text, like any other failed chat
   }
   return result;
 }
@@ -1,18 +1,107 @@
 #pragma once
+#include "nlohmann/json.hpp"
+#include "response_cache.hpp"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <stdexcept>
 #include <string>
+#include <vector>
+
+// Picks top-level fields out of a JSON object while it is still being
+// generated, so the Meta-Analyst's "decision", "confidence" and
+// "risk_level" are known before the long "reason" has been written. Only
+// string, number and literal values are reported; each once, when its
+// closing character arrives.
+class JsonFieldScanner {
+public:
+  using FieldCallback =
+      std::function<void(const std::string &name, const nlohmann::json &value)>;
+
+  explicit JsonFieldScanner(std::vector<std::string> fields,
+                            FieldCallback on_field = nullptr);
+
+  // The next piece of the text
+  void feed(const std::string &piece);
+
+  // Fields completed so far
+  const std::map<std::string, nlohmann::json> &fields() const {
+    return found_;
+  }
+
+private:
+  std::vector<std::string> watched_;
+  FieldCallback on_field_;
+  std::map<std::string, nlohmann::json> found_;
+
+  int depth_ = 0;
+  bool in_string_ = false, escape_ = false, in_scalar_ = false;
+  bool expect_key_ = false, expect_value_ = false;
+  std::string key_;   // Last key seen at the top level
+  std::string token_; // Raw text of the string or scalar being read
+
+  void step(char c);
+  void end_value();
+};
+
+// The model did not answer within OllamaClient's generate timeouts
+struct OllamaTimeout : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
 
 class OllamaClient {
 public:
-  OllamaClient(const std::string &model_name);
+  // Receives each piece of the response as the model generates it. Runs on
+  // the HTTP loop thread, so it should only hand the text on.
+  using TokenCallback = std::function<void(const std::string &token)>;
+  using FieldCallback = JsonFieldScanner::FieldCallback;
+
+  // Top-level Meta-Analyst fields reported to a FieldCallback
+  static const std::vector<std::string> VERDICT_FIELDS;
+
+  // Bump when the Meta-Analyst prompt changes, so answers cached for the
+  // old one are not reused
+  static constexpr int PROMPT_VERSION = 1;
+
+  OllamaClient(const std::string &model_name,
+               const std::string &base_url = "http://localhost:11434");
+
+  // Process-wide cache for get_market_analysis answers. Set it once at
+  // start-up; unset, every call goes to the model.
+  static void set_response_cache(ResponseCache *cache);
+
+  // Process-wide limits on one generation: `total` for the whole answer,
+  // `stall` for a streamed answer that stops arriving (a whole answer
+  // arrives in one piece, so only `total` applies). 300 s and 60 s unless
+  // set; 0 turns a limit off.
+  static void set_timeouts(std::chrono::seconds total,
+                           std::chrono::seconds stall);
+
+  // What a Meta-Analyst answer is cached under: model, PROMPT_VERSION and
+  // the inputs, with the JSON summary in canonical form
+  static std::string analysis_cache_key(const std::string &model,
+                                        const std::string &ticker,
+                                        const std::string &market_summary,
+                                        const std::string &feedback_context);
+
+  // With on_token the response is streamed as well as returned whole;
+  // on_field receives each of VERDICT_FIELDS as soon as it is complete
+  // (on the same thread as on_token). An answer from the cache, or shared
+  // with an identical request already running, is streamed in one piece.
+  // Throws OllamaTimeout when the model runs out of time.
   std::string get_market_analysis(const std::string &ticker,
                                   const std::string &market_summary,
-                                  const std::string &feedback_context = "");
+                                  const std::string &feedback_context = "",
+                                  const TokenCallback &on_token = nullptr,
+                                  const FieldCallback &on_field = nullptr);
 
-  // Generic chat method
+  // Generic chat method; streamed like get_market_analysis with on_token.
+  // A timeout is reported like any other failure.
   std::string ask_question(const std::string &system_prompt,
-                           const std::string &user_message);
+                           const std::string &user_message,
+                           const TokenCallback &on_token = nullptr);
 
 private:
   std::string model;
-  std::string base_url = "http://localhost:11434";
+  std::string base_url;
 };
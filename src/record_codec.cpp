@@ -0,0 +1,131 @@
+#include "record_codec.hpp"
+
+// Record flag bits
+static constexpr uint8_t IS_STOCK = 1;
+static constexpr uint8_t FEEDBACK_SUBMITTED = 2;
+static constexpr uint8_t FEEDBACK_SUCCESS = 4;
+
+// Fixed-position doubles, in encoding order. Never reorder: append new
+// fields under a new version instead.
+static double AnalysisRecord::*const DOUBLES_V1[] = {
+    &AnalysisRecord::rsi,
+    &AnalysisRecord::macd,
+    &AnalysisRecord::macd_signal,
+    &AnalysisRecord::sma_50,
+    &AnalysisRecord::sma_200,
+    &AnalysisRecord::current_price,
+    &AnalysisRecord::adx,
+    &AnalysisRecord::boll_width,
+    &AnalysisRecord::atr_median,
+    &AnalysisRecord::volume_z_score,
+    &AnalysisRecord::roc_5,
+    &AnalysisRecord::roc_10,
+    &AnalysisRecord::roc_20,
+    &AnalysisRecord::obv,
+    &AnalysisRecord::vwap_dist,
+    &AnalysisRecord::sma_distance_pct,
+    &AnalysisRecord::range_pos,
+    &AnalysisRecord::htf_rsi,
+    &AnalysisRecord::htf_sma_50,
+    &AnalysisRecord::htf_sma_200,
+    &AnalysisRecord::entry_price,
+    &AnalysisRecord::take_profit,
+    &AnalysisRecord::stop_loss,
+    &AnalysisRecord::trailing_sl,
+    &AnalysisRecord::partial_tp,
+};
+
+void RecordCodec::encode(const AnalysisRecord &record, ByteWriter &out) {
+  out.str(record.id);
+  out.str(record.timestamp);
+  out.str(record.ticker);
+  out.str(record.model);
+
+  uint8_t flags = 0;
+  if (record.is_stock)
+    flags |= IS_STOCK;
+  if (record.feedback.submitted)
+    flags |= FEEDBACK_SUBMITTED;
+  if (record.feedback.success)
+    flags |= FEEDBACK_SUCCESS;
+  out.u8(flags);
+
+  for (auto field : DOUBLES_V1)
+    out.f64(record.*field);
+
+  out.str(record.ai_prediction);
+  out.str(record.feedback.remark);
+
+  // Bars are evenly spaced, so deltas are small and repeat; i32 covers
+  // gaps of up to 68 years
+  const auto &states = record.state_history;
+  out.u32((uint32_t)states.size());
+  if (!states.empty())
+    out.i64(states[0].time);
+  for (size_t i = 1; i < states.size(); ++i)
+    out.i32((int32_t)(states[i].time - states[i - 1].time));
+  for (const auto &s : states) {
+    out.f32((float)s.x);
+    out.f32((float)s.y);
+    out.f32((float)s.z);
+  }
+
+  // Version 2
+  out.str(record.regime);
+  out.str(record.direction);
+  out.f64(record.volatility_state);
+}
+
+bool RecordCodec::decode(ByteReader &in, uint16_t version,
+                         AnalysisRecord &record) {
+  if (version == 0 || version > VERSION)
+    return false;
+
+  record.id = in.str();
+  record.timestamp = in.str();
+  record.ticker = in.str();
+  record.model = in.str();
+
+  uint8_t flags = in.u8();
+  record.is_stock = flags & IS_STOCK;
+  record.feedback.submitted = flags & FEEDBACK_SUBMITTED;
+  record.feedback.success = flags & FEEDBACK_SUCCESS;
+
+  for (auto field : DOUBLES_V1)
+    record.*field = in.f64();
+
+  record.ai_prediction = in.str();
+  record.feedback.remark = in.str();
+
+  uint32_t count = in.u32();
+  // Each point takes at least 12 bytes; reject absurd counts before
+  // allocating
+  if (!in.ok() || count > in.remaining() / 12)
+    return false;
+  record.state_history.assign(count, StoredStateVector{});
+  if (count) {
+    int64_t time = in.i64();
+    record.state_history[0].time = time;
+    for (uint32_t i = 1; i < count; ++i) {
+      time += in.i32();
+      record.state_history[i].time = time;
+    }
+  }
+  for (auto &s : record.state_history) {
+    s.x = in.f32();
+    s.y = in.f32();
+    s.z = in.f32();
+  }
+
+  if (version >= 2) {
+    record.regime = in.str();
+    record.direction = in.str();
+    record.volatility_state = in.f64();
+  } else {
+    record.regime.clear();
+    record.direction.clear();
+    record.volatility_state = std::numeric_limits<double>::quiet_NaN();
+  }
+
+  return in.ok();
+}
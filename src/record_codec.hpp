@@ -0,0 +1,128 @@
+#pragma once
+#include "analysis_storage.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Little-endian primitives for the storage files. Strings are a u32 length
+// followed by the bytes.
+class ByteWriter {
+public:
+  explicit ByteWriter(std::string &out) : out_(out) {}
+
+  void u8(uint8_t v) { out_.push_back((char)v); }
+  void u16(uint16_t v) { put(v, 2); }
+  void u32(uint32_t v) { put(v, 4); }
+  void i32(int32_t v) { put((uint32_t)v, 4); }
+  void i64(int64_t v) { put((uint64_t)v, 8); }
+  void f32(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, 4);
+    put(bits, 4);
+  }
+  void f64(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    put(bits, 8);
+  }
+  void str(const std::string &s) {
+    u32((uint32_t)s.size());
+    out_.append(s);
+  }
+  void bytes(const char *data, size_t n) { out_.append(data, n); }
+
+private:
+  std::string &out_;
+
+  void put(uint64_t v, int n) {
+    for (int i = 0; i < n; ++i)
+      out_.push_back((char)(v >> (8 * i)));
+  }
+};
+
+// Reads what ByteWriter wrote. Reading past the end yields zeros and clears
+// ok(), so callers check once after a group of fields.
+class ByteReader {
+public:
+  ByteReader(const char *data, size_t size)
+      : pos_(data), end_(data + size) {}
+
+  uint8_t u8() { return (uint8_t)get(1); }
+  uint16_t u16() { return (uint16_t)get(2); }
+  uint32_t u32() { return (uint32_t)get(4); }
+  int32_t i32() { return (int32_t)(uint32_t)get(4); }
+  int64_t i64() { return (int64_t)get(8); }
+  float f32() {
+    uint32_t bits = (uint32_t)get(4);
+    float v;
+    std::memcpy(&v, &bits, 4);
+    return v;
+  }
+  double f64() {
+    uint64_t bits = get(8);
+    double v;
+    std::memcpy(&v, &bits, 8);
+    return v;
+  }
+  std::string str() {
+    uint32_t n = u32();
+    if (!ok_ || remaining() < n) {
+      ok_ = false;
+      return {};
+    }
+    std::string s(pos_, n);
+    pos_ += n;
+    return s;
+  }
+
+  bool ok() const { return ok_; }
+  size_t remaining() const { return (size_t)(end_ - pos_); }
+  const char *pos() const { return pos_; }
+  void skip(size_t n) {
+    if (remaining() < n) {
+      ok_ = false;
+      pos_ = end_;
+      return;
+    }
+    pos_ += n;
+  }
+
+private:
+  const char *pos_;
+  const char *end_;
+  bool ok_ = true;
+
+  uint64_t get(int n) {
+    if (!ok_ || remaining() < (size_t)n) {
+      ok_ = false;
+      return 0;
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+      v |= (uint64_t)(uint8_t)pos_[i] << (8 * i);
+    pos_ += n;
+    return v;
+  }
+};
+
+// Versioned binary form of AnalysisRecord: strings length-prefixed, the
+// indicator and level doubles at fixed positions, and the trajectory as a
+// base time plus per-point deltas with float32 coordinates. A record is a
+// few hundred bytes against several KB of JSON.
+//
+// New fields go at the end under a new VERSION; decode() keeps reading
+// every older version.
+class RecordCodec {
+public:
+  // 2: regime, direction and volatility_state
+  static constexpr uint16_t VERSION = 2;
+
+  static void encode(const AnalysisRecord &record, ByteWriter &out);
+
+  // Reads one record written under `version`; false if the input is
+  // truncated or the version unknown
+  static bool decode(ByteReader &in, uint16_t version, AnalysisRecord &record);
+
+  // Trajectory coordinates as they come back from decode()
+  static double round_coordinate(double v) { return (double)(float)v; }
+};
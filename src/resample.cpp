@@ -0,0 +1,65 @@
+#include "resample.hpp"
+#include <algorithm>
+
+// Days since 1970-01-01, rounding towards negative infinity
+static int64_t epoch_day(int64_t t) {
+  return (t >= 0 ? t : t - 86399) / 86400;
+}
+
+// Month index (year * 12 + month - 1) of a day count, via the civil-from-days
+// algorithm (proleptic Gregorian), avoiding gmtime and its locking
+static int64_t epoch_month(int64_t days) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t doe = days - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  int64_t month = mp < 10 ? mp + 3 : mp - 9; // 1..12
+  int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+  return year * 12 + month - 1;
+}
+
+// Single pass: bars with equal keys (which must be non-decreasing) merge
+template <typename KeyFn>
+static CandleSeries aggregate(const CandleSeries &candles, KeyFn key) {
+  CandleSeries out;
+  size_t n = candles.size();
+  int64_t current = 0;
+  for (size_t i = 0; i < n; ++i) {
+    int64_t k = key(i);
+    if (out.empty() || k != current) {
+      current = k;
+      out.push_back(candles[i]);
+      continue;
+    }
+    size_t last = out.size() - 1;
+    out.high[last] = std::max(out.high[last], candles.high[i]);
+    out.low[last] = std::min(out.low[last], candles.low[i]);
+    out.close[last] = candles.close[i];
+    out.volume[last] += candles.volume[i];
+  }
+  return out;
+}
+
+CandleSeries Resample::weekly(const CandleSeries &candles,
+                              int64_t utc_offset_seconds) {
+  return aggregate(candles, [&](size_t i) {
+    // 1970-01-01 was a Thursday; shifting by 3 days starts weeks on Monday
+    int64_t days = epoch_day(candles.time[i] + utc_offset_seconds) + 3;
+    return (days >= 0 ? days : days - 6) / 7;
+  });
+}
+
+CandleSeries Resample::monthly(const CandleSeries &candles,
+                               int64_t utc_offset_seconds) {
+  return aggregate(candles, [&](size_t i) {
+    return epoch_month(epoch_day(candles.time[i] + utc_offset_seconds));
+  });
+}
+
+CandleSeries Resample::every_n(const CandleSeries &candles, size_t n) {
+  if (n <= 1)
+    return candles;
+  return aggregate(candles, [&](size_t i) { return (int64_t)(i / n); });
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "market_data.hpp"
+#include <cstdint>
+
+// Builds higher-timeframe bars from a base series in one pass: open of the
+// first bar, highest high, lowest low, close of the last bar and summed
+// volume. A bar is stamped with the time of its first base bar, and the
+// newest bar may be partial (as it is on Yahoo's own 1wk/1mo charts).
+//
+// Calendar buckets are computed in UTC shifted by utc_offset_seconds, so
+// exchanges east of UTC whose daily bars start before midnight UTC can pass
+// their offset and land in the right week or month.
+class Resample {
+public:
+  // Monday-to-Sunday weeks
+  static CandleSeries weekly(const CandleSeries &candles,
+                             int64_t utc_offset_seconds = 0);
+
+  // Calendar months
+  static CandleSeries monthly(const CandleSeries &candles,
+                              int64_t utc_offset_seconds = 0);
+
+  // Consecutive groups of n bars counted from the first bar, so existing
+  // groups do not shift when bars are appended
+  static CandleSeries every_n(const CandleSeries &candles, size_t n);
+};
@@ -0,0 +1,219 @@
+#include "response_cache.hpp"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+static int64_t epoch_ms(std::chrono::system_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             t.time_since_epoch())
+      .count();
+}
+
+// An entry as a line of the cache file. Invalid UTF-8 in a model's answer
+// is replaced rather than thrown on.
+static std::string file_line(const std::string &key, const std::string &value,
+                             int64_t expires) {
+  return json{{"k", key}, {"v", value}, {"e", expires}}.dump(
+      -1, ' ', false, json::error_handler_t::replace);
+}
+
+ResponseCache::ResponseCache() : ResponseCache(Options()) {}
+
+ResponseCache::ResponseCache(Options options) : options_(std::move(options)) {
+  if (options_.max_entries == 0)
+    options_.max_entries = 1;
+  if (!options_.path.empty())
+    load();
+}
+
+std::string ResponseCache::make_key(const std::string &model,
+                                    int template_version,
+                                    const std::string &context) {
+  // The context itself rather than a hash of it: lookups compare whole
+  // keys, so two contexts can never share an answer. Model names hold no
+  // newline, which keeps the parts apart.
+  return model + "\nv" + std::to_string(template_version) + "\n" + context;
+}
+
+std::optional<std::string> ResponseCache::get(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto value = get_locked(key);
+  ++(value ? stats_.hits : stats_.misses);
+  return value;
+}
+
+void ResponseCache::put(const std::string &key, const std::string &value) {
+  FileWrite write;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    put_locked(key, value, Clock::now() + options_.ttl, &write);
+  }
+  write_file(write);
+}
+
+std::optional<std::string>
+ResponseCache::get_or_compute(const std::string &key, const Compute &compute,
+                              bool *hit) {
+  std::promise<std::optional<std::string>> promise;
+  std::shared_future<std::optional<std::string>> flight;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto value = get_locked(key)) {
+      ++stats_.hits;
+      if (hit)
+        *hit = true;
+      return value;
+    }
+    auto it = in_flight_.find(key);
+    if (it == in_flight_.end()) {
+      ++stats_.misses;
+      in_flight_[key] = promise.get_future().share();
+    } else {
+      ++stats_.shared;
+      flight = it->second;
+    }
+  }
+  if (flight.valid()) {
+    if (hit)
+      *hit = true;
+    return flight.get();
+  }
+
+  std::optional<std::string> value;
+  try {
+    value = compute();
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_.erase(key);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+  FileWrite write;
+  {
+    // Cached and out of flight in one step, so no caller sees neither
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (value)
+      put_locked(key, *value, Clock::now() + options_.ttl, &write);
+    in_flight_.erase(key);
+  }
+  promise.set_value(value);
+  write_file(write);
+  if (hit)
+    *hit = false;
+  return value;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats s = stats_;
+  s.entries = lru_.size();
+  return s;
+}
+
+std::optional<std::string> ResponseCache::get_locked(const std::string &key) {
+  auto it = index_.find(key);
+  if (it == index_.end())
+    return std::nullopt;
+  if (it->second->expires <= Clock::now()) {
+    lru_.erase(it->second);
+    index_.erase(it);
+    return std::nullopt;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->value;
+}
+
+void ResponseCache::put_locked(const std::string &key,
+                               const std::string &value,
+                               Clock::time_point expires, FileWrite *write) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->value = value;
+    it->second->expires = expires;
+    lru_.splice(lru_.begin(), lru_, it->second);
+  } else {
+    lru_.push_front({key, value, expires});
+    index_[key] = lru_.begin();
+  }
+  while (lru_.size() > options_.max_entries) {
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+  if (!write || options_.path.empty())
+    return;
+  if (++file_lines_ > 2 * options_.max_entries) {
+    plan_rewrite_locked(*write);
+    return;
+  }
+  write->ticket = next_ticket_++;
+  const Entry &entry = lru_.front();
+  write->lines = {
+      file_line(entry.key, entry.value, epoch_ms(entry.expires))};
+}
+
+void ResponseCache::plan_rewrite_locked(FileWrite &write) {
+  // Least recently used first, so loading restores the order
+  write.ticket = next_ticket_++;
+  write.rewrite = true;
+  write.lines.clear();
+  for (auto it = lru_.rbegin(); it != lru_.rend(); ++it)
+    write.lines.push_back(
+        file_line(it->key, it->value, epoch_ms(it->expires)));
+  file_lines_ = lru_.size();
+}
+
+void ResponseCache::write_file(const FileWrite &write) {
+  if (write.ticket == 0)
+    return;
+  std::unique_lock<std::mutex> lock(file_mutex_);
+  file_turn_.wait(lock, [&] { return written_ + 1 == write.ticket; });
+  // A rewrite goes to a temporary file first, so a crash leaves the old one
+  std::string target = write.rewrite ? options_.path + ".tmp" : options_.path;
+  bool ok;
+  {
+    std::ofstream file(target, write.rewrite ? std::ios::trunc : std::ios::app);
+    for (const auto &line : write.lines)
+      file << line << '\n';
+    ok = static_cast<bool>(file);
+  }
+  if (!ok)
+    std::cerr << "⚠️  Cannot write LLM cache " << target << std::endl;
+  if (write.rewrite &&
+      (!ok || std::rename(target.c_str(), options_.path.c_str()) != 0))
+    std::remove(target.c_str());
+  ++written_;
+  lock.unlock();
+  file_turn_.notify_all();
+}
+
+void ResponseCache::load() {
+  std::ifstream file(options_.path);
+  if (!file.is_open())
+    return;
+  auto now = Clock::now();
+  std::string line;
+  while (std::getline(file, line)) {
+    ++file_lines_;
+    // A torn last line from a crash just does not parse
+    json j = json::parse(line, nullptr, false);
+    if (!j.is_object() || !j["k"].is_string() || !j["v"].is_string() ||
+        !j["e"].is_number_integer())
+      continue;
+    Clock::time_point expires{std::chrono::milliseconds(j["e"].get<int64_t>())};
+    if (expires > now)
+      put_locked(j["k"], j["v"], expires, nullptr);
+  }
+  file.close();
+  if (file_lines_ > lru_.size()) {
+    FileWrite write;
+    plan_rewrite_locked(write);
+    write_file(write);
+  }
+  std::cout << "🗄️  LLM cache: " << lru_.size() << " answers from "
+            << options_.path << std::endl;
+}
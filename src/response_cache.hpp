@@ -0,0 +1,103 @@
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Cache of LLM answers. Keys are built by make_key() from everything that
+// shapes a prompt, so a hit is an answer to the very same question.
+// Entries expire after `ttl`; past `max_entries` the least recently used
+// go first. With a `path` the cache survives restarts: every answer is
+// appended to a JSON-lines file, which is rewritten from memory once it
+// holds twice as many lines as entries. The file is written after the
+// cache lock is released, so lookups never wait on the disk.
+//
+// get_or_compute() collapses identical concurrent requests: the first
+// caller runs the computation and the others wait for its answer.
+class ResponseCache {
+public:
+  struct Options {
+    size_t max_entries = 1000;
+    std::chrono::milliseconds ttl = std::chrono::hours(24);
+    std::string path; // Empty: memory only
+  };
+
+  struct Stats {
+    uint64_t hits = 0, misses = 0, shared = 0; // shared: joined a flight
+    size_t entries = 0;
+  };
+
+  using Compute = std::function<std::optional<std::string>()>;
+
+  ResponseCache();
+  explicit ResponseCache(Options options);
+
+  ResponseCache(const ResponseCache &) = delete;
+  ResponseCache &operator=(const ResponseCache &) = delete;
+
+  // model, template version and the whole context
+  static std::string make_key(const std::string &model, int template_version,
+                              const std::string &context);
+
+  std::optional<std::string> get(const std::string &key);
+  void put(const std::string &key, const std::string &value);
+
+  // The cached answer, or compute()'s, run once however many callers ask
+  // at the same time. A nullopt (failed) answer is not cached. *hit tells
+  // whether this caller's answer came without running compute() itself.
+  std::optional<std::string> get_or_compute(const std::string &key,
+                                            const Compute &compute,
+                                            bool *hit = nullptr);
+
+  Stats stats() const;
+
+private:
+  using Clock = std::chrono::system_clock; // Expiry times go to disk
+
+  struct Entry {
+    std::string key, value;
+    Clock::time_point expires;
+  };
+
+  // File work planned under mutex_ and done after releasing it, in the
+  // order it was planned (a rewrite must not overtake an earlier append)
+  struct FileWrite {
+    uint64_t ticket = 0;  // 0: nothing to write
+    bool rewrite = false; // `lines` replace the file rather than extend it
+    std::vector<std::string> lines;
+  };
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_; // Most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  std::unordered_map<std::string,
+                     std::shared_future<std::optional<std::string>>>
+      in_flight_;
+  Stats stats_;
+  size_t file_lines_ = 0;
+  uint64_t next_ticket_ = 1;
+
+  std::mutex file_mutex_;
+  std::condition_variable file_turn_;
+  uint64_t written_ = 0; // Last ticket done; under file_mutex_
+
+  std::optional<std::string> get_locked(const std::string &key);
+  // With `write`, plans persisting the entry there
+  void put_locked(const std::string &key, const std::string &value,
+                  Clock::time_point expires, FileWrite *write);
+  void plan_rewrite_locked(FileWrite &write);
+  void write_file(const FileWrite &write);
+  void load();
+};
+
+#endif
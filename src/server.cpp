@@ -1,250 +1,801 @@
 #include "analysis.hpp"
 #include "analysis_storage.hpp"
+#include "candle_store.hpp"
 #include "httplib.h"
+#include "job_queue.hpp"
 #include "market_data.hpp"
+#include "ml_worker_pool.hpp"
 #include "news_fetcher.hpp"
 #include "nlohmann/json.hpp"
 #include "ollama_client.hpp"
+#include "resample.hpp"
+#include "response_cache.hpp"
 #include "settings_storage.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <curl/curl.h>
 #include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 
 // Global storage instances
-AnalysisStorage storage("analyses.json");
+AnalysisStorage storage("analyses.db");
 SettingsStorage settings_storage("settings.json");
+// Five years of daily bars: enough for the 200-week SMA on the weekly
+// series resampled from them
+YahooProvider yahoo_provider("5y");
+CandleStore candle_store("cache/candles", yahoo_provider);
 
 // Metrics globals
 std::atomic<uint64_t> total_processed_candles{0};
 std::chrono::steady_clock::time_point server_start_time;
 
+// Downloads a scan waits on at once
+static constexpr size_t SCAN_FETCH_THREADS = 16;
+
+// Futures and crypto get the non-stock ML thresholds
+static bool is_stock_ticker(const std::string &ticker) {
+  return ticker.find("=F") == std::string::npos && ticker != "BTC-USD";
+}
+
+// Indicator lines for bars [from, series.size()), one array per indicator
+static json seriesToJson(const IndicatorSeries &series, size_t from) {
+  auto slice = [&](const std::vector<double> &v) {
+    return json(std::vector<double>(v.begin() + from, v.end()));
+  };
+  json times = json::array();
+  for (size_t i = from; i < series.size(); ++i)
+    times.push_back(format_timestamp(series.time[i]));
+
+  return {{"timestamp", times},
+          {"sma_50", slice(series.sma_50)},
+          {"sma_200", slice(series.sma_200)},
+          {"rsi", slice(series.rsi)},
+          {"macd", slice(series.macd)},
+          {"macd_signal", slice(series.macd_signal)},
+          {"macd_hist", slice(series.macd_hist)},
+          {"boll_upper", slice(series.boll_upper)},
+          {"boll_lower", slice(series.boll_lower)},
+          {"boll_width", slice(series.boll_width)},
+          {"atr", slice(series.atr)},
+          {"atr_median", slice(series.atr_median)},
+          {"adx", slice(series.adx)},
+          {"roc_5", slice(series.roc_5)},
+          {"roc_10", slice(series.roc_10)},
+          {"roc_20", slice(series.roc_20)},
+          {"obv", slice(series.obv)},
+          {"vwap_dist", slice(series.vwap_dist)},
+          {"volume_z_score", slice(series.volume_z_score)},
+          {"sma_distance_pct", slice(series.sma_distance_pct)},
+          {"range_pos", slice(series.range_pos)}};
+}
+
+// Outcome-aware context for the Meta-Analyst: the closest graded setups
+// from the history and how they turned out
+static std::string
+similarSetupsContext(const std::vector<SimilarAnalysis> &similar) {
+  if (similar.empty())
+    return "";
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(0);
+  out << "SIMILAR PAST SETUPS (nearest first, graded by the user):\n";
+  int wins = 0;
+  for (const auto &s : similar) {
+    const AnalysisRecord &r = *s.record;
+    wins += r.feedback.success;
+    out << "- " << r.timestamp << " " << r.ticker;
+    if (!r.regime.empty())
+      out << " (" << r.regime << ", " << r.direction << ")";
+    out << " RSI " << r.rsi << ", ADX " << r.adx << ": "
+        << (r.feedback.success ? "WIN" : "LOSS");
+    if (!r.feedback.remark.empty())
+      out << " - " << r.feedback.remark;
+    out << "\n";
+  }
+  out << wins << " of " << similar.size() << " won.";
+  return out.str();
+}
+
+// Field projection for analysis listings: "full" (default), "summary"
+// (without trajectory and AI text) or a comma list of top-level keys
+struct RecordProjection {
+  bool summary = false;
+  std::vector<std::string> keys;
+
+  static RecordProjection parse(const std::string &fields) {
+    RecordProjection p;
+    p.summary = fields == "summary";
+    if (fields.empty() || fields == "summary" || fields == "full")
+      return p;
+    std::stringstream list(fields);
+    std::string key;
+    while (std::getline(list, key, ','))
+      p.keys.push_back(key);
+    auto wants = [&](const char *k) {
+      return std::find(p.keys.begin(), p.keys.end(), k) != p.keys.end();
+    };
+    p.summary = !wants("state_history") && !wants("ai_prediction");
+    return p;
+  }
+
+  json apply(const AnalysisRecord &record) const {
+    json item = record.to_json(summary);
+    if (keys.empty())
+      return item;
+    json projected = json::object();
+    for (const auto &key : keys)
+      if (item.contains(key))
+        projected[key] = std::move(item[key]);
+    return projected;
+  }
+};
+
+// A place among the /api/analyses/changes long-polls, held for one wait.
+// Each waiter keeps an HTTP thread for up to 30 s, so with every tab
+// polling they could take the whole pool; past `limit` a poll gets no
+// place and is answered at once.
+struct ChangeWaitSlot {
+  static inline std::atomic<size_t> waiters{0};
+  bool held;
+
+  explicit ChangeWaitSlot(size_t limit) : held(waiters++ < limit) {
+    if (!held)
+      --waiters;
+  }
+  ~ChangeWaitSlot() {
+    if (held)
+      --waiters;
+  }
+  ChangeWaitSlot(const ChangeWaitSlot &) = delete;
+  ChangeWaitSlot &operator=(const ChangeWaitSlot &) = delete;
+};
+
+// The analysis behind /api/analyze and /api/jobs. Each part of the
+// response is published as soon as it is ready: "market_data" (candles and
+// series), "indicators" (indicators, models, quantum state, trading levels
+// and position sizing), "context" (news and economic events), "ai_token"
+// (each piece of the AI answer as it is generated; not kept once the job
+// finishes), "ai_field" (decision, confidence and risk_level, each as soon
+// as the AI has written it), "ai" and "saved" (analysis_id). Returns the
+// whole response.
+static json runAnalysis(const json &body, const JobEmit &emit) {
+  std::string ticker = body.value("ticker", "AAPL");
+  std::string model = body.value("model", "deepseek-v3.1:671b-cloud");
+  // Quantum trajectory length in bars (0 = whole fetched history)
+  int trajectory_len = std::max(0, body.value("trajectory_len", 50));
+
+  std::cout << "API Request: ticker=" << ticker << ", model=" << model
+            << std::endl;
+
+  json response;
+  response["ticker"] = ticker;
+  auto publish = [&](const char *stage, json part) {
+    for (auto it = part.begin(); it != part.end(); ++it)
+      response[it.key()] = it.value();
+    if (emit)
+      emit(stage, std::move(part));
+  };
+
+  // News and calendar only feed the AI prompt; start them now so they
+  // download while candles load and indicators run
+  auto news_future = fetchTickerNewsAsync(ticker);
+  auto events_future = fetchEconomicCalendarAsync();
+
+  // Fetch market data
+  auto request_start = std::chrono::steady_clock::now();
+  auto candles = candle_store.get(ticker, "1d");
+  // Weekly bars for the MTF features, built locally from the daily ones
+  auto htf_candles = Resample::weekly(candles);
+
+  if (candles.empty())
+    throw JobError(404, "No data found for ticker");
+
+  // Convert candles to JSON array (last 100 for performance)
+  json market_data;
+  market_data["candleCount"] = candles.size();
+  json candles_array = json::array();
+  size_t start = candles.size() > 100 ? candles.size() - 100 : 0;
+  for (size_t i = start; i < candles.size(); i++) {
+    candles_array.push_back({{"timestamp", format_timestamp(candles.time[i])},
+                             {"open", candles.open[i]},
+                             {"high", candles.high[i]},
+                             {"low", candles.low[i]},
+                             {"close", candles.close[i]},
+                             {"volume", (long long)candles.volume[i]}});
+  }
+  market_data["candles"] = candles_array;
+
+  // Optional per-bar indicator lines aligned with the candles above
+  if (body.value("series", false))
+    market_data["series"] =
+        seriesToJson(TechnicalAnalysis::calculate_series(candles), start);
+  publish("market_data", std::move(market_data));
+
+  // Determine asset type
+  bool is_stock = is_stock_ticker(ticker);
+
+  // Calculate indicators with 3-model setup
+  auto indicators = TechnicalAnalysis::calculate_indicators(
+      candles, htf_candles, is_stock, (size_t)trajectory_len);
+
+  // Metrics Update
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> distinct_elapsed = now - request_start;
+  double duration_seconds = distinct_elapsed.count();
+
+  size_t batch_size = candles.size();
+  total_processed_candles += batch_size;
+
+  double rate =
+      (duration_seconds > 0) ? (double)batch_size / duration_seconds : 0.0;
+
+  std::cout << "[Metrics] Analysis: " << ticker << " | Batch: " << batch_size
+            << " | Duration: " << std::fixed << std::setprecision(3)
+            << duration_seconds << "s"
+            << " | Speed: " << std::fixed << std::setprecision(1) << rate
+            << " pts/sec"
+            << " | Total: " << total_processed_candles << std::endl;
+
+  json computed;
+
+  // Quantum State Data
+  json state_vecs = json::array();
+  for (const auto &s : indicators.state_history) {
+    state_vecs.push_back({{"x", s.x},
+                          {"y", s.y},
+                          {"z", s.z},
+                          {"t", format_timestamp(s.time)}});
+  }
+  computed["quantum_state"] = {{"current",
+                                {{"x", indicators.momentum_state},
+                                 {"y", indicators.trend_state},
+                                 {"z", indicators.volatility_state}}},
+                               {"history", state_vecs}};
+
+  computed["regime"] = indicators.regime_info.regime;
+  computed["regime_confidence"] = indicators.regime_info.confidence;
+  computed["ml_direction"] = indicators.ml_info.direction;
+  computed["ml_probability"] = indicators.ml_info.probability;
+  computed["ml_expected_r"] = indicators.ml_info.expected_r;
+
+  // Add indicators
+  computed["indicators"] = {{"rsi", indicators.current_rsi},
+                            {"htf_rsi", indicators.htf_rsi},
+                            {"macd", indicators.macd},
+                            {"adx", indicators.adx},
+                            {"boll_width", indicators.boll_width},
+                            {"atr_median", indicators.atr_median},
+                            {"vol_z", indicators.volume_z_score},
+                            {"roc_20", indicators.roc_20},
+                            {"vwap_dist", indicators.vwap_dist},
+                            {"sma_50", indicators.sma_50},
+                            {"sma_200", indicators.sma_200}};
+
+  // Add trading levels
+  computed["trading_levels"] = {{"entry", indicators.entry_price},
+                                {"take_profit", indicators.take_profit},
+                                {"stop_loss", indicators.stop_loss},
+                                {"trailing_sl", indicators.trailing_sl},
+                                {"partial_tp", indicators.partial_tp}};
+
+  // --- Risk Management Calculation ---
+  auto user_settings = settings_storage.get_settings();
+  double balance = user_settings.account_balance;
+  double risk_pct = user_settings.risk_per_trade_pct;
+  double risk_amount = balance * (risk_pct / 100.0);
+
+  double stop_loss = indicators.stop_loss;
+  double entry = indicators.entry_price;
+  double risk_per_unit = std::abs(entry - stop_loss);
+
+  double units = 0;
+  double notional = 0;
+  double leverage = 1.0;
+
+  if (risk_per_unit > 0) {
+    units = risk_amount / risk_per_unit;
+    notional = units * entry;
+    leverage = notional / balance;
+  }
+
+  computed["risk_management"] = {{"balance", balance},
+                                 {"risk_amount", risk_amount},
+                                 {"recommended_units", units},
+                                 {"notional_value", notional},
+                                 {"suggested_leverage", leverage},
+                                 {"risk_pct", risk_pct}};
+  publish("indicators", std::move(computed));
+
+  // Collect news and economic calendar events (usually already done)
+  auto news = news_future.get();
+  auto events = events_future.get();
+  publish("context", {{"news", newsToJson(news)},
+                      {"economic_events", eventsToJson(events)}});
+
+  // Build context (Events, News, Signals)
+  nlohmann::json context_data;
+  context_data["regime"] = indicators.regime_info.regime;
+  context_data["directional_model"] = {
+      {"direction", indicators.ml_info.direction},
+      {"probability", indicators.ml_info.probability}};
+  context_data["indicators"] = {{"RSI", indicators.current_rsi},
+                                {"HTF_RSI", indicators.htf_rsi},
+                                {"ADX", indicators.adx},
+                                {"SMA_Dist", indicators.sma_distance_pct},
+                                {"ROC_20", indicators.roc_20},
+                                {"VWAP_Dist", indicators.vwap_dist}};
+
+  std::vector<std::string> event_flags;
+  for (const auto &e : events) {
+    if (e.impact == "high")
+      event_flags.push_back(e.event);
+  }
+  context_data["events"] = event_flags;
+
+  // Record for storage; filled before the AI call so the similarity
+  // search can use it
+  AnalysisRecord record;
+  record.ticker = ticker;
+  record.model = model;
+  record.rsi = indicators.current_rsi;
+  record.macd = indicators.macd;
+  record.macd_signal = indicators.macd_signal;
+  record.sma_50 = indicators.sma_50;
+  record.sma_200 = indicators.sma_200;
+  record.current_price = candles.close.back();
+  record.adx = indicators.adx;
+  record.boll_width = indicators.boll_width;
+  record.atr_median = indicators.atr_median;
+  record.volume_z_score = indicators.volume_z_score;
+  record.roc_5 = indicators.roc_5;
+  record.roc_10 = indicators.roc_10;
+  record.roc_20 = indicators.roc_20;
+  record.obv = indicators.obv;
+  record.vwap_dist = indicators.vwap_dist;
+  record.sma_distance_pct = indicators.sma_distance_pct;
+  record.range_pos = indicators.range_pos;
+  record.is_stock = indicators.is_stock;
+  record.htf_rsi = indicators.htf_rsi;
+  record.htf_sma_50 = indicators.htf_sma_50;
+  record.htf_sma_200 = indicators.htf_sma_200;
+  record.entry_price = indicators.entry_price;
+  record.take_profit = indicators.take_profit;
+  record.stop_loss = indicators.stop_loss;
+  record.trailing_sl = indicators.trailing_sl;
+  record.partial_tp = indicators.partial_tp;
+  record.regime = indicators.regime_info.regime;
+  record.direction = indicators.ml_info.direction;
+  record.volatility_state = indicators.volatility_state;
+
+  // Store state history (the last 50 points; long trajectories are only
+  // returned to the caller)
+  size_t stored_from = indicators.state_history.size() > 50
+                           ? indicators.state_history.size() - 50
+                           : 0;
+  for (size_t i = stored_from; i < indicators.state_history.size(); ++i) {
+    const auto &s = indicators.state_history[i];
+    record.state_history.push_back({s.x, s.y, s.z, s.time});
+  }
+
+  // Get AI Meta-Analysis, with how the most similar graded setups
+  // turned out
+  std::string feedback_context =
+      similarSetupsContext(storage.similar_analyses(record, 5));
+  OllamaClient ai(model);
+  OllamaClient::TokenCallback on_token;
+  OllamaClient::FieldCallback on_field;
+  if (emit) {
+    on_token = [&emit](const std::string &token) {
+      emit("ai_token", {{"text", token}});
+    };
+    on_field = [&emit](const std::string &name, const json &value) {
+      emit("ai_field", {{name, value}});
+    };
+  }
+  std::string ai_response_str;
+  try {
+    ai_response_str = ai.get_market_analysis(
+        ticker, context_data.dump(), feedback_context, on_token, on_field);
+  } catch (const OllamaTimeout &e) {
+    throw JobError(504, e.what());
+  }
+  record.ai_prediction = ai_response_str;
+  publish("ai", {{"ai_prediction", ai_response_str}});
+
+  publish("saved", {{"analysis_id", storage.save_analysis(record)}});
+  return response;
+}
+
+// Streams a job as Server-Sent Events: its stage results after seq
+// `since`, each with the seq as event id so an EventSource resumes where it
+// left off, then "result" (the /api/analyze response) or "failed" (error
+// and HTTP status).
+static void streamJob(JobQueue &jobs, const std::string &id, uint64_t since,
+                      httplib::Response &res) {
+  res.set_header("Cache-Control", "no-cache");
+  res.set_chunked_content_provider(
+      "text/event-stream",
+      [&jobs, id, since](size_t, httplib::DataSink &sink) mutable {
+        auto job = jobs.poll(id, since, std::chrono::seconds(15));
+        std::string out;
+        if (!job) {
+          out = "event: failed\ndata: {\"error\": \"Unknown job\"}\n\n";
+        } else {
+          for (const auto &e : job->events)
+            out += "id: " + std::to_string(e.seq) + "\nevent: " + e.stage +
+                   "\ndata: " + e.data.dump() + "\n\n";
+          since = job->next;
+          if (job->status == JobStatus::DONE)
+            out += "event: result\ndata: " + job->result.dump() + "\n\n";
+          else if (job->status == JobStatus::FAILED)
+            out += "event: failed\ndata: " +
+                   json{{"error", job->error}, {"status", job->error_status}}
+                       .dump() +
+                   "\n\n";
+          else if (job->events.empty())
+            out = ": waiting\n\n"; // Keeps proxies from timing out
+        }
+        if (!sink.write(out.data(), out.size()))
+          return false; // Client gone; the job itself runs on
+        if (!job || job->finished())
+          sink.done();
+        return true;
+      });
+}
+
 int main() {
   server_start_time = std::chrono::steady_clock::now();
+  // Once, before any thread can reach curl_easy_init (scan fetches in
+  // parallel)
+  curl_global_init(CURL_GLOBAL_DEFAULT);
   httplib::Server svr;
 
+  // Handlers spend most of their time waiting on Yahoo and Ollama, and the
+  // storages are safe to share, so run more of them than httplib's
+  // core-count default
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  const size_t http_threads = std::max<size_t>(32, cores * 4);
+  svr.new_task_queue = [http_threads] {
+    return new httplib::ThreadPool(http_threads);
+  };
+  // Change-feed long-polls may hold at most half of them
+  const size_t max_change_waiters = http_threads / 2;
+
+  // ML_BACKEND=python routes the regime/direction models through persistent
+  // scripts/ml_predict.py workers (research setup); the native port in
+  // analysis.cpp is used otherwise.
+  std::unique_ptr<MLWorkerPool> ml_pool;
+  const char *ml_backend = std::getenv("ML_BACKEND");
+  if (ml_backend && std::string(ml_backend) == "python") {
+    MLWorkerPool::Options options;
+    if (const char *workers = std::getenv("ML_WORKERS"))
+      options.workers = std::max(1, std::atoi(workers));
+    ml_pool = std::make_unique<MLWorkerPool>(options);
+    MLWorkerPool *pool = ml_pool.get();
+    TechnicalAnalysis::set_ml_predictor(
+        [pool](const MLFeatures &features) { return pool->predict(features); });
+    std::cout << "🧠 ML backend: python worker pool (" << ml_pool->size()
+              << " workers)" << std::endl;
+  }
+
   // Serve static files from public directory
   svr.set_mount_point("/", "./public");
 
-  // API endpoint for analysis
-  svr.Post("/api/analyze", [](const httplib::Request &req,
-                              httplib::Response &res) {
+  // Meta-Analyst answers by prompt content, kept across restarts in
+  // llm_cache.jsonl; LLM_CACHE_HOURS sets how long (0 turns it off)
+  ResponseCache::Options cache_options;
+  cache_options.path = "llm_cache.jsonl";
+  if (const char *hours = std::getenv("LLM_CACHE_HOURS"))
+    cache_options.ttl = std::chrono::hours(std::max(0, std::atoi(hours)));
+  std::unique_ptr<ResponseCache> llm_cache;
+  if (cache_options.ttl.count() > 0) {
+    llm_cache = std::make_unique<ResponseCache>(cache_options);
+    OllamaClient::set_response_cache(llm_cache.get());
+  }
+
+  // OLLAMA_TIMEOUT_SECONDS caps one generation (default 300), so a hung
+  // model fails its job instead of holding a worker
+  if (const char *seconds = std::getenv("OLLAMA_TIMEOUT_SECONDS"))
+    OllamaClient::set_timeouts(std::chrono::seconds(std::atoi(seconds)),
+                               std::chrono::seconds(60));
+
+  // Long-running analyses run here, not on the HTTP threads: the LLM call
+  // can take tens of seconds. ANALYSIS_WORKERS sets how many run at once.
+  JobQueue::Options job_options;
+  job_options.transient_stages = {"ai_token"};
+  if (const char *workers = std::getenv("ANALYSIS_WORKERS"))
+    job_options.workers = std::max(1, std::atoi(workers));
+  JobQueue jobs(job_options);
+  std::cout << "🧵 Analysis jobs: " << jobs.workers() << " workers"
+            << std::endl;
+
+  // API endpoint for analysis; waits for the whole result. Runs as a job
+  // like /api/jobs, so it counts against the same workers.
+  svr.Post("/api/analyze", [&jobs](const httplib::Request &req,
+                                   httplib::Response &res) {
     try {
       auto body = json::parse(req.body);
-      std::string ticker = body.value("ticker", "AAPL");
-      std::string model = body.value("model", "deepseek-v3.1:671b-cloud");
-
-      std::cout << "API Request: ticker=" << ticker << ", model=" << model
-                << std::endl;
+      std::string id = jobs.submit(
+          [body](const JobEmit &emit) { return runAnalysis(body, emit); });
+      if (id.empty()) {
+        res.set_content("{\"error\": \"Too many analyses queued\"}",
+                        "application/json");
+        res.status = 503;
+        return;
+      }
+      std::optional<JobView> job;
+      uint64_t next = 0;
+      do {
+        job = jobs.poll(id, next, std::chrono::seconds(30));
+        next = job ? job->next : next;
+      } while (job && !job->finished());
 
-      // Fetch market data
-      auto request_start = std::chrono::steady_clock::now();
+      if (!job) {
+        res.set_content("{\"error\": \"Analysis expired\"}",
+                        "application/json");
+        res.status = 500;
+      } else if (job->status == JobStatus::FAILED) {
+        json error = {{"error", job->error}};
+        res.set_content(error.dump(), "application/json");
+        res.status = job->error_status;
+      } else {
+        res.set_content(job->result.dump(), "application/json");
+      }
 
-      // Fetch market data
-      auto candles = MarketData::fetch_history(ticker, "1d");
-      auto htf_candles = MarketData::fetch_history(ticker, "1wk");
+    } catch (const std::exception &e) {
+      json error = {{"error", e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 500;
+    }
+  });
 
-      if (candles.empty()) {
-        res.set_content("{\"error\": \"No data found for ticker\"}",
+  // POST endpoint: Start an analysis (same body as /api/analyze) and
+  // return at once with its job id (202)
+  svr.Post("/api/jobs", [&jobs](const httplib::Request &req,
+                                httplib::Response &res) {
+    try {
+      auto body = json::parse(req.body);
+      std::string id = jobs.submit(
+          [body](const JobEmit &emit) { return runAnalysis(body, emit); });
+      if (id.empty()) {
+        res.set_content("{\"error\": \"Too many analyses queued\"}",
                         "application/json");
-        res.status = 404;
+        res.status = 503;
         return;
       }
+      json response = {{"job_id", id}, {"status", "queued"}};
+      res.set_content(response.dump(), "application/json");
+      res.status = 202;
 
-      // Determine asset type
-      bool is_stock = true;
-      if (ticker.find("=F") != std::string::npos || ticker == "BTC-USD") {
-        is_stock = false;
-      }
+    } catch (const std::exception &e) {
+      json error = {{"error", e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
+    }
+  });
 
-      // Calculate indicators with 3-model setup
-      auto indicators = TechnicalAnalysis::calculate_indicators(
-          candles, htf_candles, is_stock);
-
-      // Metrics Update
-      auto now = std::chrono::steady_clock::now();
-      std::chrono::duration<double> distinct_elapsed = now - request_start;
-      double duration_seconds = distinct_elapsed.count();
-
-      size_t batch_size = candles.size();
-      total_processed_candles += batch_size;
-
-      double rate =
-          (duration_seconds > 0) ? (double)batch_size / duration_seconds : 0.0;
-
-      std::cout << "[Metrics] Analysis: " << ticker
-                << " | Batch: " << batch_size << " | Duration: " << std::fixed
-                << std::setprecision(3) << duration_seconds << "s"
-                << " | Speed: " << std::fixed << std::setprecision(1) << rate
-                << " pts/sec"
-                << " | Total: " << total_processed_candles << std::endl;
-      std::string summary =
-          TechnicalAnalysis::get_market_summary(candles, indicators);
-
-      // Fetch news and economic calendar events
-      auto news = fetchTickerNews(ticker);
-      auto events = fetchEconomicCalendar();
-
-      // Build context (Events, News, Signals)
-      nlohmann::json context_data;
-      context_data["regime"] = indicators.regime_info.regime;
-      context_data["directional_model"] = {
-          {"direction", indicators.ml_info.direction},
-          {"probability", indicators.ml_info.probability}};
-      context_data["indicators"] = {{"RSI", indicators.current_rsi},
-                                    {"HTF_RSI", indicators.htf_rsi},
-                                    {"ADX", indicators.adx},
-                                    {"SMA_Dist", indicators.sma_distance_pct},
-                                    {"ROC_20", indicators.roc_20},
-                                    {"VWAP_Dist", indicators.vwap_dist}};
-
-      std::vector<std::string> event_flags;
-      for (const auto &e : events) {
-        if (e.impact == "high")
-          event_flags.push_back(e.event);
+  // POST endpoint: /api/analyze as Server-Sent Events (see streamJob):
+  // candles, indicators and levels arrive as soon as they are computed,
+  // then the AI answer token by token
+  svr.Post("/api/analyze/stream", [&jobs](const httplib::Request &req,
+                                          httplib::Response &res) {
+    try {
+      auto body = json::parse(req.body);
+      std::string id = jobs.submit(
+          [body](const JobEmit &emit) { return runAnalysis(body, emit); });
+      if (id.empty()) {
+        res.set_content("{\"error\": \"Too many analyses queued\"}",
+                        "application/json");
+        res.status = 503;
+        return;
       }
-      context_data["events"] = event_flags;
-
-      // Get AI Meta-Analysis
-      OllamaClient ai(model);
-      std::string ai_response_str =
-          ai.get_market_analysis(ticker, context_data.dump(), "");
-
-      // Save to storage
-      AnalysisRecord record;
-      record.ticker = ticker;
-      record.model = model;
-      record.rsi = indicators.current_rsi;
-      record.macd = indicators.macd;
-      record.macd_signal = indicators.macd_signal;
-      record.sma_50 = indicators.sma_50;
-      record.sma_200 = indicators.sma_200;
-      record.current_price = candles.back().close;
-      record.adx = indicators.adx;
-      record.boll_width = indicators.boll_width;
-      record.atr_median = indicators.atr_median;
-      record.volume_z_score = indicators.volume_z_score;
-      record.roc_5 = indicators.roc_5;
-      record.roc_10 = indicators.roc_10;
-      record.roc_20 = indicators.roc_20;
-      record.obv = indicators.obv;
-      record.vwap_dist = indicators.vwap_dist;
-      record.sma_distance_pct = indicators.sma_distance_pct;
-      record.range_pos = indicators.range_pos;
-      record.is_stock = indicators.is_stock;
-      record.htf_rsi = indicators.htf_rsi;
-      record.htf_sma_50 = indicators.htf_sma_50;
-      record.htf_sma_200 = indicators.htf_sma_200;
-      record.entry_price = indicators.entry_price;
-      record.take_profit = indicators.take_profit;
-      record.stop_loss = indicators.stop_loss;
-      record.trailing_sl = indicators.trailing_sl;
-      record.partial_tp = indicators.partial_tp;
-      record.ai_prediction = ai_response_str;
-
-      // Store state history
-      for (const auto &s : indicators.state_history) {
-        record.state_history.push_back({s.x, s.y, s.z, s.timestamp});
+      res.set_header("X-Job-Id", id);
+      streamJob(jobs, id, 0, res);
+
+    } catch (const std::exception &e) {
+      json error = {{"error", e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
+    }
+  });
+
+  // GET endpoint: A job as Server-Sent Events (see streamJob); resumes
+  // after the Last-Event-ID header or the `since` parameter
+  svr.Get(R"(/api/jobs/([0-9a-f]+)/events)", [&jobs](
+                                                 const httplib::Request &req,
+                                                 httplib::Response &res) {
+    try {
+      std::string last = req.get_header_value("Last-Event-ID");
+      if (last.empty())
+        last = req.get_param_value("since");
+      uint64_t since = last.empty() ? 0 : std::stoull(last);
+      if (!jobs.poll(req.matches[1], since, std::chrono::milliseconds(0))) {
+        res.set_content("{\"error\": \"Unknown job\"}", "application/json");
+        res.status = 404;
+        return;
       }
+      streamJob(jobs, req.matches[1], since, res);
 
-      std::string analysis_id = storage.save_analysis(record);
+    } catch (const std::logic_error &e) {
+      json error = {{"error", std::string("Invalid query: ") + e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
+    }
+  });
 
-      // Build response JSON
-      json response;
-      response["ticker"] = ticker;
-      response["candleCount"] = candles.size();
-      response["analysis_id"] = analysis_id;
+  // GET endpoint: A job's status and the stage results published after
+  // seq `since` (0 for all). Waits up to `wait` seconds (max 30) for the
+  // next stage or the end. "next" is the `since` for the following call;
+  // "result" (the /api/analyze response) or "error" once finished.
+  svr.Get(R"(/api/jobs/([0-9a-f]+))", [&jobs](const httplib::Request &req,
+                                              httplib::Response &res) {
+    try {
+      uint64_t since = 0;
+      if (req.has_param("since"))
+        since = std::stoull(req.get_param_value("since"));
+      int wait = 0;
+      if (req.has_param("wait"))
+        wait = std::clamp(std::stoi(req.get_param_value("wait")), 0, 30);
 
-      // Quantum State Data
-      json state_vecs = json::array();
-      for (const auto &s : indicators.state_history) {
-        state_vecs.push_back(
-            {{"x", s.x}, {"y", s.y}, {"z", s.z}, {"t", s.timestamp}});
+      auto job = jobs.poll(req.matches[1], since, std::chrono::seconds(wait));
+      if (!job) {
+        res.set_content("{\"error\": \"Unknown job\"}", "application/json");
+        res.status = 404;
+        return;
       }
-      response["quantum_state"] = {{"current",
-                                    {{"x", indicators.momentum_state},
-                                     {"y", indicators.trend_state},
-                                     {"z", indicators.volatility_state}}},
-                                   {"history", state_vecs}};
-
-      response["regime"] = indicators.regime_info.regime;
-      response["regime_confidence"] = indicators.regime_info.confidence;
-      response["ml_direction"] = indicators.ml_info.direction;
-      response["ml_probability"] = indicators.ml_info.probability;
-      response["ml_expected_r"] = indicators.ml_info.expected_r;
-
-      // Convert candles to JSON array (last 100 for performance)
-      json candles_array = json::array();
-      size_t start = candles.size() > 100 ? candles.size() - 100 : 0;
-      for (size_t i = start; i < candles.size(); i++) {
-        candles_array.push_back({{"timestamp", candles[i].timestamp},
-                                 {"open", candles[i].open},
-                                 {"high", candles[i].high},
-                                 {"low", candles[i].low},
-                                 {"close", candles[i].close},
-                                 {"volume", candles[i].volume}});
+      res.set_content(job->to_json().dump(), "application/json");
+
+    } catch (const std::logic_error &e) {
+      json error = {{"error", std::string("Invalid query: ") + e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
+    }
+  });
+
+  // POST endpoint: Indicator/model scan over many tickers (no AI call).
+  // Downloads wait on I/O threads of their own (the transfers themselves
+  // share the AsyncHttp loop); only the analyses run on the shared
+  // work-stealing pool, so its workers never block on the network.
+  svr.Post("/api/scan", [](const httplib::Request &req,
+                           httplib::Response &res) {
+    try {
+      auto body = json::parse(req.body);
+      auto tickers = body.value("tickers", std::vector<std::string>{});
+      if (tickers.empty()) {
+        res.set_content("{\"error\": \"Missing tickers\"}",
+                        "application/json");
+        res.status = 400;
+        return;
+      }
+      auto scan_start = std::chrono::steady_clock::now();
+
+      std::vector<BatchItem> items(tickers.size());
+      std::vector<std::string> fetch_errors(tickers.size());
+      std::atomic<size_t> next_ticker{0};
+      std::vector<std::thread> fetchers;
+      for (size_t t = 0; t < std::min(tickers.size(), SCAN_FETCH_THREADS);
+           ++t) {
+        fetchers.emplace_back([&] {
+          for (size_t i; (i = next_ticker++) < tickers.size();) {
+            items[i].ticker = tickers[i];
+            items[i].is_stock = is_stock_ticker(tickers[i]);
+            try {
+              items[i].candles = candle_store.get(tickers[i], "1d");
+              items[i].htf_candles = Resample::weekly(items[i].candles);
+            } catch (const std::exception &e) {
+              fetch_errors[i] = e.what();
+            }
+          }
+        });
       }
-      response["candles"] = candles_array;
-
-      // Add indicators
-      response["indicators"] = {{"rsi", indicators.current_rsi},
-                                {"htf_rsi", indicators.htf_rsi},
-                                {"macd", indicators.macd},
-                                {"adx", indicators.adx},
-                                {"boll_width", indicators.boll_width},
-                                {"atr_median", indicators.atr_median},
-                                {"vol_z", indicators.volume_z_score},
-                                {"roc_20", indicators.roc_20},
-                                {"vwap_dist", indicators.vwap_dist},
-                                {"sma_50", indicators.sma_50},
-                                {"sma_200", indicators.sma_200}};
-
-      // Add trading levels
-      response["trading_levels"] = {{"entry", indicators.entry_price},
-                                    {"take_profit", indicators.take_profit},
-                                    {"stop_loss", indicators.stop_loss},
-                                    {"trailing_sl", indicators.trailing_sl},
-                                    {"partial_tp", indicators.partial_tp}};
-
-      // Add news and economic events
-      response["news"] = newsToJson(news);
-      response["economic_events"] = eventsToJson(events);
-
-      // Add AI prediction
-      response["ai_prediction"] = ai_response_str;
-
-      // --- Risk Management Calculation ---
-      auto user_settings = settings_storage.get_settings();
-      double balance = user_settings.account_balance;
-      double risk_pct = user_settings.risk_per_trade_pct;
-      double risk_amount = balance * (risk_pct / 100.0);
-
-      double stop_loss = indicators.stop_loss;
-      double entry = indicators.entry_price;
-      double risk_per_unit = std::abs(entry - stop_loss);
-
-      double units = 0;
-      double notional = 0;
-      double leverage = 1.0;
-
-      if (risk_per_unit > 0) {
-        units = risk_amount / risk_per_unit;
-        notional = units * entry;
-        leverage = notional / balance;
+      for (auto &t : fetchers)
+        t.join();
+
+      auto results = TechnicalAnalysis::calculate_batch(items);
+
+      json rows = json::array();
+      size_t failed = 0;
+      for (size_t i = 0; i < results.size(); ++i) {
+        const BatchResult &r = results[i];
+        json row = {{"ticker", r.ticker}, {"elapsed_ms", r.elapsed_ms}};
+        std::string error =
+            fetch_errors[i].empty() ? r.error : fetch_errors[i];
+        if (!error.empty()) {
+          row["error"] = error;
+          ++failed;
+        } else {
+          row["regime"] = r.result.regime_info.regime;
+          row["ml_direction"] = r.result.ml_info.direction;
+          row["ml_probability"] = r.result.ml_info.probability;
+          row["signal_strength"] = r.result.signal_strength;
+          row["rsi"] = r.result.current_rsi;
+          row["entry"] = r.result.entry_price;
+          row["stop_loss"] = r.result.stop_loss;
+          row["take_profit"] = r.result.take_profit;
+          total_processed_candles += items[i].candles.size();
+        }
+        rows.push_back(row);
       }
 
-      response["risk_management"] = {{"balance", balance},
-                                     {"risk_amount", risk_amount},
-                                     {"recommended_units", units},
-                                     {"notional_value", notional},
-                                     {"suggested_leverage", leverage},
-                                     {"risk_pct", risk_pct}};
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - scan_start;
+      json response = {{"results", rows},
+                       {"failed", failed},
+                       {"threads", WorkStealingPool::shared().size()},
+                       {"elapsed_seconds", elapsed.count()}};
+      res.set_content(response.dump(), "application/json");
+
+    } catch (const std::exception &e) {
+      json error = {{"error", e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 500;
+    }
+  });
+
+  // GET endpoint: Retrieve recent analyses, newest first, one page at a
+  // time. Optional parameters: limit (1-500, default 50), cursor (from the
+  // previous page), ticker, model, from/to (timestamp prefixes such as
+  // 2026-01-31), feedback (pending|submitted|success|failed) and fields
+  // ("full", "summary" without trajectory and AI text, or a comma list of
+  // top-level keys). "version" is where to start the change feed.
+  svr.Get("/api/recent-analyses", [](const httplib::Request &req,
+                                     httplib::Response &res) {
+    try {
+      AnalysisQuery query;
+      query.limit = 50;
+      if (req.has_param("limit"))
+        query.limit = (size_t)std::clamp(
+            std::stoi(req.get_param_value("limit")), 1, 500);
+      if (req.has_param("cursor"))
+        query.cursor = std::stoull(req.get_param_value("cursor"));
+      query.ticker = req.get_param_value("ticker");
+      query.model = req.get_param_value("model");
+      query.from = req.get_param_value("from");
+      query.to = req.get_param_value("to");
+
+      std::string feedback = req.get_param_value("feedback");
+      if (feedback == "pending")
+        query.feedback = AnalysisQuery::Feedback::Pending;
+      else if (feedback == "submitted")
+        query.feedback = AnalysisQuery::Feedback::Submitted;
+      else if (feedback == "success")
+        query.feedback = AnalysisQuery::Feedback::Success;
+      else if (feedback == "failed")
+        query.feedback = AnalysisQuery::Feedback::Failed;
+      else if (!feedback.empty())
+        throw std::invalid_argument("unknown feedback filter: " + feedback);
+
+      auto projection = RecordProjection::parse(req.get_param_value("fields"));
 
+      AnalysisPage page = storage.query(query);
+
+      json analyses = json::array();
+      for (const auto &record : page.records)
+        analyses.push_back(projection.apply(*record));
+
+      json response = {{"analyses", std::move(analyses)},
+                       {"next_cursor", nullptr},
+                       {"version", page.version}};
+      if (page.next_cursor)
+        response["next_cursor"] = std::to_string(page.next_cursor);
       res.set_content(response.dump(), "application/json");
 
+    } catch (const std::logic_error &e) {
+      // Bad parameter: std::stoi/stoull failures or an unknown filter
+      json error = {{"error", std::string("Invalid query: ") + e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
     } catch (const std::exception &e) {
       json error = {{"error", e.what()}};
       res.set_content(error.dump(), "application/json");
@@ -252,24 +803,80 @@ int main() {
     }
   });
 
-  // GET endpoint: Retrieve recent analyses
-  svr.Get("/api/recent-analyses",
-          [](const httplib::Request &req, httplib::Response &res) {
-            try {
-              auto recent = storage.get_recent_analyses(50);
+  // GET endpoint: Analysis changes after version `since` (from a listing
+  // or the previous call), oldest first. Waits up to `wait` seconds (max
+  // 30) for the first change. "reset": true means the changes are no
+  // longer available and the client should reload. `fields` as above.
+  // With too many polls waiting it answers at once with "retry_after"
+  // (seconds) for the client to wait before polling again.
+  svr.Get("/api/analyses/changes", [max_change_waiters](
+                                       const httplib::Request &req,
+                                       httplib::Response &res) {
+    try {
+      if (!req.has_param("since")) {
+        json response = {{"version", storage.version()},
+                         {"reset", false},
+                         {"changes", json::array()}};
+        res.set_content(response.dump(), "application/json");
+        return;
+      }
+      uint64_t since = std::stoull(req.get_param_value("since"));
+      int wait = 0;
+      if (req.has_param("wait"))
+        wait = std::clamp(std::stoi(req.get_param_value("wait")), 0, 30);
+      auto projection = RecordProjection::parse(req.get_param_value("fields"));
+
+      // Too many waiting already: answer now and have the client come back
+      // later instead of polling straight away
+      std::optional<ChangeWaitSlot> slot;
+      bool turned_away = false;
+      if (wait > 0) {
+        slot.emplace(max_change_waiters);
+        turned_away = !slot->held;
+        if (turned_away)
+          wait = 0;
+      }
+      AnalysisChanges feed =
+          storage.changes_since(since, 500, std::chrono::seconds(wait));
+      slot.reset();
 
-              json response = json::array();
-              for (const auto &record : recent) {
-                response.push_back(record.to_json());
-              }
+      json changes = json::array();
+      for (const auto &change : feed.changes) {
+        static const char *kinds[] = {"insert", "feedback", "delete"};
+        json item = {{"version", change.version},
+                     {"type", kinds[(int)change.kind]},
+                     {"id", change.id}};
+        if (change.record)
+          item["analysis"] = projection.apply(*change.record);
+        changes.push_back(std::move(item));
+      }
 
-              res.set_content(response.dump(), "application/json");
+      json response = {{"version", feed.version},
+                       {"reset", feed.reset},
+                       {"changes", std::move(changes)}};
+      if (turned_away)
+        response["retry_after"] = 5; // Seconds
+      res.set_content(response.dump(), "application/json");
 
-            } catch (const std::exception &e) {
-              json error = {{"error", e.what()}};
-              res.set_content(error.dump(), "application/json");
-              res.status = 500;
-            }
+    } catch (const std::logic_error &e) {
+      json error = {{"error", std::string("Invalid query: ") + e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 400;
+    } catch (const std::exception &e) {
+      json error = {{"error", e.what()}};
+      res.set_content(error.dump(), "application/json");
+      res.status = 500;
+    }
+  });
+
+  // GET endpoint: Feedback outcomes (analyses, submitted, success, failed,
+  // win_rate) overall and by ticker, model, regime, direction and
+  // volatility bucket. The counters are maintained on every write, so this
+  // is cheap enough to poll.
+  svr.Get("/api/stats",
+          [](const httplib::Request &, httplib::Response &res) {
+            res.set_content(storage.stats().to_json().dump(),
+                            "application/json");
           });
 
   // POST endpoint: Submit feedback for an analysis
@@ -350,7 +957,13 @@ int main() {
            [](const httplib::Request &req, httplib::Response &res) {
              try {
                auto body = json::parse(req.body);
-               settings_storage.save_settings(UserSettings::from_json(body));
+               if (!settings_storage.save_settings(
+                       UserSettings::from_json(body))) {
+                 res.status = 500;
+                 res.set_content("{\"error\": \"Could not save settings\"}",
+                                 "application/json");
+                 return;
+               }
                res.set_content("{\"success\": true}", "application/json");
              } catch (const std::exception &e) {
                res.status = 400;
@@ -1,34 +1,167 @@
 #include "settings_storage.hpp"
+#include <cerrno>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// Directory and file name of a path
+static std::pair<std::string, std::string>
+split_path(const std::string &path) {
+  size_t slash = path.rfind('/');
+  if (slash == std::string::npos)
+    return {".", path};
+  return {path.substr(0, slash ? slash : 1), path.substr(slash + 1)};
+}
+
+// What the mtime fallback compares: modification time and size
+static std::pair<int64_t, int64_t> file_stamp(const std::string &path) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return {-1, -1};
+  return {(int64_t)st.st_mtime, (int64_t)st.st_size};
+}
 
 SettingsStorage::SettingsStorage(const std::string &filename)
     : filename_(filename) {
-  ensure_file_exists();
+  publish(std::make_shared<const UserSettings>());
+  if (!reload()) {
+    std::ifstream f(filename_);
+    if (!f.good())
+      save_settings(UserSettings());
+  }
+  if (::pipe(wake_) == 0)
+    watcher_ = std::thread([this] { watch(); });
 }
 
-void SettingsStorage::ensure_file_exists() {
-  std::ifstream f(filename_);
-  if (!f.good()) {
-    UserSettings default_settings;
-    save_settings(default_settings);
+SettingsStorage::~SettingsStorage() {
+  if (watcher_.joinable()) {
+    ssize_t written = ::write(wake_[1], "x", 1);
+    (void)written;
+    watcher_.join();
   }
+  for (int fd : wake_)
+    if (fd >= 0)
+      ::close(fd);
 }
 
-UserSettings SettingsStorage::get_settings() {
+std::shared_ptr<const UserSettings> SettingsStorage::snapshot() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+  return current_.load();
+#else
+  return std::atomic_load(&current_);
+#endif
+}
+
+void SettingsStorage::publish(std::shared_ptr<const UserSettings> settings) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+  current_.store(std::move(settings));
+#else
+  std::atomic_store(&current_, std::move(settings));
+#endif
+}
+
+bool SettingsStorage::reload() {
+  // Under the save lock, so a reload that read the file before a save
+  // cannot publish its older settings after it
+  std::lock_guard<std::mutex> lock(save_mutex_);
+  std::ifstream file(filename_);
+  if (!file.is_open())
+    return false;
+  json j = json::parse(file, nullptr, false);
+  if (j.is_discarded() || !j.is_object())
+    return false;
   try {
-    std::ifstream file(filename_);
-    if (!file.is_open())
-      return UserSettings();
-    json j;
-    file >> j;
-    return UserSettings::from_json(j);
-  } catch (...) {
-    return UserSettings();
+    publish(std::make_shared<const UserSettings>(UserSettings::from_json(j)));
+  } catch (const json::exception &) {
+    return false; // A field of the wrong type
+  }
+  return true;
+}
+
+bool SettingsStorage::save_settings(const UserSettings &settings) {
+  std::lock_guard<std::mutex> lock(save_mutex_);
+  std::string tmp = filename_ + ".tmp";
+  std::string text = settings.to_json().dump(4);
+
+  std::FILE *file = std::fopen(tmp.c_str(), "wb");
+  bool ok = file != nullptr;
+  if (file) {
+    ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fflush(file) == 0 && ok;
+    ok = ::fsync(fileno(file)) == 0 && ok;
+    std::fclose(file);
   }
+  if (!ok || std::rename(tmp.c_str(), filename_.c_str()) != 0) {
+    std::cerr << "❌ Cannot write settings to " << filename_ << std::endl;
+    std::remove(tmp.c_str());
+    return false;
+  }
+  publish(std::make_shared<const UserSettings>(settings));
+  return true;
 }
 
-void SettingsStorage::save_settings(const UserSettings &settings) {
-  std::ofstream file(filename_);
-  file << settings.to_json().dump(4);
+void SettingsStorage::watch() {
+  auto [dir, name] = split_path(filename_);
+
+  // The directory is watched, not the file: saves replace the file, which
+  // would end a watch on it
+  int notify = -1;
+#ifdef __linux__
+  notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify >= 0 &&
+      inotify_add_watch(notify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) <
+          0) {
+    ::close(notify);
+    notify = -1;
+  }
+#endif
+  if (notify < 0)
+    std::cout << "⚠️  inotify unavailable; checking " << filename_
+              << " for changes every second" << std::endl;
+
+  auto stamp = file_stamp(filename_);
+  while (true) {
+    pollfd fds[2] = {{wake_[0], POLLIN, 0}, {notify, POLLIN, 0}};
+    int ready = ::poll(fds, notify >= 0 ? 2 : 1, notify >= 0 ? -1 : 1000);
+    if (ready < 0 && errno != EINTR)
+      break;
+    if (fds[0].revents)
+      break;
+
+    bool changed = false;
+#ifdef __linux__
+    if (notify >= 0 && (fds[1].revents & POLLIN)) {
+      alignas(inotify_event) char buffer[4096];
+      ssize_t n;
+      while ((n = ::read(notify, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + n;) {
+          auto *event = reinterpret_cast<inotify_event *>(p);
+          if (event->len && name == event->name)
+            changed = true;
+          p += sizeof(inotify_event) + event->len;
+        }
+      }
+    }
+#endif
+    if (notify < 0) {
+      auto now = file_stamp(filename_);
+      changed = now != stamp;
+      stamp = now;
+    }
+
+    if (changed && !reload())
+      std::cerr << "⚠️  Keeping current settings: cannot read " << filename_
+                << std::endl;
+  }
+
+  if (notify >= 0)
+    ::close(notify);
 }
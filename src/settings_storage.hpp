@@ -1,9 +1,12 @@
 #ifndef SETTINGS_STORAGE_HPP
 #define SETTINGS_STORAGE_HPP
 
-#include "httplib.h"
 #include "nlohmann/json.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 using json = nlohmann::json;
 
@@ -27,15 +30,45 @@ struct UserSettings {
   }
 };
 
+// Settings held in memory as an immutable snapshot that is swapped
+// atomically, so get_settings() never touches the disk and never sees a
+// partial update. save_settings() writes the file atomically (temp file,
+// fsync, rename) and then swaps in the new snapshot. Edits made to the file
+// by hand are picked up by a watcher thread: inotify on the file's
+// directory where available, otherwise a once-a-second mtime check. A file
+// that does not parse leaves the current settings in place.
 class SettingsStorage {
 public:
   explicit SettingsStorage(const std::string &filename);
-  UserSettings get_settings();
-  void save_settings(const UserSettings &settings);
+  ~SettingsStorage();
+
+  SettingsStorage(const SettingsStorage &) = delete;
+  SettingsStorage &operator=(const SettingsStorage &) = delete;
+
+  UserSettings get_settings() const { return *snapshot(); }
+  std::shared_ptr<const UserSettings> snapshot() const;
+
+  // false if the file could not be written; the settings are then
+  // unchanged
+  bool save_settings(const UserSettings &settings);
+
+  // Re-read the file now; false (settings unchanged) if it cannot be read
+  bool reload();
 
 private:
   std::string filename_;
-  void ensure_file_exists();
+#if defined(__cpp_lib_atomic_shared_ptr)
+  std::atomic<std::shared_ptr<const UserSettings>> current_;
+#else
+  std::shared_ptr<const UserSettings> current_; // std::atomic_load/store
+#endif
+  std::mutex save_mutex_; // One writer of the file at a time
+
+  int wake_[2] = {-1, -1}; // Pipe that stops the watcher
+  std::thread watcher_;
+
+  void publish(std::shared_ptr<const UserSettings> settings);
+  void watch();
 };
 
 #endif
@@ -0,0 +1,259 @@
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_HAVE_AVX2_PATH 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+// --- Scalar fallbacks ---
+
+static double sum_scalar(const double *x, size_t n) {
+  double s = 0;
+  for (size_t i = 0; i < n; ++i)
+    s += x[i];
+  return s;
+}
+
+static void moments_scalar(const double *x, size_t n, double &sum,
+                           double &sum_sq) {
+  double s = 0, sq = 0;
+  for (size_t i = 0; i < n; ++i) {
+    s += x[i];
+    sq += x[i] * x[i];
+  }
+  sum = s;
+  sum_sq = sq;
+}
+
+static double sum_sq_dev_scalar(const double *x, size_t n, double mean) {
+  double s = 0;
+  for (size_t i = 0; i < n; ++i) {
+    double d = x[i] - mean;
+    s += d * d;
+  }
+  return s;
+}
+
+static double dot_scalar(const double *a, const double *b, size_t n) {
+  double s = 0;
+  for (size_t i = 0; i < n; ++i)
+    s += a[i] * b[i];
+  return s;
+}
+
+static void true_range_scalar(const double *high, const double *low,
+                              const double *prev_close, double *out,
+                              size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = std::max({high[i] - low[i], std::abs(high[i] - prev_close[i]),
+                       std::abs(low[i] - prev_close[i])});
+}
+
+static void sq_distances_scalar(const float *const *columns, size_t dims,
+                                const float *query, float *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    float s = 0;
+    for (size_t d = 0; d < dims; ++d) {
+      float diff = columns[d][i] - query[d];
+      s += diff * diff;
+    }
+    out[i] = s;
+  }
+}
+
+// --- AVX2 ---
+
+#ifdef SIMD_HAVE_AVX2_PATH
+
+__attribute__((target("avx2"))) static double hsum(__m256d v) {
+  __m128d lo = _mm256_castpd256_pd128(v);
+  __m128d hi = _mm256_extractf128_pd(v, 1);
+  lo = _mm_add_pd(lo, hi);
+  return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2"))) static double sum_avx2(const double *x,
+                                                       size_t n) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(x + i + 4));
+  }
+  if (i + 4 <= n) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+    i += 4;
+  }
+  return hsum(_mm256_add_pd(acc0, acc1)) + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+moments_avx2(const double *x, size_t n, double &sum, double &sum_sq) {
+  __m256d s = _mm256_setzero_pd(), sq = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(x + i);
+    s = _mm256_add_pd(s, v);
+    sq = _mm256_add_pd(sq, _mm256_mul_pd(v, v));
+  }
+  double tail_s, tail_sq;
+  moments_scalar(x + i, n - i, tail_s, tail_sq);
+  sum = hsum(s) + tail_s;
+  sum_sq = hsum(sq) + tail_sq;
+}
+
+__attribute__((target("avx2"))) static double
+sum_sq_dev_avx2(const double *x, size_t n, double mean) {
+  __m256d m = _mm256_set1_pd(mean), acc = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + i), m);
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+  }
+  return hsum(acc) + sum_sq_dev_scalar(x + i, n - i, mean);
+}
+
+__attribute__((target("avx2"))) static double dot_avx2(const double *a,
+                                                       const double *b,
+                                                       size_t n) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(
+        acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4),
+                                             _mm256_loadu_pd(b + i + 4)));
+  }
+  if (i + 4 <= n) {
+    acc0 = _mm256_add_pd(
+        acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    i += 4;
+  }
+  return hsum(_mm256_add_pd(acc0, acc1)) + dot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+true_range_avx2(const double *high, const double *low,
+                const double *prev_close, double *out, size_t n) {
+  // |x| by clearing the sign bit
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d h = _mm256_loadu_pd(high + i);
+    __m256d l = _mm256_loadu_pd(low + i);
+    __m256d pc = _mm256_loadu_pd(prev_close + i);
+    __m256d hl = _mm256_sub_pd(h, l);
+    __m256d hc = _mm256_andnot_pd(sign, _mm256_sub_pd(h, pc));
+    __m256d lc = _mm256_andnot_pd(sign, _mm256_sub_pd(l, pc));
+    _mm256_storeu_pd(out + i, _mm256_max_pd(hl, _mm256_max_pd(hc, lc)));
+  }
+  true_range_scalar(high + i, low + i, prev_close + i, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+sq_distances_avx2(const float *const *columns, size_t dims,
+                  const float *query, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t d = 0; d < dims; ++d) {
+      __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(columns[d] + i),
+                                  _mm256_set1_ps(query[d]));
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(diff, diff));
+    }
+    _mm256_storeu_ps(out + i, acc);
+  }
+  // Tail: same arithmetic per point, so both paths agree exactly
+  for (; i < n; ++i) {
+    float s = 0;
+    for (size_t d = 0; d < dims; ++d) {
+      float diff = columns[d][i] - query[d];
+      s += diff * diff;
+    }
+    out[i] = s;
+  }
+}
+
+static bool detect_avx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+// --- Dispatch ---
+
+bool has_avx2() {
+#ifdef SIMD_HAVE_AVX2_PATH
+  static const bool supported = detect_avx2();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+double sum(const double *x, size_t n) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return sum_avx2(x, n);
+#endif
+  return sum_scalar(x, n);
+}
+
+void moments(const double *x, size_t n, double &sum, double &sum_sq) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return moments_avx2(x, n, sum, sum_sq);
+#endif
+  moments_scalar(x, n, sum, sum_sq);
+}
+
+double sum_sq_dev(const double *x, size_t n, double mean) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return sum_sq_dev_avx2(x, n, mean);
+#endif
+  return sum_sq_dev_scalar(x, n, mean);
+}
+
+double dot(const double *a, const double *b, size_t n) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return dot_avx2(a, b, n);
+#endif
+  return dot_scalar(a, b, n);
+}
+
+void true_range(const double *high, const double *low,
+                const double *prev_close, double *out, size_t n) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return true_range_avx2(high, low, prev_close, out, n);
+#endif
+  true_range_scalar(high, low, prev_close, out, n);
+}
+
+void sq_distances(const float *const *columns, size_t dims,
+                  const float *query, float *out, size_t n) {
+#ifdef SIMD_HAVE_AVX2_PATH
+  if (has_avx2())
+    return sq_distances_avx2(columns, dims, query, out, n);
+#endif
+  sq_distances_scalar(columns, dims, query, out, n);
+}
+
+void prefix_sum(const double *x, double *out, size_t n) {
+  // A running sum is a serial dependency chain; vector scans do not beat
+  // this loop on AVX2 for doubles, so it stays scalar and exact.
+  double s = 0;
+  for (size_t i = 0; i < n; ++i) {
+    s += x[i];
+    out[i] = s;
+  }
+}
+
+} // namespace simd
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+
+// Vectorized kernels behind the window indicators (SMA, Bollinger, VWAP,
+// volume z-score, true range) and the similarity index. Each call
+// dispatches at runtime to an AVX2 implementation when the CPU supports it
+// and to a portable scalar loop otherwise, so the binary does not need to
+// be built with -mavx2.
+//
+// The AVX2 paths sum in four lanes, so results can differ from a strictly
+// sequential loop in the last few bits.
+namespace simd {
+
+// True when the AVX2 kernels are in use (checked once per process)
+bool has_avx2();
+
+// x[0] + ... + x[n-1]
+double sum(const double *x, size_t n);
+
+// Sum and sum of squares in one pass (for mean / variance)
+void moments(const double *x, size_t n, double &sum, double &sum_sq);
+
+// Sum of (x[i] - mean)^2, the two-pass variance numerator
+double sum_sq_dev(const double *x, size_t n, double mean);
+
+// a[0]*b[0] + ... + a[n-1]*b[n-1] (price x volume)
+double dot(const double *a, const double *b, size_t n);
+
+// out[i] = max(high[i] - low[i], |high[i] - prev_close[i]|,
+//              |low[i] - prev_close[i]|)
+// Callers pass close.data() + first - 1 as prev_close.
+void true_range(const double *high, const double *low,
+                const double *prev_close, double *out, size_t n);
+
+// out[i] = x[0] + ... + x[i]; out may alias x
+void prefix_sum(const double *x, double *out, size_t n);
+
+// out[i] = (columns[0][i] - query[0])^2 + ... +
+//          (columns[dims-1][i] - query[dims-1])^2
+// Squared Euclidean distances from `query` to n points stored column-wise
+// (the similarity index layout), eight points per AVX2 step.
+void sq_distances(const float *const *columns, size_t dims,
+                  const float *query, float *out, size_t n);
+
+} // namespace simd
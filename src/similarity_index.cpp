@@ -0,0 +1,229 @@
+#include "similarity_index.hpp"
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Lloyd iterations per training; the centroids only steer which buckets a
+// query scans, so they need not converge
+static constexpr int KMEANS_ROUNDS = 8;
+// k-means runs on at most this many points per centroid
+static constexpr size_t SAMPLE_PER_CENTROID = 64;
+
+void SimilarityIndex::Block::push(uint64_t key, const Vector &point) {
+  for (size_t d = 0; d < DIMS; ++d)
+    values[d].push_back(point[d]);
+  keys.push_back(key);
+}
+
+SimilarityIndex::Vector SimilarityIndex::Block::at(size_t slot) const {
+  Vector point;
+  for (size_t d = 0; d < DIMS; ++d)
+    point[d] = values[d][slot];
+  return point;
+}
+
+void SimilarityIndex::Block::columns(const float *out[DIMS]) const {
+  for (size_t d = 0; d < DIMS; ++d)
+    out[d] = values[d].data();
+}
+
+SimilarityIndex::SimilarityIndex(size_t exact_limit, size_t probes)
+    : exact_limit_(exact_limit), probes_(std::max<size_t>(probes, 1)),
+      buckets_(1) {}
+
+void SimilarityIndex::insert(uint64_t key, const Vector &point) {
+  auto it = where_.find(key);
+  if (it != where_.end())
+    remove(it->second.first, it->second.second);
+
+  uint32_t bucket = approximate() ? nearest_buckets(point, 1)[0] : 0;
+  add(bucket, key, point);
+  if (recording_)
+    changes_.push_back({key, false, point});
+}
+
+bool SimilarityIndex::erase(uint64_t key) {
+  auto it = where_.find(key);
+  if (it == where_.end())
+    return false;
+  remove(it->second.first, it->second.second);
+  if (recording_)
+    changes_.push_back({key, true, Vector()});
+  return true;
+}
+
+bool SimilarityIndex::training_due() const {
+  if (!approximate())
+    return size() > exact_limit_;
+  return size() >= 2 * trained_size_ || size() < exact_limit_ / 2;
+}
+
+SimilarityIndex::Snapshot SimilarityIndex::snapshot() {
+  Snapshot snapshot;
+  snapshot.exact_limit = exact_limit_;
+  snapshot.probes = probes_;
+  snapshot.clustered =
+      approximate() ? size() >= exact_limit_ / 2 : size() > exact_limit_;
+  snapshot.keys.reserve(size());
+  snapshot.points.reserve(size());
+  for (const auto &b : buckets_) {
+    for (size_t i = 0; i < b.keys.size(); ++i) {
+      snapshot.points.push_back(b.at(i));
+      snapshot.keys.push_back(b.keys[i]);
+    }
+  }
+  recording_ = true;
+  changes_.clear();
+  return snapshot;
+}
+
+void SimilarityIndex::adopt(SimilarityIndex &trained) {
+  for (const auto &change : changes_) {
+    if (change.erased)
+      trained.erase(change.key);
+    else
+      trained.insert(change.key, change.point);
+  }
+  std::swap(*this, trained);
+  trained.recording_ = false;
+  trained.changes_.clear();
+}
+
+void SimilarityIndex::retrain() {
+  SimilarityIndex trained = train(snapshot());
+  adopt(trained);
+}
+
+std::vector<SimilarityIndex::Match>
+SimilarityIndex::nearest(const Vector &query, size_t k,
+                         const std::function<bool(uint64_t)> &accept) const {
+  // Max-heap on distance holding the best k so far
+  std::vector<Match> best;
+  if (k == 0)
+    return best;
+  auto closer = [](const Match &a, const Match &b) {
+    return a.distance < b.distance;
+  };
+
+  std::vector<uint32_t> probed =
+      approximate() ? nearest_buckets(query, probes_)
+                    : std::vector<uint32_t>{0};
+  thread_local std::vector<float> distances;
+  for (uint32_t bucket : probed) {
+    const Block &b = buckets_[bucket];
+    size_t n = b.keys.size();
+    distances.resize(n);
+    const float *columns[DIMS];
+    b.columns(columns);
+    simd::sq_distances(columns, DIMS, query.data(), distances.data(), n);
+
+    for (size_t i = 0; i < n; ++i) {
+      if (best.size() == k && distances[i] >= best.front().distance)
+        continue;
+      if (accept && !accept(b.keys[i]))
+        continue;
+      best.push_back({b.keys[i], distances[i]});
+      std::push_heap(best.begin(), best.end(), closer);
+      if (best.size() > k) {
+        std::pop_heap(best.begin(), best.end(), closer);
+        best.pop_back();
+      }
+    }
+  }
+  std::sort_heap(best.begin(), best.end(), closer);
+  return best;
+}
+
+void SimilarityIndex::add(uint32_t bucket, uint64_t key, const Vector &point) {
+  Block &b = buckets_[bucket];
+  where_[key] = {bucket, (uint32_t)b.keys.size()};
+  b.push(key, point);
+}
+
+void SimilarityIndex::remove(uint32_t bucket, uint32_t slot) {
+  // Swap with the last point so removal is O(1)
+  Block &b = buckets_[bucket];
+  size_t last = b.keys.size() - 1;
+  where_.erase(b.keys[slot]);
+  if (slot != last) {
+    for (size_t d = 0; d < DIMS; ++d)
+      b.values[d][slot] = b.values[d][last];
+    b.keys[slot] = b.keys[last];
+    where_[b.keys[slot]].second = slot;
+  }
+  for (size_t d = 0; d < DIMS; ++d)
+    b.values[d].pop_back();
+  b.keys.pop_back();
+}
+
+std::vector<uint32_t> SimilarityIndex::nearest_buckets(const Vector &point,
+                                                       size_t n) const {
+  size_t lists = centroids_.keys.size();
+  thread_local std::vector<float> distances;
+  distances.resize(lists);
+  const float *columns[DIMS];
+  centroids_.columns(columns);
+  simd::sq_distances(columns, DIMS, point.data(), distances.data(), lists);
+
+  std::vector<uint32_t> order(lists);
+  std::iota(order.begin(), order.end(), 0);
+  n = std::min(n, lists);
+  std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                    [](uint32_t a, uint32_t b) {
+                      return distances[a] < distances[b];
+                    });
+  order.resize(n);
+  return order;
+}
+
+SimilarityIndex SimilarityIndex::train(const Snapshot &snapshot) {
+  SimilarityIndex index(snapshot.exact_limit, snapshot.probes);
+  const std::vector<Vector> &points = snapshot.points;
+  size_t n = points.size();
+
+  if (snapshot.clustered && n > 0) {
+    size_t lists = std::clamp<size_t>((size_t)std::sqrt((double)n), 16, 4096);
+    size_t sample_size = std::min(n, lists * SAMPLE_PER_CENTROID);
+    std::vector<Vector> sample(sample_size);
+    for (size_t i = 0; i < sample_size; ++i)
+      sample[i] = points[i * n / sample_size];
+
+    // Seeded from evenly spaced sample points, so training is
+    // deterministic
+    std::vector<Vector> means(lists);
+    for (size_t c = 0; c < lists; ++c)
+      means[c] = sample[c * sample_size / lists];
+    for (int round = 0; round < KMEANS_ROUNDS; ++round) {
+      index.centroids_ = Block();
+      for (const auto &m : means)
+        index.centroids_.push(0, m);
+      std::vector<std::array<double, DIMS>> sums(lists);
+      std::vector<size_t> counts(lists, 0);
+      for (const auto &p : sample) {
+        uint32_t c = index.nearest_buckets(p, 1)[0];
+        ++counts[c];
+        for (size_t d = 0; d < DIMS; ++d)
+          sums[c][d] += p[d];
+      }
+      // An empty cluster keeps its previous centroid
+      for (size_t c = 0; c < lists; ++c)
+        if (counts[c])
+          for (size_t d = 0; d < DIMS; ++d)
+            means[c][d] = (float)(sums[c][d] / (double)counts[c]);
+    }
+    index.centroids_ = Block();
+    for (const auto &m : means)
+      index.centroids_.push(0, m);
+  }
+
+  bool approximate = index.approximate();
+  index.buckets_.assign(approximate ? index.centroids_.keys.size() : 1,
+                        Block());
+  index.where_.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    index.add(approximate ? index.nearest_buckets(points[i], 1)[0] : 0,
+              snapshot.keys[i], points[i]);
+  index.trained_size_ = approximate ? n : 0;
+  return index;
+}
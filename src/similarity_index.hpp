@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// k-nearest-neighbour search over fixed-size float vectors, keyed by a
+// caller-chosen integer.
+//
+// Up to exact_limit points are kept in one column-wise block and every
+// query scans all of them with simd::sq_distances (about 20 us for 20k
+// points). Beyond that the index trains k-means centroids (an inverted
+// file, IVF): each point lives in the bucket of its nearest centroid and a
+// query scans only the `probes` buckets nearest to it, so results become
+// approximate. The centroids are due for retraining whenever the index
+// has doubled since the last training, and are dropped again when it
+// shrinks below half of exact_limit.
+//
+// insert() and erase() never retrain: training touches every point, so it
+// is left to the owner, who can run it without holding its own lock. Once
+// training_due(), take a snapshot() (from then on changes are recorded),
+// train() on it with no lock held and adopt() the result; adopt() replays
+// the recorded changes onto it. retrain() does the three steps in place.
+// Until then queries stay correct, if slower.
+//
+// Not thread-safe; the owner serializes access (AnalysisStorage uses its
+// table lock).
+class SimilarityIndex {
+public:
+  static constexpr size_t DIMS = 8;
+  using Vector = std::array<float, DIMS>;
+
+  struct Match {
+    uint64_t key;
+    float distance; // Squared Euclidean
+  };
+
+  // The points and settings a training works from
+  struct Snapshot {
+    size_t exact_limit = 0, probes = 0;
+    bool clustered = false; // Train centroids, or go back to one bucket
+    std::vector<uint64_t> keys;
+    std::vector<Vector> points;
+  };
+
+  explicit SimilarityIndex(size_t exact_limit = 20000, size_t probes = 16);
+
+  // Adds a point, or moves it if the key is already present
+  void insert(uint64_t key, const Vector &point);
+  bool erase(uint64_t key);
+
+  size_t size() const { return where_.size(); }
+  bool approximate() const { return !centroids_.keys.empty(); }
+
+  bool training_due() const;
+  Snapshot snapshot();
+  static SimilarityIndex train(const Snapshot &snapshot);
+  // Takes over `trained` plus the changes since snapshot(); `trained` is
+  // left holding the old index, for the caller to free outside its lock
+  void adopt(SimilarityIndex &trained);
+  void retrain();
+
+  // The k nearest points, nearest first. `accept`, when given, filters
+  // candidates; it is only consulted for points close enough to make the
+  // result.
+  std::vector<Match>
+  nearest(const Vector &query, size_t k,
+          const std::function<bool(uint64_t)> &accept = nullptr) const;
+
+private:
+  // Points column-wise, the layout simd::sq_distances scans
+  struct Block {
+    std::vector<float> values[DIMS];
+    std::vector<uint64_t> keys;
+
+    void push(uint64_t key, const Vector &point);
+    Vector at(size_t slot) const;
+    void columns(const float *out[DIMS]) const;
+  };
+
+  size_t exact_limit_;
+  size_t probes_;
+  std::vector<Block> buckets_; // One while exact
+  Block centroids_;            // Empty while exact; keys are unused
+  // Key -> (bucket, slot)
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> where_;
+  size_t trained_size_ = 0;
+
+  // Changes since snapshot(), for adopt() to replay
+  struct Change {
+    uint64_t key;
+    bool erased;
+    Vector point;
+  };
+  bool recording_ = false;
+  std::vector<Change> changes_;
+
+  void add(uint32_t bucket, uint64_t key, const Vector &point);
+  void remove(uint32_t bucket, uint32_t slot);
+
+  // Indices of the n centroids nearest to `point`, nearest first
+  std::vector<uint32_t> nearest_buckets(const Vector &point, size_t n) const;
+};
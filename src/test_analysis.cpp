@@ -7,12 +7,12 @@ int main() {
   std::cout << "Starting Test Analysis..." << std::endl;
 
   // Generate dummy data (Sine wave + noise to simulate market)
-  std::vector<Candle> candles;
+  CandleSeries candles;
   int data_points = 200;
   double price = 100.0;
   for (int i = 0; i < data_points; ++i) {
     Candle c;
-    c.timestamp = "2023-01-01 10:00:00";
+    c.time = 1672567200 + i * 86400; // 2023-01-01 10:00:00 UTC, daily
     double trend = i * 0.05; // upward trend
     double noise = std::sin(i * 0.1) * 2.0;
 
@@ -46,7 +46,7 @@ int main() {
   std::cout << "Volatility: " << res.volatility_state << std::endl;
 
   if (res.regime_info.regime == "unknown") {
-    std::cerr << "Test Failed: ML output parsing failed or script error."
+    std::cerr << "Test Failed: regime model produced no classification."
               << std::endl;
     return 1;
   }
@@ -0,0 +1,587 @@
+#include "analysis_storage.hpp"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+static AnalysisRecord make_record(const std::string &ticker, double rsi) {
+  AnalysisRecord record{};
+  record.ticker = ticker;
+  record.model = "test";
+  record.rsi = rsi;
+  record.is_stock = true;
+  record.htf_rsi = 50.0;
+  record.state_history.push_back({0.1, 0.2, 0.3, 1704153600});
+  return record;
+}
+
+// Frames in a binary log: 6-byte header, then u32 length, u32 checksum
+// and the payload per record
+static size_t count_records(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  size_t records = 0;
+  for (size_t pos = 6; pos + 8 <= data.size(); ++records) {
+    uint32_t length;
+    std::memcpy(&length, data.data() + pos, 4);
+    pos += 8 + length;
+  }
+  return records;
+}
+
+static off_t file_size(const std::string &path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+int main() {
+  std::cout << "Starting analysis storage test..." << std::endl;
+
+  char dir_template[] = "/tmp/analysis_storage_test_XXXXXX";
+  std::string dir = mkdtemp(dir_template);
+  std::string path = dir + "/analyses.db";
+  std::string log = path + ".log";
+
+  std::vector<std::string> ids;
+
+  // 1. Writes only append to the log
+  {
+    AnalysisStorage storage(path, 1000000);
+    for (int i = 0; i < 20; ++i)
+      ids.push_back(storage.save_analysis(make_record("T" + std::to_string(i),
+                                                      30.0 + i)));
+    check(storage.update_feedback(ids[3], true, "hit tp"), "feedback found");
+    check(storage.update_feedback(ids[4], false, "stopped"), "feedback 2");
+    check(!storage.update_feedback("missing", true, ""), "unknown id");
+    check(storage.delete_analysis(ids[5]), "delete found");
+    check(!storage.delete_analysis(ids[5]), "delete twice");
+    check(count_records(log) == 23, "one log record per write");
+
+    auto recent = storage.get_recent_analyses(3);
+    check(storage.get_recent_analyses(0).empty(), "zero limit");
+    check(recent.size() == 3 && recent[0].id == ids[19], "newest first");
+    check(storage.get_recent_analyses(100).size() == 19, "delete applied");
+    auto wins = storage.get_successful_analyses();
+    check(wins.size() == 1 && wins[0].id == ids[3] &&
+              wins[0].feedback.remark == "hit tp",
+          "successful from log");
+    check(storage.get_failed_analyses().size() == 1, "failed from log");
+
+    // Rows handed out earlier are copies, unaffected by later writes
+    storage.save_analysis(make_record("T7", 70.0));
+    auto t7 = storage.get_ticker_analyses("T7");
+    check(t7.size() == 2 && t7[0].rsi == 70.0 && t7[1].id == ids[7],
+          "ticker postings newest first");
+    check(storage.get_ticker_analyses("T5").empty(), "postings follow delete");
+    check(storage.get_ticker_analyses("T7", 1).size() == 1, "ticker limit");
+    check(storage.delete_analysis(t7[0].id), "delete newest T7");
+    check(t7[0].rsi == 70.0, "copy survives delete");
+    check(storage.size() == 19, "size");
+  }
+
+  // 2. Reopen replays the log over the snapshot
+  {
+    AnalysisStorage storage(path, 1000000);
+    auto all = storage.get_recent_analyses(100);
+    check(all.size() == 19, "replayed count");
+    check(all.back().id == ids[0] && all.back().rsi == 30.0, "replayed data");
+    check(all.back().state_history.size() == 1, "replayed trajectory");
+    check(!storage.delete_analysis(ids[5]), "tombstone replayed");
+
+    // 3. Compaction folds the log into the snapshot
+    storage.compact();
+    check(count_records(log) == 0, "log emptied");
+    check(storage.get_recent_analyses(100).size() == 19, "compacted count");
+    check(storage.update_feedback(ids[0], true, "later"), "write after");
+  }
+  {
+    AnalysisStorage storage(path, 1000000);
+    check(storage.get_successful_analyses(10).size() == 2,
+          "snapshot plus new log");
+  }
+
+  // 4. Background compaction once the threshold is reached (the log still
+  // holds the feedback record from step 3)
+  {
+    AnalysisStorage storage(path, 5);
+    for (int i = 0; i < 4; ++i)
+      storage.save_analysis(make_record("BG", 40.0));
+    for (int i = 0; i < 200 && count_records(log) != 0; ++i)
+      usleep(10000);
+    check(count_records(log) == 0, "background compaction ran");
+    check(storage.get_recent_analyses(100).size() == 23, "nothing lost");
+  }
+
+  // 5. Crash leftovers: an interrupted compaction and a torn last frame
+  {
+    AnalysisStorage storage(path, 1000000);
+    storage.save_analysis(make_record("PRE", 1.0));
+  }
+  std::rename(log.c_str(), (path + ".log.old").c_str());
+  {
+    AnalysisStorage storage(path, 1000000);
+    auto all = storage.get_recent_analyses(100);
+    check(all.size() == 24 && all[0].ticker == "PRE", "rotated log folded");
+    check(access((path + ".log.old").c_str(), F_OK) != 0, "rotated removed");
+    check(storage.delete_analysis(ids[0]), "delete after fold");
+    storage.save_analysis(make_record("TORN", 3.0));
+  }
+  check(::truncate(log.c_str(), file_size(log) - 3) == 0, "tear log");
+  {
+    AnalysisStorage storage(path, 1000000);
+    auto all = storage.get_recent_analyses(100);
+    check(all.size() == 23 && all[0].ticker == "PRE", "torn frame dropped");
+    storage.save_analysis(make_record("POST", 2.0));
+  }
+  {
+    AnalysisStorage storage(path, 1000000);
+    auto all = storage.get_recent_analyses(1);
+    check(all.size() == 1 && all[0].ticker == "POST", "append after tear");
+    check(storage.size() == 24, "count after tear");
+  }
+
+  // 6. analyses.json and its log from before the binary format are
+  // imported into a new analyses.db
+  std::string legacy = dir + "/legacy.json";
+  {
+    AnalysisRecord record = make_record("OLD", 55.0);
+    record.id = "legacy-1";
+    json entry = record.to_json();
+    entry["state_history"][0]["t"] = "2024-01-02 00:00:00";
+    std::ofstream out(legacy);
+    out << json{{"analyses", json::array({entry})}}.dump(2);
+    std::ofstream log_out(legacy + ".log");
+    log_out << "{\"op\":\"feedback\",\"id\":\"legacy-1\","
+               "\"success\":true,\"remark\":\"old\"}\n";
+  }
+  {
+    AnalysisStorage storage(dir + "/legacy.db");
+    auto all = storage.get_recent_analyses();
+    check(all.size() == 1 && all[0].id == "legacy-1", "legacy imported");
+    check(all[0].feedback.submitted && all[0].feedback.remark == "old",
+          "legacy log replayed");
+    check(!all[0].state_history.empty() &&
+              all[0].state_history[0].to_json()["t"] == "2024-01-02 00:00:00",
+          "legacy bar time parsed");
+  }
+  {
+    std::ifstream in(dir + "/legacy.db", std::ios::binary);
+    char magic[4] = {};
+    in.read(magic, 4);
+    check(std::string(magic, 4) == "ANLS", "imported as binary");
+    AnalysisStorage storage(dir + "/legacy.db");
+    check(storage.size() == 1, "binary reload");
+  }
+
+  // 7. Paged, filtered queries
+  {
+    AnalysisStorage storage(dir + "/query.db");
+    std::vector<std::string> qids;
+    for (int i = 0; i < 30; ++i) {
+      AnalysisRecord record = make_record(i % 3 ? "AAPL" : "BTC-USD", i);
+      record.model = i % 2 ? "a" : "b";
+      qids.push_back(storage.save_analysis(record));
+    }
+    for (int i = 0; i < 30; i += 4)
+      storage.update_feedback(qids[i], i % 8 == 0, "");
+
+    // Pages chain without gaps or repeats, even across a delete
+    AnalysisQuery q;
+    q.limit = 7;
+    std::vector<std::string> seen;
+    AnalysisPage page = storage.query(q);
+    for (const auto &r : page.records)
+      seen.push_back(r->id);
+    storage.delete_analysis(seen.back());
+    seen.pop_back();
+    while (page.next_cursor) {
+      q.cursor = page.next_cursor;
+      page = storage.query(q);
+      for (const auto &r : page.records)
+        seen.push_back(r->id);
+    }
+    std::vector<std::string> expected(qids.rbegin(), qids.rend());
+    expected.erase(expected.begin() + 6);
+    check(seen == expected, "cursor pages");
+
+    AnalysisQuery by_ticker;
+    by_ticker.ticker = "BTC-USD";
+    by_ticker.model = "b";
+    page = storage.query(by_ticker);
+    check(page.records.size() == 5 && page.next_cursor == 0,
+          "ticker and model filter");
+    for (const auto &r : page.records)
+      check(r->ticker == "BTC-USD" && r->model == "b", "filtered rows");
+
+    AnalysisQuery wins;
+    wins.feedback = AnalysisQuery::Feedback::Success;
+    check(storage.query(wins).records.size() == 4, "success filter");
+    wins.feedback = AnalysisQuery::Feedback::Failed;
+    check(storage.query(wins).records.size() == 4, "failed filter");
+    wins.feedback = AnalysisQuery::Feedback::Pending;
+    check(storage.query(wins).records.size() == 21, "pending filter");
+
+    AnalysisQuery dates;
+    dates.from = "2000-01-01";
+    dates.to = "2000-12-31";
+    check(storage.query(dates).records.empty(), "date range excludes");
+    std::string today = page.records[0]->timestamp.substr(0, 10);
+    dates.from = today;
+    dates.to = today;
+    size_t same_day = 0;
+    for (const auto &r : storage.get_recent_analyses(100))
+      same_day += r.timestamp.compare(0, 10, today) == 0;
+    check(storage.query(dates).records.size() == same_day && same_day > 0,
+          "date prefix covers day");
+
+    json summary = page.records[0]->to_json(true);
+    check(!summary.contains("state_history") &&
+              !summary.contains("ai_prediction") && summary.contains("id") &&
+              summary.contains("trading_levels"),
+          "summary projection");
+  }
+
+  // 8. Change feed
+  {
+    AnalysisStorage storage(dir + "/feed.db", 1000000);
+    uint64_t start = storage.version();
+    check(start > 1000000000000000ull, "versions start from the clock");
+    std::string a = storage.save_analysis(make_record("A", 1.0));
+    std::string b = storage.save_analysis(make_record("B", 2.0));
+    storage.update_feedback(a, true, "");
+    storage.delete_analysis(b);
+
+    AnalysisChanges feed =
+        storage.changes_since(start, 100, std::chrono::milliseconds(0));
+    check(!feed.reset && feed.changes.size() == 4, "four changes");
+    check(feed.version == start + 4 && storage.version() == start + 4,
+          "versions consecutive");
+    check(feed.changes[0].kind == AnalysisChange::Kind::Insert &&
+              feed.changes[0].id == a && feed.changes[0].record,
+          "insert carries row");
+    check(feed.changes[2].kind == AnalysisChange::Kind::Feedback &&
+              feed.changes[2].record->feedback.success,
+          "feedback carries new row");
+    check(feed.changes[3].kind == AnalysisChange::Kind::Delete &&
+              feed.changes[3].id == b && !feed.changes[3].record,
+          "delete");
+
+    feed = storage.changes_since(start + 1, 2, std::chrono::milliseconds(0));
+    check(feed.changes.size() == 2 && feed.version == start + 3,
+          "limit continues mid-feed");
+    check(storage.query(AnalysisQuery{}).version == start + 4,
+          "page carries version");
+
+    // Long poll: returns as soon as another thread writes
+    auto begin = std::chrono::steady_clock::now();
+    std::thread writer([&storage] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      storage.save_analysis(make_record("C", 3.0));
+    });
+    feed = storage.changes_since(start + 4, 100, std::chrono::seconds(10));
+    writer.join();
+    check(feed.changes.size() == 1 && feed.changes[0].record->ticker == "C",
+          "long poll woken");
+    check(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5),
+          "long poll did not time out");
+    feed = storage.changes_since(start + 5, 100, std::chrono::milliseconds(20));
+    check(feed.changes.empty() && !feed.reset && feed.version == start + 5,
+          "long poll timeout");
+
+    // Versions from another run or older than the ring ask for a reload
+    check(storage.changes_since(start + 99, 10, std::chrono::seconds(0)).reset,
+          "future version resets");
+    std::streambuf *quiet = std::cout.rdbuf(nullptr);
+    for (size_t i = 0; i < AnalysisStorage::CHANGE_RING; ++i)
+      storage.save_analysis(make_record("BULK", 0.0));
+    std::cout.rdbuf(quiet);
+    check(storage.changes_since(start, 10, std::chrono::seconds(0)).reset,
+          "evicted version resets");
+    check(!storage.changes_since(storage.version() - 5, 10,
+                                 std::chrono::seconds(0))
+               .reset,
+          "recent version kept");
+  }
+
+  // 9. Outcome counters follow saves, feedback changes and deletes, and
+  // are rebuilt from disk
+  {
+    std::string stats_path = dir + "/stats.db";
+    auto signal = [](const std::string &ticker, const std::string &regime,
+                     const std::string &direction, double volatility) {
+      AnalysisRecord record = make_record(ticker, 50.0);
+      record.regime = regime;
+      record.direction = direction;
+      record.volatility_state = volatility;
+      return record;
+    };
+    {
+      AnalysisStorage storage(stats_path);
+      std::string a =
+          storage.save_analysis(signal("AAPL", "trend", "long", 0.8));
+      std::string b =
+          storage.save_analysis(signal("AAPL", "range", "short", 0.2));
+      std::string c = storage.save_analysis(make_record("BTC-USD", 50.0));
+      AnalysisStats stats = storage.stats();
+      check(stats.total.analyses == 3 && stats.total.submitted == 0,
+            "counted on save");
+      check(stats.by_regime.count("unknown") &&
+                stats.by_volatility["unknown"].analyses == 1,
+            "records without signals grouped as unknown");
+
+      storage.update_feedback(a, true, "");
+      storage.update_feedback(b, false, "");
+      storage.update_feedback(c, true, "");
+      storage.update_feedback(b, true, "re-graded");
+      storage.delete_analysis(c);
+
+      stats = storage.stats();
+      check(stats.total.analyses == 2 && stats.total.submitted == 2 &&
+                stats.total.success == 2 && stats.total.failed == 0,
+            "totals follow feedback changes and deletes");
+      check(stats.by_ticker.size() == 1 &&
+                stats.by_ticker["AAPL"].win_rate() == 1.0,
+            "per ticker");
+      check(stats.by_regime["trend"].success == 1 &&
+                stats.by_regime["range"].success == 1 &&
+                !stats.by_regime.count("unknown"),
+            "per regime; emptied groups dropped");
+      check(stats.by_direction["long"].submitted == 1 &&
+                stats.by_direction["short"].submitted == 1,
+            "per direction");
+      check(stats.by_volatility["high"].analyses == 1 &&
+                stats.by_volatility["low"].analyses == 1,
+            "per volatility bucket");
+      check(stats.by_model["test"].submitted == 2, "per model");
+      check(stats.version == storage.version(), "stats carry version");
+    }
+    AnalysisStorage storage(stats_path);
+    AnalysisStats stats = storage.stats();
+    check(stats.total.analyses == 2 && stats.total.success == 2 &&
+              stats.by_regime["trend"].success == 1 &&
+              stats.by_volatility["high"].analyses == 1,
+          "counters rebuilt on reopen");
+  }
+
+  // 10. Similar setups: nearest graded analyses first, index kept in step
+  // with deletes and rebuilt on reopen
+  {
+    std::string similar_path = dir + "/similar.db";
+    std::string rsi_70;
+    {
+      AnalysisStorage storage(similar_path);
+      std::vector<std::string> ids;
+      for (int rsi = 20; rsi <= 80; rsi += 10)
+        ids.push_back(storage.save_analysis(make_record("S", rsi)));
+      rsi_70 = ids[5];
+      storage.update_feedback(ids[5], true, "");
+      storage.update_feedback(ids[1], false, "");
+      storage.update_feedback(ids[6], true, "");
+
+      AnalysisRecord probe = make_record("NEW", 71.0);
+      auto graded = storage.similar_analyses(probe, 2);
+      check(graded.size() == 2 && graded[0].record->id == ids[5] &&
+                graded[1].record->id == ids[6],
+            "nearest graded first");
+      auto all = storage.similar_analyses(probe, 3, false);
+      check(all.size() == 3 && all[1].record->id == ids[6] &&
+                all[2].record->id == ids[4] &&
+                all[0].distance <= all[1].distance,
+            "ungraded included on request");
+      check(storage.similar_analyses(probe, 10).size() == 3,
+            "only graded rows");
+
+      storage.delete_analysis(ids[6]);
+      graded = storage.similar_analyses(probe, 2);
+      check(graded.size() == 2 && graded[1].record->id == ids[1],
+            "deleted row leaves the index");
+    }
+    AnalysisStorage storage(similar_path);
+    auto graded = storage.similar_analyses(make_record("NEW", 69.0), 1);
+    check(graded.size() == 1 && graded[0].record->id == rsi_70 &&
+              graded[0].record->feedback.success,
+          "index rebuilt on reopen");
+  }
+
+  // 11. Concurrent writers and readers: nothing lost, every read consistent
+  std::string shared = dir + "/shared.db";
+  {
+    AnalysisStorage storage(shared, 64);
+    std::vector<std::thread> threads;
+    std::atomic<int> bad_reads{0};
+    for (int w = 0; w < 4; ++w) {
+      threads.emplace_back([&storage, w] {
+        for (int i = 0; i < 100; ++i) {
+          std::string id =
+              storage.save_analysis(make_record("W" + std::to_string(w), i));
+          if (i % 2)
+            storage.update_feedback(id, i % 4 == 1, "");
+          if (i % 10 == 9)
+            storage.delete_analysis(id);
+        }
+      });
+    }
+    for (int r = 0; r < 4; ++r) {
+      threads.emplace_back([&storage, &bad_reads] {
+        for (int i = 0; i < 200; ++i) {
+          auto recent = storage.get_recent_analyses(20);
+          for (size_t k = 1; k < recent.size(); ++k)
+            if (recent[k].id == recent[k - 1].id)
+              ++bad_reads;
+          for (const auto &record : storage.get_successful_analyses(20))
+            if (!record.feedback.submitted || !record.feedback.success)
+              ++bad_reads;
+        }
+      });
+    }
+    for (auto &t : threads)
+      t.join();
+    check(bad_reads == 0, "consistent concurrent reads");
+    check(storage.size() == 360, "concurrent writes kept");
+    check(storage.get_successful_analyses(1000).size() == 4 * 20,
+          "concurrent feedback kept");
+    AnalysisStats stats = storage.stats();
+    check(stats.total.analyses == 360 && stats.total.success == 4 * 20 &&
+              stats.total.failed == 4 * 20,
+          "concurrent counters");
+  }
+  {
+    AnalysisStorage storage(shared);
+    check(storage.size() == 360, "concurrent writes persisted");
+    check(storage.get_failed_analyses(1000).size() == 4 * 20,
+          "concurrent feedback persisted");
+  }
+
+  // 12. Ids are ULIDs in creation order; `to` bounds are found through
+  // them, next to older ids keyed by their timestamp
+  {
+    std::string mixed = dir + "/mixed.json";
+    {
+      AnalysisRecord record = make_record("OLD", 55.0);
+      record.id = "0f3c2a1e-1111-2222-3333-444455556666";
+      record.timestamp = "2024-03-01 12:00:00";
+      std::ofstream out(mixed);
+      out << json{{"analyses", json::array({record.to_json()})}}.dump();
+    }
+    AnalysisStorage storage(dir + "/mixed.db");
+    std::vector<std::string> ids;
+    for (int i = 0; i < 200; ++i)
+      ids.push_back(storage.save_analysis(make_record("NEW", i)));
+    bool ulids = true;
+    for (const auto &id : ids)
+      ulids = ulids && id.size() == 26 &&
+              id.find_first_not_of("0123456789ABCDEFGHJKMNPQRSTVWXYZ") ==
+                  std::string::npos;
+    check(ulids, "ULID format");
+    check(std::is_sorted(ids.begin(), ids.end()) &&
+              std::adjacent_find(ids.begin(), ids.end()) == ids.end(),
+          "ids strictly increasing");
+
+    AnalysisQuery old;
+    old.to = "2024-06";
+    AnalysisPage page = storage.query(old);
+    check(page.records.size() == 1 && page.records[0]->ticker == "OLD",
+          "to bound through the time index");
+    old.from = "2024-03-02";
+    check(storage.query(old).records.empty(), "from bound");
+    AnalysisQuery recent;
+    recent.to = "2999";
+    recent.limit = 500;
+    check(storage.query(recent).records.size() == 201, "open to bound");
+    AnalysisQuery none;
+    none.to = "2001-01-01";
+    check(storage.query(none).records.empty(), "to before every row");
+  }
+
+  // 13. A change the log cannot take fails and leaves the table alone
+  {
+    std::string failing = dir + "/failing.db";
+    {
+      AnalysisStorage storage(failing);
+      std::string kept = storage.save_analysis(make_record("KEPT", 40.0));
+      // Room for part of a frame only
+      std::signal(SIGXFSZ, SIG_IGN);
+      struct rlimit limit, tight;
+      getrlimit(RLIMIT_FSIZE, &limit);
+      tight = limit;
+      tight.rlim_cur = (rlim_t)file_size(failing + ".log") + 10;
+      setrlimit(RLIMIT_FSIZE, &tight);
+      auto throws = [](auto &&write) {
+        try {
+          write();
+        } catch (const std::runtime_error &) {
+          return true;
+        }
+        return false;
+      };
+      check(throws([&] { storage.save_analysis(make_record("LOST", 41.0)); }),
+            "save fails");
+      check(throws([&] { storage.update_feedback(kept, true, "x"); }),
+            "feedback fails");
+      check(throws([&] { storage.delete_analysis(kept); }), "delete fails");
+      setrlimit(RLIMIT_FSIZE, &limit);
+      check(storage.size() == 1 && storage.stats().total.submitted == 0,
+            "table unchanged");
+      storage.save_analysis(make_record("AFTER", 42.0));
+    }
+    AnalysisStorage reopened(failing);
+    auto rows = reopened.get_recent_analyses();
+    check(rows.size() == 2 && rows[0].ticker == "AFTER" &&
+              reopened.stats().total.submitted == 0,
+          "partial frame cut off, later records kept");
+
+    // A failed start-up rewrite still leaves the log open for writes
+    std::string stuck = dir + "/stuck.db";
+    std::system(("cp " + dir + "/legacy.json " + dir + "/stuck.json").c_str());
+    ::symlink((dir + "/missing/stuck.tmp").c_str(), (stuck + ".tmp").c_str());
+    {
+      AnalysisStorage storage(stuck);
+      storage.save_analysis(make_record("NEW", 43.0));
+    }
+    check(AnalysisStorage(stuck).size() == 2, "saved without a snapshot");
+
+    // No log at all: nothing is accepted that a restart would lose
+    std::string blocked = dir + "/blocked.db";
+    check(::symlink((dir + "/missing/analyses.log").c_str(),
+                    (blocked + ".log").c_str()) == 0,
+          "log path blocked");
+    AnalysisStorage storage(blocked);
+    bool threw = false;
+    try {
+      storage.save_analysis(make_record("LOST", 41.0));
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    check(threw && storage.size() == 0, "unopened log refuses writes");
+  }
+
+  std::system(("rm -rf " + dir).c_str());
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
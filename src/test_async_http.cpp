@@ -0,0 +1,139 @@
+#include "async_http.hpp"
+#include "httplib.h"
+#include <chrono>
+#include <curl/curl.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Runs AsyncHttp against a local httplib server: concurrent slow requests
+// must overlap, POST bodies and status codes must round-trip, and transport
+// failures must come back as errors rather than exceptions.
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+int main() {
+  std::cout << "Starting async HTTP test..." << std::endl;
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  httplib::Server svr;
+  svr.Get("/slow", [](const httplib::Request &, httplib::Response &res) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    res.set_content("slow", "text/plain");
+  });
+  svr.Post("/echo", [](const httplib::Request &req, httplib::Response &res) {
+    res.set_content(req.get_header_value("X-Tag") + ":" + req.body,
+                    "text/plain");
+  });
+  svr.Get("/stall", [](const httplib::Request &, httplib::Response &res) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    res.set_content("late", "text/plain");
+  });
+  svr.Get("/missing", [](const httplib::Request &, httplib::Response &res) {
+    res.status = 404;
+  });
+  svr.Get("/drip", [](const httplib::Request &, httplib::Response &res) {
+    res.set_chunked_content_provider(
+        "text/plain", [](size_t offset, httplib::DataSink &sink) {
+          if (offset >= 3) {
+            sink.done();
+            return true;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          return sink.write("x", 1);
+        });
+  });
+  int port = svr.bind_to_any_port("127.0.0.1");
+  std::thread server([&] { svr.listen_after_bind(); });
+  svr.wait_until_ready();
+  std::string base = "http://127.0.0.1:" + std::to_string(port);
+
+  {
+    AsyncHttp http;
+
+    // 1. Five 300 ms requests overlap instead of taking 1.5 s
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<HttpResponse>> pending;
+    for (int i = 0; i < 5; ++i)
+      pending.push_back(http.submit({base + "/slow"}));
+    bool all_ok = true;
+    for (auto &f : pending) {
+      HttpResponse r = f.get();
+      all_ok = all_ok && r.ok() && r.body == "slow";
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    check(all_ok, "slow responses");
+    check(elapsed < std::chrono::milliseconds(1000),
+          "requests ran concurrently");
+
+    // 2. POST with headers
+    HttpRequest post;
+    post.url = base + "/echo";
+    post.post = true;
+    post.body = "{\"a\":1}";
+    post.headers = {"X-Tag: t1", "Content-Type: application/json"};
+    HttpResponse echoed = http.fetch(post);
+    check(echoed.ok() && echoed.body == "t1:{\"a\":1}", "POST round trip");
+
+    // 3. HTTP error status is not a transport error
+    HttpResponse missing = http.fetch({base + "/missing"});
+    check(missing.error.empty() && missing.status == 404 && !missing.ok(),
+          "404 reported as status");
+
+    // 4. Connection refused / timeout surface as errors
+    HttpResponse refused = http.fetch({"http://127.0.0.1:1/"});
+    check(!refused.error.empty() && !refused.timed_out,
+          "connection error reported");
+    HttpRequest slow;
+    slow.url = base + "/slow";
+    slow.timeout_ms = 50;
+    HttpResponse late = http.fetch(slow);
+    check(!late.error.empty() && late.timed_out, "timeout reported");
+
+    // A transfer that goes quiet is given up without a total limit
+    HttpRequest stall;
+    stall.url = base + "/stall";
+    stall.timeout_ms = 0;
+    stall.stall_timeout_s = 1;
+    auto stall_start = std::chrono::steady_clock::now();
+    HttpResponse stalled = http.fetch(stall);
+    check(stalled.timed_out &&
+              std::chrono::steady_clock::now() - stall_start <
+                  std::chrono::milliseconds(2400),
+          "stall reported");
+
+    // 5. on_data sees the body as it arrives, not at the end
+    HttpRequest drip;
+    drip.url = base + "/drip";
+    std::vector<std::chrono::steady_clock::time_point> arrivals;
+    std::string streamed;
+    drip.on_data = [&](const char *data, size_t size) {
+      arrivals.push_back(std::chrono::steady_clock::now());
+      streamed.append(data, size);
+    };
+    HttpResponse dripped = http.fetch(drip);
+    check(dripped.ok() && dripped.body.empty() && streamed == "xxx",
+          "streamed body");
+    check(arrivals.size() == 3 &&
+              arrivals.back() - arrivals.front() >=
+                  std::chrono::milliseconds(150),
+          "pieces delivered as sent");
+  }
+
+  svr.stop();
+  server.join();
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " checks." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "analysis.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+static CandleSeries make_series(int bars, double drift, int seed) {
+  srand(seed);
+  CandleSeries candles;
+  double price = 100.0;
+  for (int i = 0; i < bars; ++i) {
+    Candle c;
+    c.time = 1672567200 + (int64_t)i * 86400;
+    double move =
+        std::sin(i * 0.1) * 0.8 + drift + ((rand() % 100) / 100.0 - 0.5);
+    c.open = price;
+    c.close = price + move;
+    c.high = std::max(c.open, c.close) + 0.5;
+    c.low = std::min(c.open, c.close) - 0.5;
+    c.volume = 1000 + (rand() % 500);
+    candles.push_back(c);
+    price = c.close;
+  }
+  return candles;
+}
+
+int main() {
+  std::cout << "Starting batch analysis test..." << std::endl;
+
+  WorkStealingPool pool(4);
+
+  // 1. parallel_for visits every index exactly once, even with skewed work
+  std::vector<std::atomic<int>> visits(1000);
+  pool.parallel_for(visits.size(), [&](size_t i) {
+    if (i < 8) // A few slow items up front force the others to steal
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ++visits[i];
+  });
+  bool once = true;
+  for (auto &v : visits)
+    once = once && v == 1;
+  check(once, "every index visited once");
+
+  // 2. Exceptions surface after the whole range ran
+  std::atomic<int> ran{0};
+  bool threw = false;
+  try {
+    pool.parallel_for(100, [&](size_t i) {
+      ++ran;
+      if (i == 42)
+        throw std::runtime_error("boom");
+    });
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  check(threw, "exception rethrown");
+  check(ran == 100, "batch not aborted by exception");
+
+  // 3. Batch results match the single-ticker path, in input order
+  std::vector<BatchItem> items;
+  for (int t = 0; t < 40; ++t) {
+    BatchItem item;
+    item.ticker = "T" + std::to_string(t);
+    item.candles = make_series(60 + t * 10, 0.01 * (t % 7) - 0.03, t);
+    item.is_stock = t % 3 != 0;
+    items.push_back(item);
+  }
+  items[7].candles = CandleSeries{}; // Failing ticker
+
+  auto results = TechnicalAnalysis::calculate_batch(items, 50, &pool);
+  check(results.size() == items.size(), "result count");
+  for (size_t i = 0; i < items.size(); ++i) {
+    const BatchResult &r = results[i];
+    check(r.ticker == items[i].ticker, "result order");
+    check(r.elapsed_ms >= 0.0, "timing recorded");
+    if (i == 7) {
+      check(!r.ok(), "empty series reported as error");
+      continue;
+    }
+    check(r.ok(), "ticker succeeded");
+    AnalysisResult expected = TechnicalAnalysis::calculate_indicators(
+        items[i].candles, {}, items[i].is_stock);
+    check(r.result.current_rsi == expected.current_rsi &&
+              r.result.take_profit == expected.take_profit &&
+              r.result.signal_strength == expected.signal_strength &&
+              r.result.state_history.size() == expected.state_history.size(),
+          "batch matches calculate_indicators");
+  }
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " checks." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
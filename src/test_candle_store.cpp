@@ -0,0 +1,116 @@
+#include "candle_store.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+// FileProvider that records how it was called
+class CountingProvider : public FileProvider {
+public:
+  using FileProvider::FileProvider;
+
+  CandleSeries fetch(const std::string &ticker, const std::string &interval,
+                     int64_t since) override {
+    ++calls;
+    last_since = since;
+    return FileProvider::fetch(ticker, interval, since);
+  }
+
+  int calls = 0;
+  int64_t last_since = -1;
+};
+
+static void write_csv(const std::string &path, int bars, double last_close) {
+  std::ofstream out(path);
+  out << "time,open,high,low,close,volume\n";
+  for (int i = 0; i < bars; ++i) {
+    double close = (i == bars - 1) ? last_close : 100.0 + i;
+    out << 1672567200 + (int64_t)i * 86400 << "," << 100.0 + i << ","
+        << close + 1 << "," << close - 1 << "," << close << "," << 1000 + i
+        << "\n";
+  }
+}
+
+int main() {
+  std::cout << "Starting candle store test..." << std::endl;
+
+  char dir_template[] = "/tmp/candle_store_test_XXXXXX";
+  std::string dir = mkdtemp(dir_template);
+  std::string csv = dir + "/AAPL_1d.csv";
+  CountingProvider provider(dir);
+
+  // 1. Miss: full fetch, written to disk
+  write_csv(csv, 60, 159.0);
+  {
+    CandleStore store(dir + "/cache", provider, 3600);
+    CandleSeries first = store.get("AAPL", "1d");
+    check(first.size() == 60, "full history cached");
+    check(provider.calls == 1 && provider.last_since == 0, "full fetch");
+
+    // 2. Fresh hit: no provider call
+    CandleSeries again = store.get("AAPL", "1d");
+    check(provider.calls == 1, "fresh cache served without fetch");
+    check(again.size() == 60 && again.close.back() == 159.0, "hit contents");
+  }
+
+  // 3. Reopen with max_age 0: delta fetch from the last cached bar, which
+  //    is overwritten (it changed) and followed by the new bars
+  write_csv(csv, 65, 42.0);
+  {
+    CandleStore store(dir + "/cache", provider, 0);
+    CandleSeries updated = store.get("AAPL", "1d");
+    check(provider.calls == 2, "stale cache refetched");
+    check(provider.last_since == 1672567200 + 59 * 86400,
+          "delta starts at last cached bar");
+    check(updated.size() == 65, "new bars appended");
+    check(updated.close[59] == 159.0, "last cached bar replaced");
+    check(updated.close.back() == 42.0, "newest bar present");
+    bool ordered = true;
+    for (size_t i = 1; i < updated.size(); ++i)
+      ordered = ordered && updated.time[i] > updated.time[i - 1];
+    check(ordered, "no duplicate timestamps");
+  }
+
+  // 4. Provider has nothing: cached bars are still served
+  std::remove(csv.c_str());
+  {
+    CandleStore store(dir + "/cache", provider, 0);
+    CandleSeries cached = store.get("AAPL", "1d");
+    check(cached.size() == 65, "cache survives provider failure");
+
+    store.invalidate("AAPL", "1d");
+    check(store.get("AAPL", "1d").empty(), "invalidate drops the cache");
+  }
+
+  // 5. Corrupt file is discarded and refetched
+  write_csv(csv, 10, 109.0);
+  {
+    std::ofstream junk(dir + "/cache/AAPL_1d.bin", std::ios::binary);
+    junk << "not a candle file at all, definitely longer than a header";
+  }
+  {
+    CandleStore store(dir + "/cache", provider, 3600);
+    check(store.get("AAPL", "1d").size() == 10, "corrupt cache rebuilt");
+  }
+
+  std::string cleanup = "rm -rf " + dir;
+  std::system(cleanup.c_str());
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " checks." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
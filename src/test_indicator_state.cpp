@@ -0,0 +1,189 @@
+#include "analysis.hpp"
+#include "indicator_state.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static int failures = 0;
+
+static void expect_close(const char *name, size_t bars, double batch,
+                         double stream) {
+  double tol = 1e-9 * std::max(1.0, std::abs(batch));
+  if (std::abs(batch - stream) > tol) {
+    std::cerr << "Mismatch at " << bars << " bars: " << name
+              << " batch=" << batch << " stream=" << stream << std::endl;
+    ++failures;
+  }
+}
+
+// For values both paths compute the same way
+static void expect_same(const char *name, size_t bars, double batch,
+                        double stream) {
+  if (batch != stream) {
+    std::cerr << "Mismatch at " << bars << " bars: " << name
+              << " batch=" << batch << " stream=" << stream << std::endl;
+    ++failures;
+  }
+}
+
+static void compare(size_t bars, const AnalysisResult &b,
+                    const AnalysisResult &s) {
+  expect_close("rsi", bars, b.current_rsi, s.current_rsi);
+  expect_close("macd", bars, b.macd, s.macd);
+  expect_close("macd_signal", bars, b.macd_signal, s.macd_signal);
+  expect_close("sma_50", bars, b.sma_50, s.sma_50);
+  expect_close("sma_200", bars, b.sma_200, s.sma_200);
+  expect_close("adx", bars, b.adx, s.adx);
+  expect_same("boll_upper", bars, b.boll_upper, s.boll_upper);
+  expect_same("boll_lower", bars, b.boll_lower, s.boll_lower);
+  expect_close("atr_median", bars, b.atr_median, s.atr_median);
+  expect_close("volume_z_score", bars, b.volume_z_score, s.volume_z_score);
+  expect_close("roc_5", bars, b.roc_5, s.roc_5);
+  expect_close("roc_20", bars, b.roc_20, s.roc_20);
+  expect_close("obv", bars, b.obv, s.obv);
+  expect_close("vwap_dist", bars, b.vwap_dist, s.vwap_dist);
+  expect_close("range_pos", bars, b.range_pos, s.range_pos);
+  expect_close("htf_rsi", bars, b.htf_rsi, s.htf_rsi);
+  expect_close("htf_sma_50", bars, b.htf_sma_50, s.htf_sma_50);
+  expect_close("momentum_state", bars, b.momentum_state, s.momentum_state);
+  expect_close("trend_state", bars, b.trend_state, s.trend_state);
+  expect_close("volatility_state", bars, b.volatility_state,
+               s.volatility_state);
+  expect_close("stop_loss", bars, b.stop_loss, s.stop_loss);
+  expect_close("take_profit", bars, b.take_profit, s.take_profit);
+
+  if (b.state_history.size() != s.state_history.size()) {
+    std::cerr << "Mismatch at " << bars << " bars: state_history size "
+              << b.state_history.size() << " vs " << s.state_history.size()
+              << std::endl;
+    ++failures;
+    return;
+  }
+  for (size_t k = 0; k < b.state_history.size(); ++k) {
+    expect_close("state.x", bars, b.state_history[k].x, s.state_history[k].x);
+    expect_close("state.y", bars, b.state_history[k].y, s.state_history[k].y);
+    expect_close("state.z", bars, b.state_history[k].z, s.state_history[k].z);
+    if (b.state_history[k].time != s.state_history[k].time)
+      ++failures;
+  }
+}
+
+int main() {
+  std::cout << "Starting IndicatorState parity test..." << std::endl;
+
+  // Trend + sine + noise, with a flat stretch to exercise zero windows
+  srand(42);
+  CandleSeries all;
+  double price = 100.0;
+  for (int i = 0; i < 600; ++i) {
+    Candle c;
+    c.time = 1672567200 + (int64_t)i * 86400;
+    bool flat = (i >= 300 && i < 330);
+    double move = flat ? 0.0
+                       : std::sin(i * 0.1) * 0.8 + 0.03 +
+                             ((rand() % 100) / 100.0 - 0.5);
+    c.open = price;
+    c.close = price + move;
+    c.high = flat ? price : std::max(c.open, c.close) + 0.5;
+    c.low = flat ? price : std::min(c.open, c.close) - 0.5;
+    c.volume = flat ? 1000 : 1000 + (rand() % 500);
+    all.push_back(c);
+    price = c.close;
+  }
+
+  CandleSeries htf;
+  for (size_t i = 0; i + 5 <= all.size(); i += 5)
+    htf.push_back(all[i + 4]);
+
+  const size_t checkpoints[] = {1, 5, 15, 20, 27, 28, 30, 51, 60, 120, 260, 331,
+                                600};
+  IndicatorState state = IndicatorState::from_series({}, htf, true);
+  size_t fed = 0;
+  for (size_t n : checkpoints) {
+    while (fed < n)
+      state.update(all[fed++]);
+
+    CandleSeries prefix;
+    for (size_t i = 0; i < n; ++i)
+      prefix.push_back(all[i]);
+    compare(n, TechnicalAnalysis::calculate_indicators(prefix, htf, true),
+            state.result());
+  }
+
+  // Full-series trajectory (trajectory_len = 0) from both paths
+  IndicatorState full = IndicatorState::from_series(all, htf, true, 0);
+  AnalysisResult batch_full =
+      TechnicalAnalysis::calculate_indicators(all, htf, true, 0);
+  if (batch_full.state_history.size() != all.size() - 50) {
+    std::cerr << "Full trajectory has " << batch_full.state_history.size()
+              << " points, expected " << all.size() - 50 << std::endl;
+    ++failures;
+  }
+  compare(all.size(), batch_full, full.result());
+
+  // Full-series lines: element i matches calculate_indicators on i + 1 bars
+  IndicatorSeries series = TechnicalAnalysis::calculate_series(all);
+  if (series.size() != all.size()) {
+    std::cerr << "Series has " << series.size() << " bars" << std::endl;
+    ++failures;
+  } else {
+    for (size_t n : checkpoints) {
+      CandleSeries prefix;
+      for (size_t i = 0; i < n; ++i)
+        prefix.push_back(all[i]);
+      AnalysisResult b = TechnicalAnalysis::calculate_indicators(prefix);
+      size_t i = n - 1;
+      expect_close("series.rsi", n, b.current_rsi, series.rsi[i]);
+      expect_close("series.macd", n, b.macd, series.macd[i]);
+      expect_close("series.macd_signal", n, b.macd_signal,
+                   series.macd_signal[i]);
+      expect_close("series.sma_50", n, b.sma_50, series.sma_50[i]);
+      expect_close("series.sma_200", n, b.sma_200, series.sma_200[i]);
+      expect_close("series.adx", n, b.adx, series.adx[i]);
+      expect_same("series.boll_upper", n, b.boll_upper, series.boll_upper[i]);
+      expect_close("series.atr_median", n, b.atr_median, series.atr_median[i]);
+      expect_close("series.volume_z_score", n, b.volume_z_score,
+                   series.volume_z_score[i]);
+      expect_close("series.vwap_dist", n, b.vwap_dist, series.vwap_dist[i]);
+      expect_close("series.range_pos", n, b.range_pos, series.range_pos[i]);
+      expect_close("series.obv", n, b.obv, series.obv[i]);
+      // ATR: mean true range of the last 14 bars, 0 until there are 15
+      double tr_sum = 0.0;
+      for (size_t j = n > 14 ? n - 14 : n; j < n; ++j)
+        tr_sum += std::max({all.high[j] - all.low[j],
+                            std::abs(all.high[j] - all.close[j - 1]),
+                            std::abs(all.low[j] - all.close[j - 1])});
+      expect_close("series.atr", n, tr_sum / 14.0, series.atr[i]);
+      if (series.time[i] != all.time[i])
+        ++failures;
+    }
+  }
+
+  // Bollinger bands on a high price with small moves, where a one-pass
+  // variance loses its digits to cancellation
+  {
+    CandleSeries high;
+    for (int i = 0; i < 40; ++i) {
+      Candle c;
+      c.time = 1672567200 + (int64_t)i * 86400;
+      c.close = 1e7 + (i % 3) * 0.01;
+      c.open = c.high = c.low = c.close;
+      c.volume = 1000;
+      high.push_back(c);
+    }
+    IndicatorState s = IndicatorState::from_series(high);
+    AnalysisResult b = TechnicalAnalysis::calculate_indicators(high);
+    expect_same("high.boll_upper", high.size(), b.boll_upper,
+                s.result().boll_upper);
+    expect_same("high.boll_lower", high.size(), b.boll_lower,
+                s.result().boll_lower);
+  }
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " mismatches." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,274 @@
+#include "job_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+using namespace std::chrono_literals;
+
+// Polls until the job has finished, collecting every event
+static JobView follow(JobQueue &jobs, const std::string &id,
+                      std::vector<JobEvent> *events = nullptr) {
+  uint64_t next = 0;
+  while (true) {
+    auto view = jobs.poll(id, next, 5s);
+    if (!view)
+      return JobView();
+    if (events)
+      events->insert(events->end(), view->events.begin(), view->events.end());
+    next = view->next;
+    if (view->finished())
+      return *view;
+  }
+}
+
+int main() {
+  std::cout << "Starting job queue test..." << std::endl;
+
+  // 1. Stage results arrive in order, then the result
+  {
+    JobQueue jobs;
+    std::string id = jobs.submit([](const JobEmit &emit) {
+      emit("first", {{"n", 1}});
+      emit("second", {{"n", 2}});
+      return json{{"done", true}};
+    });
+    check(!id.empty(), "submitted");
+    std::vector<JobEvent> events;
+    JobView view = follow(jobs, id, &events);
+    check(view.status == JobStatus::DONE && view.result["done"] == true,
+          "result");
+    check(events.size() == 2 && events[0].seq == 1 &&
+              events[0].stage == "first" && events[1].data["n"] == 2,
+          "events in order");
+
+    // Polling again from the start replays them; from `next` gives none
+    check(jobs.poll(id, 0, 0ms)->events.size() == 2, "replay");
+    check(jobs.poll(id, view.next, 0ms)->events.empty(), "nothing new");
+    json j = view.to_json();
+    check(j["status"] == "done" && j["next"] == 2 && j.contains("result"),
+          "to_json");
+    check(!jobs.poll("0123456789abcdef", 0, 0ms), "unknown id");
+  }
+
+  // 2. Failures carry their HTTP status
+  {
+    JobQueue jobs;
+    auto not_found = jobs.submit([](const JobEmit &) -> json {
+      throw JobError(404, "No data found for ticker");
+    });
+    auto broken = jobs.submit([](const JobEmit &) -> json {
+      throw std::runtime_error("boom");
+    });
+    JobView a = follow(jobs, not_found), b = follow(jobs, broken);
+    check(a.status == JobStatus::FAILED && a.error_status == 404 &&
+              a.error == "No data found for ticker",
+          "JobError status");
+    check(b.status == JobStatus::FAILED && b.error_status == 500, "500");
+  }
+
+  // 3. A waiting poll returns as soon as a stage is published
+  {
+    JobQueue jobs;
+    std::promise<void> go;
+    std::shared_future<void> release = go.get_future().share();
+    std::string id = jobs.submit([release](const JobEmit &emit) {
+      release.wait();
+      emit("stage", json::object());
+      std::this_thread::sleep_for(2s);
+      return json::object();
+    });
+    std::thread publisher([&] {
+      std::this_thread::sleep_for(50ms);
+      go.set_value();
+    });
+    auto start = std::chrono::steady_clock::now();
+    auto view = jobs.poll(id, 0, 5s);
+    auto waited = std::chrono::steady_clock::now() - start;
+    publisher.join();
+    check(view && view->events.size() == 1 &&
+              view->status == JobStatus::RUNNING,
+          "woken by the stage");
+    check(waited < 1s, "no waiting out the timeout");
+  }
+
+  // 4. Jobs run side by side on the workers; a full queue turns work away
+  {
+    JobQueue::Options options;
+    options.workers = 3;
+    options.max_queued = 2;
+    JobQueue jobs(options);
+    std::promise<void> go;
+    std::shared_future<void> release = go.get_future().share();
+    std::atomic<int> running{0};
+    auto blocked = [&](const JobEmit &) {
+      ++running;
+      release.wait();
+      return json::object();
+    };
+    // One at a time, so each is picked up before the queue bound applies
+    std::vector<std::string> ids;
+    auto deadline = std::chrono::steady_clock::now() + 3s;
+    for (int i = 1; i <= 3; ++i) {
+      ids.push_back(jobs.submit(blocked));
+      while (running < i && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    }
+    check(running == 3, "three at once");
+
+    ids.push_back(jobs.submit(blocked));
+    ids.push_back(jobs.submit(blocked));
+    check(jobs.queued() == 2, "two waiting");
+    check(jobs.submit(blocked).empty(), "full queue rejects");
+    check(jobs.poll(ids[4], 0, 0ms)->status == JobStatus::QUEUED, "queued");
+
+    go.set_value();
+    bool all_done = true;
+    for (const auto &id : ids)
+      all_done = all_done && follow(jobs, id).status == JobStatus::DONE;
+    check(all_done, "all finish");
+  }
+
+  // 5. Only the newest finished jobs are kept
+  {
+    JobQueue::Options options;
+    options.workers = 1;
+    options.max_finished = 2;
+    JobQueue jobs(options);
+    std::vector<std::string> ids;
+    for (int i = 0; i < 4; ++i) {
+      ids.push_back(jobs.submit([](const JobEmit &) { return json(1); }));
+      follow(jobs, ids.back());
+    }
+    check(!jobs.poll(ids[0], 0, 0ms) && !jobs.poll(ids[1], 0, 0ms),
+          "oldest expired");
+    check(jobs.poll(ids[2], 0, 0ms) && jobs.poll(ids[3], 0, 0ms),
+          "newest kept");
+  }
+
+  // 6. Jobs still queued at shutdown fail, waking whoever follows them
+  {
+    JobQueue::Options options;
+    options.workers = 1;
+    auto jobs = std::make_unique<JobQueue>(options);
+    std::promise<void> go;
+    std::shared_future<void> release = go.get_future().share();
+    std::atomic<bool> started{false};
+    jobs->submit([&](const JobEmit &) {
+      started = true;
+      release.wait();
+      return json::object();
+    });
+    while (!started)
+      std::this_thread::sleep_for(1ms);
+    std::string waiting = jobs->submit([](const JobEmit &) { return json(1); });
+
+    std::optional<JobView> seen;
+    JobQueue *queue = jobs.get();
+    std::thread follower([&] { seen = queue->poll(waiting, 0, 5s); });
+    std::this_thread::sleep_for(50ms);
+    // The destructor waits for the running job, so release it from here
+    std::thread stopper([&] { jobs.reset(); });
+    auto start = std::chrono::steady_clock::now();
+    follower.join();
+    auto waited = std::chrono::steady_clock::now() - start;
+    go.set_value();
+    stopper.join();
+    check(seen && seen->status == JobStatus::FAILED &&
+              seen->error_status == 503,
+          "queued job failed on shutdown");
+    check(waited < 1s, "follower woken");
+  }
+
+  // 7. Transient stages stream while the job runs but are not kept; seq
+  // numbers stay as published
+  {
+    JobQueue::Options options;
+    options.transient_stages = {"token"};
+    JobQueue jobs(options);
+    std::promise<void> go;
+    std::shared_future<void> release = go.get_future().share();
+    std::string id = jobs.submit([&](const JobEmit &emit) {
+      emit("token", {{"text", "a"}});
+      emit("token", {{"text", "b"}});
+      emit("whole", {{"text", "ab"}});
+      release.wait();
+      return json::object();
+    });
+    uint64_t next = 0;
+    std::vector<JobEvent> live;
+    while (live.size() < 3) {
+      auto view = jobs.poll(id, next, 5s);
+      live.insert(live.end(), view->events.begin(), view->events.end());
+      next = view->next;
+    }
+    check(live[0].stage == "token" && live[1].data["text"] == "b",
+          "streamed while running");
+    go.set_value();
+    JobView done = follow(jobs, id);
+    auto kept = jobs.poll(id, 0, 0ms)->events;
+    check(kept.size() == 1 && kept[0].stage == "whole" && kept[0].seq == 3 &&
+              done.next == 3,
+          "dropped once finished");
+    check(jobs.poll(id, 1, 0ms)->events.size() == 1 &&
+              jobs.poll(id, 3, 0ms)->events.empty(),
+          "resume across the gap");
+  }
+
+  // 8. A job still running after the shutdown grace fails and is left to
+  // its worker, instead of holding up the destructor
+  {
+    JobQueue::Options options;
+    options.workers = 1;
+    options.shutdown_grace = 100ms;
+    auto jobs = std::make_unique<JobQueue>(options);
+    std::promise<void> go;
+    std::shared_future<void> release = go.get_future().share();
+    auto ended = std::make_shared<std::atomic<bool>>(false);
+    std::atomic<bool> started{false};
+    std::string id = jobs->submit([&, release, ended](const JobEmit &emit) {
+      started = true;
+      release.wait();
+      emit("late", json::object()); // Into a job that has already failed
+      *ended = true;
+      return json::object();
+    });
+    while (!started)
+      std::this_thread::sleep_for(1ms);
+
+    std::optional<JobView> seen;
+    JobQueue *queue = jobs.get();
+    std::thread follower([&] { seen = queue->poll(id, 0, 5s); });
+    std::this_thread::sleep_for(20ms);
+    auto start = std::chrono::steady_clock::now();
+    jobs.reset();
+    auto waited = std::chrono::steady_clock::now() - start;
+    follower.join();
+    check(waited < 1s, "destructor did not wait on the hung job");
+    check(seen && seen->status == JobStatus::FAILED &&
+              seen->error_status == 503,
+          "hung job failed on shutdown");
+
+    go.set_value();
+    while (!*ended)
+      std::this_thread::sleep_for(1ms);
+  }
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include "analysis.hpp"
+#include "nlohmann/json.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Compares the native MLModel against scripts/ml_predict.py, which stays the
+// reference implementation. Skips (exit 0) when python3 or the script's
+// imports are not available.
+
+static const char *ORACLE =
+    "import sys, json\n"
+    "sys.path.insert(0, 'scripts')\n"
+    "import ml_predict\n"
+    "for line in open(sys.argv[1]):\n"
+    "    f = json.loads(line)\n"
+    "    r = ml_predict.classify_regime(f)\n"
+    "    d = ml_predict.predict_direction(f, r)\n"
+    "    print(json.dumps({'regime_model': r, 'directional_model': d}))\n";
+
+int main() {
+  std::cout << "Starting ML parity test..." << std::endl;
+
+  std::vector<MLFeatures> cases;
+  const double vols[] = {0.0, 0.3, 0.69, 0.7, 0.71, 0.95};
+  for (int m = -10; m <= 10; ++m) {
+    for (int t = -10; t <= 10; ++t) {
+      for (double v : vols) {
+        MLFeatures f{};
+        f.momentum_state = m / 10.0;
+        f.trend_state = t / 10.0;
+        f.volatility_state = v;
+        f.is_stock = true;
+        cases.push_back(f);
+      }
+    }
+  }
+
+  const std::string script_path = "/tmp/ml_parity_oracle.py";
+  const std::string input_path = "/tmp/ml_parity_input.jsonl";
+  {
+    std::ofstream script(script_path);
+    script << ORACLE;
+    std::ofstream input(input_path);
+    for (const auto &f : cases) {
+      input << nlohmann::json{{"momentum_state", f.momentum_state},
+                              {"trend_state", f.trend_state},
+                              {"volatility_state", f.volatility_state}}
+                   .dump()
+            << "\n";
+    }
+  }
+
+  std::string cmd =
+      "python3 " + script_path + " " + input_path + " 2>/dev/null";
+  FILE *pipe = popen(cmd.c_str(), "r");
+  std::vector<nlohmann::json> expected;
+  if (pipe) {
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pipe) != NULL)
+      expected.push_back(nlohmann::json::parse(buffer));
+    pclose(pipe);
+  }
+  if (expected.size() != cases.size()) {
+    std::cout << "Skipped: python3 reference model not available."
+              << std::endl;
+    return 0;
+  }
+
+  int failures = 0;
+  auto same = [](double a, double b) { return std::abs(a - b) < 1e-12; };
+  for (size_t i = 0; i < cases.size(); ++i) {
+    MLOutput out = MLModel::predict(cases[i]);
+    const auto &reg = expected[i]["regime_model"];
+    const auto &dir = expected[i]["directional_model"];
+
+    bool ok = out.regime.regime == reg["regime"].get<std::string>() &&
+              same(out.regime.confidence, reg["confidence"]) &&
+              out.prediction.direction == dir["direction"].get<std::string>() &&
+              same(out.prediction.probability, dir["probability"]) &&
+              same(out.prediction.expected_r, dir["expected_r"]) &&
+              same(out.expected_value, dir["expected_value"]) &&
+              same(out.signal_strength, dir["signal_strength"]);
+    if (!ok) {
+      std::cerr << "Mismatch for momentum=" << cases[i].momentum_state
+                << " trend=" << cases[i].trend_state
+                << " vol=" << cases[i].volatility_state
+                << " python=" << expected[i].dump() << std::endl;
+      ++failures;
+    }
+  }
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " of " << cases.size()
+              << " cases differ." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed! (" << cases.size() << " cases)" << std::endl;
+  return 0;
+}
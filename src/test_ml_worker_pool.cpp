@@ -0,0 +1,115 @@
+#include "ml_worker_pool.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Exercises MLWorkerPool against a stub worker speaking the same protocol as
+// scripts/ml_predict.py --serve. momentum_state 99 makes the stub crash and
+// 77 makes it hang, so restarts and timeouts can be checked without numpy.
+static const char *STUB_WORKER =
+    "import sys, json, os, time\n"
+    "for line in sys.stdin:\n"
+    "    req = json.loads(line)\n"
+    "    out = []\n"
+    "    for f in req['batch']:\n"
+    "        m = f['momentum_state']\n"
+    "        if m == 99: os._exit(1)\n"
+    "        if m == 77: time.sleep(5)\n"
+    "        out.append({'regime_model': {'regime': 'trend', 'confidence': m},\n"
+    "                    'directional_model': {'direction': 'long',\n"
+    "                      'probability': 0.5, 'expected_r': 2.5,\n"
+    "                      'expected_value': 1.0,\n"
+    "                      'signal_strength': f['trend_state']}})\n"
+    "    sys.stdout.write(json.dumps({'id': req['id'], 'results': out}) + "
+    "'\\n')\n"
+    "    sys.stdout.flush()\n";
+
+static MLFeatures make_features(double momentum, double trend) {
+  MLFeatures f{};
+  f.momentum_state = momentum;
+  f.trend_state = trend;
+  return f;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+int main() {
+  std::cout << "Starting ML worker pool test..." << std::endl;
+
+  MLWorkerPool::Options options;
+  options.command = {"python3", "-c", STUB_WORKER};
+  options.workers = 2;
+  options.timeout_ms = 500;
+  MLWorkerPool pool(options);
+
+  // 1. Batched round trip keeps order
+  std::vector<MLFeatures> batch;
+  for (int i = 0; i < 500; ++i)
+    batch.push_back(make_features(i * 0.001, i));
+  auto outputs = pool.predict_batch(batch);
+  check(outputs.size() == batch.size(), "batch size");
+  bool ordered = true;
+  for (size_t i = 0; i < outputs.size(); ++i)
+    ordered = ordered && outputs[i].signal_strength == (double)i;
+  check(ordered, "batch order");
+
+  // 2. Concurrent callers share the workers
+  std::vector<std::thread> threads;
+  std::vector<int> ok(4, 0);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int k = 0; k < 25; ++k) {
+        auto out = pool.predict(make_features(0.1, t * 100 + k));
+        if (out.signal_strength == t * 100 + k && out.regime.regime == "trend")
+          ++ok[t];
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+  for (int t = 0; t < 4; ++t)
+    check(ok[t] == 25, "concurrent results");
+
+  // 3. Crashing worker is restarted and the pool keeps working
+  bool threw = false;
+  try {
+    pool.predict(make_features(99, 0));
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  check(threw, "crash reported");
+  check(pool.restarts() >= 1, "crashed worker restarted");
+  check(pool.predict(make_features(0.2, 5)).signal_strength == 5,
+        "pool usable after crash");
+
+  // 4. Hanging worker hits the timeout and is replaced
+  size_t restarts_before = pool.restarts();
+  auto start = std::chrono::steady_clock::now();
+  threw = false;
+  try {
+    pool.predict(make_features(77, 0));
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  check(threw, "timeout reported");
+  check(elapsed < std::chrono::seconds(3), "timeout honoured");
+  check(pool.restarts() == restarts_before + 1, "timed out worker restarted");
+  check(pool.predict(make_features(0.3, 6)).signal_strength == 6,
+        "pool usable after timeout");
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " checks." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
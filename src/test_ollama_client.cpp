@@ -0,0 +1,257 @@
+#include "httplib.h"
+#include "ollama_client.hpp"
+#include <chrono>
+#include <curl/curl.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs OllamaClient against a local mock of Ollama's /api/generate, which
+// answers the way Ollama does: one JSON object, or with "stream": true one
+// JSON object per line, each sent after a short delay.
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+static const std::string VERDICT =
+    "{\"decision\": \"veto\", \"confidence\": 0.35, \"key_factors\": "
+    "[{\"decision\": \"nested\"}], \"risk_level\": \"high\", \"reason\": "
+    "\"RSI at 88 is \\\"extreme\\\"; risk_level stays high because the "
+    "weekly trend is down and the stop is tight.\"}";
+
+// The text in pieces of `size` characters
+static std::vector<std::string> pieces(const std::string &text, size_t size) {
+  std::vector<std::string> out;
+  for (size_t i = 0; i < text.size(); i += size)
+    out.push_back(text.substr(i, size));
+  return out;
+}
+
+int main() {
+  std::cout << "Starting Ollama client test..." << std::endl;
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  // 1. The scanner finds the fields however the text is split, ignoring
+  // nested keys and keys inside strings
+  {
+    for (size_t size : {1, 3, 7, 1000}) {
+      std::vector<std::string> order;
+      JsonFieldScanner scanner(
+          OllamaClient::VERDICT_FIELDS,
+          [&](const std::string &name, const nlohmann::json &) {
+            order.push_back(name);
+          });
+      for (const auto &piece : pieces(VERDICT, size))
+        scanner.feed(piece);
+      const auto &f = scanner.fields();
+      check(order == std::vector<std::string>{"decision", "confidence",
+                                              "risk_level"},
+            "each field once, in order");
+      check(f.at("decision") == "veto" && f.at("confidence") == 0.35 &&
+                f.at("risk_level") == "high",
+            "field values");
+    }
+
+    // Reported when the value is complete, not before
+    JsonFieldScanner scanner({"confidence", "decision"});
+    scanner.feed("{\"confidence\": 0.8");
+    check(scanner.fields().empty(), "number still open");
+    scanner.feed("5, \"decision\": \"trade_al");
+    check(scanner.fields().size() == 1 &&
+              scanner.fields().at("confidence") == 0.85,
+          "number closed by comma");
+    scanner.feed("lowed\"");
+    check(scanner.fields().at("decision") == "trade_allowed",
+          "string closed by quote");
+  }
+
+  httplib::Server svr;
+  std::mutex mutex;
+  std::vector<nlohmann::json> requests;
+  svr.Post("/api/generate", [&](const httplib::Request &req,
+                                httplib::Response &res) {
+    auto body = nlohmann::json::parse(req.body);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      requests.push_back(body);
+    }
+    if (body["model"] == "broken") {
+      res.set_content("{\"error\": \"model not found\"}\n",
+                      "application/x-ndjson");
+      res.status = body["stream"] == true ? 200 : 404;
+      return;
+    }
+    if (body["model"] == "hung") // Says nothing for longer than the limits
+      std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    std::string text =
+        body.contains("format") ? VERDICT : std::string("Hello there, trader");
+    if (body["stream"] != true) {
+      res.set_content(nlohmann::json{{"response", text}, {"done", true}}
+                          .dump(),
+                      "application/json");
+      return;
+    }
+    auto lines = std::make_shared<std::vector<std::string>>();
+    for (const auto &piece : pieces(text, 8))
+      lines->push_back(
+          nlohmann::json{{"response", piece}, {"done", false}}.dump() + "\n");
+    lines->push_back("{\"response\": \"\", \"done\": true}\n");
+    auto next = std::make_shared<size_t>(0);
+    res.set_chunked_content_provider(
+        "application/x-ndjson",
+        [lines, next](size_t, httplib::DataSink &sink) {
+          if (*next == lines->size()) {
+            sink.done();
+            return true;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+          const std::string &line = (*lines)[(*next)++];
+          return sink.write(line.data(), line.size());
+        });
+  });
+  int port = svr.bind_to_any_port("127.0.0.1");
+  std::thread server([&] { svr.listen_after_bind(); });
+  svr.wait_until_ready();
+  std::string base = "http://127.0.0.1:" + std::to_string(port);
+
+  // 2. Without callbacks the answer comes in one piece
+  {
+    OllamaClient ai("mock", base);
+    std::string answer = ai.get_market_analysis("TEST", "{}");
+    check(answer == VERDICT, "whole answer");
+    check(requests.back()["stream"] == false, "not streamed");
+  }
+
+  // 3. Streamed: tokens arrive in order and the verdict fields are known
+  // well before the answer is complete
+  {
+    OllamaClient ai("mock", base);
+    std::string streamed;
+    size_t tokens = 0, tokens_at_risk = 0;
+    std::string decision;
+    std::string answer = ai.get_market_analysis(
+        "TEST", "{}", "",
+        [&](const std::string &token) {
+          streamed += token;
+          ++tokens;
+        },
+        [&](const std::string &name, const nlohmann::json &value) {
+          if (name == "decision")
+            decision = value.get<std::string>();
+          if (name == "risk_level")
+            tokens_at_risk = tokens;
+        });
+    check(requests.back()["stream"] == true, "streamed");
+    check(answer == VERDICT && streamed == VERDICT, "tokens add up");
+    check(decision == "veto", "decision parsed");
+    check(tokens_at_risk > 0 && tokens_at_risk < tokens / 2,
+          "fields before the reason is written");
+
+    // A field callback alone also streams
+    std::string risk;
+    ai.get_market_analysis("TEST", "{}", "", nullptr,
+                           [&](const std::string &name,
+                               const nlohmann::json &value) {
+                             if (name == "risk_level")
+                               risk = value.get<std::string>();
+                           });
+    check(requests.back()["stream"] == true && risk == "high",
+          "fields without tokens");
+  }
+
+  // 4. ask_question streams too
+  {
+    OllamaClient ai("mock", base);
+    std::vector<std::string> tokens;
+    std::string answer = ai.ask_question(
+        "system", "hi", [&](const std::string &t) { tokens.push_back(t); });
+    check(answer == "Hello there, trader" && tokens.size() == 3 &&
+              tokens[0] == "Hello th",
+          "chat tokens");
+    check(ai.ask_question("system", "hi") == "Hello there, trader",
+          "chat whole");
+  }
+
+  // 5. Errors, streamed or not, give the usual failure text
+  {
+    OllamaClient ai("broken", base);
+    check(ai.get_market_analysis("TEST", "{}") ==
+              "Error: Meta-Analysis failed.",
+          "error answer");
+    check(ai.ask_question("s", "q", [](const std::string &) {}) ==
+              "Error: Chat failed.",
+          "streamed error");
+    OllamaClient down("mock", "http://127.0.0.1:1");
+    check(down.ask_question("s", "q") == "Error: Chat failed.",
+          "connection refused");
+  }
+
+  // 6. With a cache the same analysis asks the model once; the reused
+  // answer still reaches token and field callbacks
+  {
+    ResponseCache cache;
+    OllamaClient::set_response_cache(&cache);
+    OllamaClient ai("mock", base);
+    size_t before = requests.size();
+    std::string first = ai.get_market_analysis("TEST", "{\"b\": 1, \"a\": 2}");
+    std::string streamed, decision;
+    std::string second = ai.get_market_analysis(
+        "TEST", "{ \"a\": 2,\n  \"b\": 1 }", "",
+        [&](const std::string &token) { streamed += token; },
+        [&](const std::string &name, const nlohmann::json &value) {
+          if (name == "decision")
+            decision = value.get<std::string>();
+        });
+    check(first == VERDICT && second == VERDICT, "cached answer");
+    check(requests.size() == before + 1, "one model call");
+    check(streamed == VERDICT && decision == "veto", "replayed to callbacks");
+
+    ai.get_market_analysis("TEST", "{\"a\": 2, \"b\": 1}", "new context");
+    ai.get_market_analysis("OTHER", "{\"a\": 2, \"b\": 1}");
+    OllamaClient("broken", base).get_market_analysis("TEST", "{}");
+    OllamaClient("broken", base).get_market_analysis("TEST", "{}");
+    check(requests.size() == before + 5,
+          "context, ticker and model in the key; failures not cached");
+    OllamaClient::set_response_cache(nullptr);
+  }
+
+  // 7. A model that runs out of time throws from get_market_analysis,
+  // streamed or not; a chat just fails
+  {
+    OllamaClient::set_timeouts(std::chrono::seconds(1),
+                               std::chrono::seconds(60));
+    OllamaClient ai("hung", base);
+    auto timed_out = [&](const OllamaClient::TokenCallback &on_token) {
+      try {
+        ai.get_market_analysis("TEST", "{}", "", on_token);
+      } catch (const OllamaTimeout &) {
+        return true;
+      }
+      return false;
+    };
+    check(timed_out(nullptr), "whole answer timed out");
+    check(timed_out([](const std::string &) {}), "stream timed out");
+    check(ai.ask_question("s", "q", [](const std::string &) {}) ==
+              "Error: Chat failed.",
+          "chat timed out");
+    OllamaClient::set_timeouts(std::chrono::seconds(300),
+                               std::chrono::seconds(60));
+  }
+
+  svr.stop();
+  server.join();
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
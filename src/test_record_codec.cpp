@@ -0,0 +1,149 @@
+#include "record_codec.hpp"
+#include <cmath>
+#include <iostream>
+#include <string>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+static AnalysisRecord sample() {
+  AnalysisRecord r{};
+  r.id = "0f3c2a1e-1111-2222-3333-444455556666";
+  r.timestamp = "2026-01-22 15:30:00";
+  r.ticker = "BTC-USD";
+  r.model = "deepseek-v3.1:671b-cloud";
+  r.rsi = 61.25;
+  r.macd = -0.125;
+  r.macd_signal = 1e-9;
+  r.sma_50 = 42000.5;
+  r.sma_200 = 39000.25;
+  r.current_price = 43123.75;
+  r.adx = 27.5;
+  r.boll_width = 0.085;
+  r.atr_median = 812.0;
+  r.volume_z_score = -1.5;
+  r.roc_5 = 2.5;
+  r.roc_10 = -3.5;
+  r.roc_20 = 8.0;
+  r.obv = 1.5e12;
+  r.vwap_dist = 0.01;
+  r.sma_distance_pct = 10.5;
+  r.range_pos = 0.75;
+  r.is_stock = false;
+  r.htf_rsi = 55.0;
+  r.htf_sma_50 = 41000.0;
+  r.htf_sma_200 = 30000.0;
+  r.entry_price = 43123.75;
+  r.take_profit = 45000.0;
+  r.stop_loss = 42000.0;
+  r.trailing_sl = 42500.0;
+  r.partial_tp = 44000.0;
+  r.regime = "trend";
+  r.direction = "long";
+  r.volatility_state = 0.42;
+  r.ai_prediction = "{\"decision\": \"trade_allowed\", \"confidence\": 0.8}";
+  r.feedback = {true, true, "hit tp \xe2\x9c\x85"};
+  int64_t t = 1768000000;
+  for (int i = 0; i < 50; ++i) {
+    // Weekend gaps and one out-of-order bar exercise the deltas
+    t += (i % 7 == 5) ? 3 * 86400 : (i == 20 ? -3600 : 86400);
+    r.state_history.push_back({std::sin(i * 0.1), std::cos(i * 0.1),
+                               i / 50.0, t});
+  }
+  return r;
+}
+
+int main() {
+  std::cout << "Starting record codec test..." << std::endl;
+
+  AnalysisRecord in = sample();
+  std::string bytes;
+  ByteWriter out(bytes);
+  RecordCodec::encode(in, out);
+
+  // 1. Round trip
+  AnalysisRecord back{};
+  ByteReader reader(bytes.data(), bytes.size());
+  check(RecordCodec::decode(reader, RecordCodec::VERSION, back), "decodes");
+  check(reader.remaining() == 0, "consumes exactly the record");
+  check(back.id == in.id && back.timestamp == in.timestamp &&
+            back.ticker == in.ticker && back.model == in.model,
+        "strings");
+  check(back.ai_prediction == in.ai_prediction, "prediction text");
+  check(back.regime == in.regime && back.direction == in.direction &&
+            back.volatility_state == in.volatility_state,
+        "model outputs");
+  check(back.feedback.submitted && back.feedback.success &&
+            back.feedback.remark == in.feedback.remark,
+        "feedback");
+  check(!back.is_stock, "flags");
+  check(back.to_json()["indicators"] == in.to_json()["indicators"] &&
+            back.to_json()["trading_levels"] == in.to_json()["trading_levels"],
+        "doubles exact");
+  check(back.state_history.size() == 50, "trajectory length");
+  bool times = true, coords = true;
+  for (size_t i = 0; i < in.state_history.size(); ++i) {
+    const auto &a = in.state_history[i];
+    const auto &b = back.state_history[i];
+    times = times && a.time == b.time;
+    coords = coords && std::abs(a.x - b.x) < 1e-6 &&
+             std::abs(a.y - b.y) < 1e-6 && std::abs(a.z - b.z) < 1e-6 &&
+             b.x == RecordCodec::round_coordinate(a.x);
+  }
+  check(times, "trajectory times exact");
+  check(coords, "trajectory coordinates float32");
+
+  // 2. An order of magnitude below the JSON form
+  size_t json_size = in.to_json().dump(2).size();
+  check(bytes.size() * 5 < json_size, "compact");
+  std::cout << "binary " << bytes.size() << " bytes, JSON " << json_size
+            << " bytes" << std::endl;
+
+  // 3. Truncated input and unknown versions are rejected, not misread
+  bool rejected = true;
+  for (size_t n = 0; n < bytes.size(); ++n) {
+    AnalysisRecord partial{};
+    ByteReader cut(bytes.data(), n);
+    rejected = rejected && !RecordCodec::decode(cut, RecordCodec::VERSION,
+                                                partial);
+  }
+  check(rejected, "every truncation rejected");
+  ByteReader future(bytes.data(), bytes.size());
+  AnalysisRecord ignored{};
+  check(!RecordCodec::decode(future, RecordCodec::VERSION + 1, ignored),
+        "future version rejected");
+
+  // 4. Version 1 records end before the model outputs
+  size_t v2_fields = 4 + in.regime.size() + 4 + in.direction.size() + 8;
+  ByteReader v1(bytes.data(), bytes.size() - v2_fields);
+  AnalysisRecord old_record = sample();
+  check(RecordCodec::decode(v1, 1, old_record) && v1.remaining() == 0,
+        "version 1 decodes");
+  check(old_record.regime.empty() && old_record.direction.empty() &&
+            std::isnan(old_record.volatility_state) &&
+            old_record.volatility_bucket() == "unknown",
+        "version 1 has no model outputs");
+
+  // 5. Empty trajectory
+  AnalysisRecord empty{};
+  std::string small;
+  ByteWriter small_out(small);
+  RecordCodec::encode(empty, small_out);
+  ByteReader small_in(small.data(), small.size());
+  check(RecordCodec::decode(small_in, RecordCodec::VERSION, empty) &&
+            empty.state_history.empty(),
+        "empty trajectory");
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
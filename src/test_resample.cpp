@@ -0,0 +1,78 @@
+#include "resample.hpp"
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+// 2024-01-01 14:30 UTC was a Monday (a US session open)
+static const int64_t MONDAY = 1704119400;
+
+int main() {
+  std::cout << "Starting resample test..." << std::endl;
+
+  // Weekdays only, 2024-01-01 .. 2024-03-29 (13 weeks); bar k of the run has
+  // open k, close k + 0.5, high k + 2, low k - 1, volume 10
+  CandleSeries daily;
+  int k = 0;
+  for (int day = 0; day < 89; ++day) {
+    if (day % 7 >= 5)
+      continue; // Weekend
+    daily.push_back({MONDAY + (int64_t)day * 86400, (double)k, k + 2.0,
+                     k - 1.0, k + 0.5, 10.0});
+    ++k;
+  }
+
+  // Weekly: 13 full weeks of 5 bars
+  CandleSeries weekly = Resample::weekly(daily);
+  check(weekly.size() == 13, "13 weeks");
+  bool weeks_ok = true;
+  for (size_t w = 0; w < weekly.size(); ++w) {
+    double first = w * 5.0, last = first + 4;
+    weeks_ok = weeks_ok && weekly.time[w] == MONDAY + (int64_t)w * 7 * 86400 &&
+               weekly.open[w] == first && weekly.close[w] == last + 0.5 &&
+               weekly.high[w] == last + 2 && weekly.low[w] == first - 1 &&
+               weekly.volume[w] == 50.0;
+  }
+  check(weeks_ok, "weekly OHLCV aggregation");
+
+  // Monthly: January has 23 weekdays, February 21 (leap year), March 21
+  CandleSeries monthly = Resample::monthly(daily);
+  check(monthly.size() == 3, "3 months");
+  if (monthly.size() == 3) {
+    check(monthly.volume[0] == 230 && monthly.volume[1] == 210 &&
+              monthly.volume[2] == 210,
+          "monthly bar sizes");
+    check(monthly.open[1] == 23 && monthly.close[1] == 43.5,
+          "February open/close");
+  }
+
+  // A daily bar stamped 15:00 UTC Sunday is Monday 00:00 in Tokyo
+  CandleSeries tokyo;
+  tokyo.push_back({MONDAY - 86400 + 1800, 1, 1, 1, 1, 1}); // Sun 15:00 UTC
+  tokyo.push_back({MONDAY + 86400 * 4, 2, 2, 2, 2, 1});    // Fri
+  check(Resample::weekly(tokyo).size() == 2, "UTC buckets split");
+  check(Resample::weekly(tokyo, 9 * 3600).size() == 1,
+        "offset moves the bar into the next week");
+
+  // N-bar: groups counted from the first bar, last group partial
+  CandleSeries three = Resample::every_n(daily, 3);
+  check(three.size() == (daily.size() + 2) / 3, "N-bar count");
+  check(three.open[1] == 3 && three.close[1] == 5.5 && three.high[1] == 7 &&
+            three.low[1] == 2 && three.volume[1] == 30,
+        "N-bar aggregation");
+  check(Resample::every_n(daily, 1).size() == daily.size(), "N = 1 identity");
+  check(Resample::weekly(CandleSeries{}).empty(), "empty input");
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " checks." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,208 @@
+#include "response_cache.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+using namespace std::chrono_literals;
+
+static size_t count_lines(const std::string &path) {
+  std::ifstream file(path);
+  size_t n = 0;
+  std::string line;
+  while (std::getline(file, line))
+    ++n;
+  return n;
+}
+
+int main() {
+  std::cout << "Starting response cache test..." << std::endl;
+
+  // 1. Keys separate model, template version and context
+  {
+    auto key = ResponseCache::make_key("m", 1, "context");
+    check(key == ResponseCache::make_key("m", 1, "context"), "stable key");
+    check(key != ResponseCache::make_key("m2", 1, "context") &&
+              key != ResponseCache::make_key("m", 2, "context") &&
+              key != ResponseCache::make_key("m", 1, "context!"),
+          "distinct keys");
+    // Contexts of the same length that differ anywhere stay apart
+    ResponseCache cache;
+    cache.put(ResponseCache::make_key("m", 1, "ab"), "first");
+    check(!cache.get(ResponseCache::make_key("m", 1, "ba")),
+          "no answer for another context");
+  }
+
+  // 2. Least recently used entries go first
+  {
+    ResponseCache::Options options;
+    options.max_entries = 2;
+    ResponseCache cache(options);
+    cache.put("a", "1");
+    cache.put("b", "2");
+    check(cache.get("a") == std::string("1"), "hit");
+    cache.put("c", "3"); // Evicts b, the least recently used
+    check(!cache.get("b") && cache.get("a") && cache.get("c"), "LRU");
+    check(cache.stats().entries == 2, "bounded");
+  }
+
+  // 3. Entries expire
+  {
+    ResponseCache::Options options;
+    options.ttl = 50ms;
+    ResponseCache cache(options);
+    cache.put("a", "1");
+    check(cache.get("a").has_value(), "fresh");
+    std::this_thread::sleep_for(80ms);
+    check(!cache.get("a"), "expired");
+    check(cache.stats().entries == 0, "expired entry dropped");
+  }
+
+  // 4. Identical concurrent requests run once; failures are not kept
+  {
+    ResponseCache cache;
+    std::atomic<int> calls{0};
+    auto slow = [&]() -> std::optional<std::string> {
+      ++calls;
+      std::this_thread::sleep_for(100ms);
+      return std::string("answer");
+    };
+    std::vector<std::thread> threads;
+    std::atomic<int> right{0}, hits{0};
+    for (int i = 0; i < 8; ++i) {
+      threads.emplace_back([&] {
+        bool hit = false;
+        if (cache.get_or_compute("k", slow, &hit) == std::string("answer"))
+          ++right;
+        hits += hit;
+      });
+    }
+    for (auto &t : threads)
+      t.join();
+    check(calls == 1, "computed once");
+    check(right == 8 && hits == 7, "all got the answer");
+    check(cache.stats().shared + cache.stats().hits == 7 &&
+              cache.stats().misses == 1,
+          "stats");
+
+    int failed_calls = 0;
+    auto failing = [&]() -> std::optional<std::string> {
+      ++failed_calls;
+      return std::nullopt;
+    };
+    check(!cache.get_or_compute("bad", failing), "failure passed on");
+    check(!cache.get_or_compute("bad", failing) && failed_calls == 2,
+          "failure not cached");
+
+    bool threw = false;
+    try {
+      cache.get_or_compute("boom", []() -> std::optional<std::string> {
+        throw std::runtime_error("boom");
+      });
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    check(threw && cache.get_or_compute("boom", slow) == std::string("answer"),
+          "exception leaves no flight behind");
+  }
+
+  // 5. Persisted answers survive a restart, minus expired ones, and the
+  // file is compacted
+  {
+    char dir_template[] = "/tmp/response_cache_test_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+    std::string path = dir + "/cache.jsonl";
+    ResponseCache::Options options;
+    options.path = path;
+    options.max_entries = 3;
+    {
+      ResponseCache cache(options);
+      for (int i = 0; i < 6; ++i)
+        cache.put("k" + std::to_string(i), "v" + std::to_string(i));
+      cache.put("k5", "v5b");
+      check(count_lines(path) <= 2 * options.max_entries, "compacted");
+    }
+    {
+      std::ofstream torn(path, std::ios::app);
+      torn << "{\"k\": \"k9\", \"v\": \"half";
+    }
+    {
+      ResponseCache cache(options);
+      check(cache.stats().entries == 3, "reloaded");
+      check(cache.get("k5") == std::string("v5b") && !cache.get("k2") &&
+                !cache.get("k9"),
+            "latest values, torn line skipped");
+      check(count_lines(path) == 3, "rewritten on load");
+      cache.put("k3", "v3");
+      cache.put("k6", "v6"); // Evicts k4, the least recently used
+    }
+    {
+      ResponseCache cache(options);
+      check(!cache.get("k4") && cache.get("k6") && cache.get("k5"),
+            "recency survives a restart");
+    }
+
+    options.ttl = 20ms;
+    {
+      ResponseCache cache(options);
+      cache.put("short", "lived");
+    }
+    std::this_thread::sleep_for(50ms);
+    {
+      ResponseCache cache(options);
+      check(!cache.get("short"), "expired on load");
+    }
+    std::system(("rm -rf " + dir).c_str());
+  }
+
+  // 6. Writes from many threads, appends and rewrites interleaved, leave
+  // the file agreeing with memory
+  {
+    char dir_template[] = "/tmp/response_cache_test_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+    ResponseCache::Options options;
+    options.path = dir + "/cache.jsonl";
+    options.max_entries = 8;
+    std::vector<bool> kept(64);
+    {
+      ResponseCache cache(options);
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&cache, t] {
+          for (int i = t; i < 64; i += 4)
+            cache.put("k" + std::to_string(i), "v" + std::to_string(i));
+        });
+      for (auto &t : threads)
+        t.join();
+      for (int i = 0; i < 64; ++i)
+        kept[i] = cache.get("k" + std::to_string(i)).has_value();
+    }
+    ResponseCache cache(options);
+    bool same = cache.stats().entries == 8;
+    for (int i = 0; i < 64; ++i)
+      same = same && cache.get("k" + std::to_string(i)).has_value() == kept[i];
+    check(same, "file matches memory");
+    std::system(("rm -rf " + dir).c_str());
+  }
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include "settings_storage.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+// The watcher applies edits asynchronously; wait up to 3 s for one
+template <typename Predicate> static bool eventually(Predicate predicate) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (predicate())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return predicate();
+}
+
+static void write_file(const std::string &path, const std::string &text) {
+  std::ofstream out(path, std::ios::trunc);
+  out << text;
+}
+
+int main() {
+  std::cout << "Starting settings storage test..." << std::endl;
+
+  char dir_template[] = "/tmp/settings_storage_test_XXXXXX";
+  std::string dir = mkdtemp(dir_template);
+  std::string path = dir + "/settings.json";
+
+  {
+    // 1. A missing file is created with the defaults
+    SettingsStorage storage(path);
+    check(storage.get_settings().max_leverage == 10, "defaults");
+    check(std::ifstream(path).good(), "default file written");
+
+    // 2. Saves apply at once and reach the file whole
+    UserSettings s;
+    s.account_balance = 25000.0;
+    s.max_leverage = 3;
+    check(storage.save_settings(s), "save");
+    check(storage.get_settings().account_balance == 25000.0,
+          "save visible immediately");
+    std::ifstream in(path);
+    json j = json::parse(in);
+    check(j["max_leverage"] == 3, "file rewritten");
+    check(!std::ifstream(path + ".tmp").good(), "temp file renamed");
+
+    // 3. Edits to the file are picked up, whether it is rewritten in place
+    // or replaced
+    write_file(path, "{\"account_balance\": 500, \"max_leverage\": 2}");
+    check(eventually([&] {
+            return storage.get_settings().account_balance == 500.0;
+          }),
+          "in-place edit picked up");
+    write_file(path + ".new", "{\"account_balance\": 700}");
+    std::rename((path + ".new").c_str(), path.c_str());
+    check(eventually([&] {
+            return storage.get_settings().account_balance == 700.0;
+          }),
+          "replaced file picked up");
+
+    // 4. A file that does not parse keeps the last good settings
+    write_file(path, "{\"account_balance\": ");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(storage.get_settings().account_balance == 700.0,
+          "broken edit ignored");
+    check(!storage.reload(), "reload reports broken file");
+
+    // 5. Readers during saves only ever see whole settings (balance is
+    // always leverage x 1000)
+    UserSettings first;
+    first.max_leverage = 1;
+    first.account_balance = 1000.0;
+    storage.save_settings(first);
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+      readers.emplace_back([&] {
+        while (!stop) {
+          auto snapshot = storage.snapshot();
+          if (snapshot->account_balance != snapshot->max_leverage * 1000.0)
+            ++torn;
+        }
+      });
+    }
+    for (int i = 1; i <= 50; ++i) {
+      UserSettings next;
+      next.max_leverage = i;
+      next.account_balance = i * 1000.0;
+      storage.save_settings(next);
+    }
+    stop = true;
+    for (auto &t : readers)
+      t.join();
+    check(torn == 0, "no torn reads");
+    check(storage.get_settings().max_leverage == 50, "last save wins");
+  }
+
+  // 6. A new instance starts from the file
+  {
+    SettingsStorage storage(path);
+    check(storage.get_settings().max_leverage == 50, "loaded on start");
+  }
+
+  std::system(("rm -rf " + dir).c_str());
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
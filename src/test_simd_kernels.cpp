@@ -0,0 +1,107 @@
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Checks every dispatched kernel against a plain sequential loop, over
+// lengths that exercise the vector body, the remainder and empty input.
+
+static int failures = 0;
+
+static void expect_close(const char *name, size_t n, double expected,
+                         double actual) {
+  double tol = 1e-12 * std::max(1.0, std::abs(expected));
+  if (std::abs(expected - actual) > tol) {
+    std::cerr << "Mismatch for n=" << n << ": " << name
+              << " expected=" << expected << " actual=" << actual << std::endl;
+    ++failures;
+  }
+}
+
+int main() {
+  std::cout << "Starting SIMD kernel test (AVX2 "
+            << (simd::has_avx2() ? "on" : "off") << ")..." << std::endl;
+
+  srand(7);
+  const size_t lengths[] = {0, 1, 3, 4, 5, 7, 8, 9, 14, 20, 50, 201};
+  for (size_t n : lengths) {
+    std::vector<double> a(n), b(n), high(n), low(n), prev(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = 100.0 + (rand() % 1000) / 10.0;
+      b[i] = 1000.0 + rand() % 5000;
+      low[i] = a[i] - (rand() % 100) / 50.0;
+      high[i] = a[i] + (rand() % 100) / 50.0;
+      prev[i] = a[i] + ((rand() % 200) - 100) / 25.0;
+    }
+
+    double sum = 0, sum_sq = 0, dot = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += a[i];
+      sum_sq += a[i] * a[i];
+      dot += a[i] * b[i];
+    }
+    double mean = n ? sum / n : 0.0;
+    double dev = 0;
+    for (size_t i = 0; i < n; ++i)
+      dev += (a[i] - mean) * (a[i] - mean);
+
+    expect_close("sum", n, sum, simd::sum(a.data(), n));
+    double s, sq;
+    simd::moments(a.data(), n, s, sq);
+    expect_close("moments.sum", n, sum, s);
+    expect_close("moments.sum_sq", n, sum_sq, sq);
+    expect_close("sum_sq_dev", n, dev, simd::sum_sq_dev(a.data(), n, mean));
+    expect_close("dot", n, dot, simd::dot(a.data(), b.data(), n));
+
+    std::vector<double> tr(n), prefix(n);
+    simd::true_range(high.data(), low.data(), prev.data(), tr.data(), n);
+    simd::prefix_sum(a.data(), prefix.data(), n);
+    double running = 0;
+    for (size_t i = 0; i < n; ++i) {
+      double expected = std::max({high[i] - low[i], std::abs(high[i] - prev[i]),
+                                  std::abs(low[i] - prev[i])});
+      if (tr[i] != expected) {
+        std::cerr << "true_range mismatch at " << i << std::endl;
+        ++failures;
+      }
+      running += a[i];
+      if (prefix[i] != running) {
+        std::cerr << "prefix_sum mismatch at " << i << std::endl;
+        ++failures;
+      }
+    }
+
+    // Squared distances over 8 float columns, one point per row
+    const size_t dims = 8;
+    std::vector<float> columns[dims];
+    const float *cols[dims];
+    float query[dims];
+    for (size_t d = 0; d < dims; ++d) {
+      for (size_t i = 0; i < n; ++i)
+        columns[d].push_back((rand() % 2000 - 1000) / 500.0f);
+      cols[d] = columns[d].data();
+      query[d] = (rand() % 2000 - 1000) / 500.0f;
+    }
+    std::vector<float> dist(n);
+    simd::sq_distances(cols, dims, query, dist.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      double expected = 0;
+      for (size_t d = 0; d < dims; ++d)
+        expected += (double)(columns[d][i] - query[d]) *
+                    (double)(columns[d][i] - query[d]);
+      if (std::abs(dist[i] - expected) > 1e-5 * std::max(1.0, expected)) {
+        std::cerr << "sq_distances mismatch at " << i << std::endl;
+        ++failures;
+      }
+    }
+  }
+
+  if (failures > 0) {
+    std::cerr << "Test Failed: " << failures << " mismatches." << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include "similarity_index.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "Check failed: " << what << std::endl;
+    ++failures;
+  }
+}
+
+using Vector = SimilarityIndex::Vector;
+
+// Reference: sort everything by distance
+static std::vector<uint64_t>
+brute_force(const std::vector<std::pair<uint64_t, Vector>> &points,
+            const Vector &q, size_t k) {
+  std::vector<std::pair<double, uint64_t>> all;
+  for (const auto &p : points) {
+    double d = 0;
+    for (size_t i = 0; i < SimilarityIndex::DIMS; ++i)
+      d += (double)(p.second[i] - q[i]) * (p.second[i] - q[i]);
+    all.push_back({d, p.first});
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<uint64_t> keys;
+  for (size_t i = 0; i < k && i < all.size(); ++i)
+    keys.push_back(all[i].second);
+  return keys;
+}
+
+int main() {
+  std::cout << "Starting similarity index test..." << std::endl;
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  auto random_vector = [&] {
+    Vector v;
+    for (auto &x : v)
+      x = uniform(rng);
+    return v;
+  };
+
+  // 1. Exact scan matches brute force, nearest first
+  {
+    SimilarityIndex index;
+    std::vector<std::pair<uint64_t, Vector>> points;
+    for (uint64_t key = 1; key <= 2000; ++key) {
+      points.push_back({key, random_vector()});
+      index.insert(key, points.back().second);
+    }
+    check(!index.approximate() && index.size() == 2000, "exact below limit");
+    bool same = true, sorted = true;
+    for (int q = 0; q < 50; ++q) {
+      Vector query = random_vector();
+      auto matches = index.nearest(query, 10);
+      auto expected = brute_force(points, query, 10);
+      same = same && matches.size() == 10;
+      for (size_t i = 0; same && i < matches.size(); ++i) {
+        same = same && matches[i].key == expected[i];
+        sorted = sorted &&
+                 (i == 0 || matches[i - 1].distance <= matches[i].distance);
+      }
+    }
+    check(same, "exact results");
+    check(sorted, "nearest first");
+
+    // 2. Erase, move and filter
+    Vector far;
+    far.fill(9.0f);
+    index.insert(7, far);
+    check(index.size() == 2000, "insert of a present key moves it");
+    check(index.nearest(far, 1)[0].key == 7 &&
+              index.nearest(far, 1)[0].distance == 0.0f,
+          "moved point found");
+    check(index.erase(7) && !index.erase(7), "erase once");
+    check(index.nearest(far, 1)[0].key != 7, "erased point gone");
+    auto even = index.nearest(random_vector(), 5,
+                              [](uint64_t key) { return key % 2 == 0; });
+    check(even.size() == 5 &&
+              std::all_of(even.begin(), even.end(),
+                          [](const SimilarityIndex::Match &m) {
+                            return m.key % 2 == 0;
+                          }),
+          "filter");
+    check(index.nearest(random_vector(), 0).empty(), "k = 0");
+  }
+
+  // 3. Past the limit: clustered data goes through IVF buckets with high
+  // recall, and back to exact when it shrinks
+  {
+    SimilarityIndex index(1000);
+    std::vector<Vector> centers(64);
+    for (auto &c : centers)
+      c = random_vector();
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    std::vector<std::pair<uint64_t, Vector>> points;
+    for (uint64_t key = 1; key <= 40000; ++key) {
+      Vector v = centers[rng() % centers.size()];
+      for (auto &x : v)
+        x += noise(rng);
+      points.push_back({key, v});
+      index.insert(key, v);
+    }
+    check(!index.approximate() && index.training_due(),
+          "inserts leave training to the owner");
+    index.retrain();
+    check(index.approximate() && !index.training_due(), "IVF above limit");
+
+    size_t hits = 0, total = 0;
+    const int queries = 200;
+    for (int q = 0; q < queries; ++q) {
+      Vector query = points[rng() % points.size()].second;
+      for (auto &x : query)
+        x += noise(rng);
+      auto matches = index.nearest(query, 10);
+      auto expected = brute_force(points, query, 10);
+      std::set<uint64_t> truth(expected.begin(), expected.end());
+      for (const auto &m : matches)
+        hits += truth.count(m.key);
+      total += expected.size();
+    }
+    double recall = (double)hits / (double)total;
+    check(recall >= 0.9, "IVF recall@10 >= 0.9");
+
+    // Timed separately from the brute-force reference
+    auto start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q)
+      index.nearest(points[q].second, 10);
+    double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start)
+                    .count() /
+                queries;
+    std::cout << "IVF over " << index.size() << " points: recall@10 "
+              << recall << ", " << us << " us per query" << std::endl;
+    check(us < 1000.0, "IVF query under a millisecond");
+
+    for (uint64_t key = 1; key <= 39800; ++key)
+      index.erase(key);
+    check(index.training_due(), "due when shrunk");
+    index.retrain();
+    check(!index.approximate() && index.size() == 200, "exact again");
+    points.erase(points.begin(), points.begin() + 39800);
+    Vector query = random_vector();
+    auto matches = index.nearest(query, 3);
+    auto expected = brute_force(points, query, 3);
+    check(matches.size() == 3 && matches[0].key == expected[0] &&
+              matches[2].key == expected[2],
+          "exact after shrinking");
+  }
+
+  // 4. Changes made while a training runs are carried over to its result
+  {
+    SimilarityIndex index(500);
+    for (uint64_t key = 1; key <= 1000; ++key)
+      index.insert(key, random_vector());
+    SimilarityIndex::Snapshot snapshot = index.snapshot();
+    Vector far;
+    far.fill(9.0f);
+    index.insert(2000, far);
+    index.insert(5, far); // Moved
+    index.erase(6);
+    SimilarityIndex trained = SimilarityIndex::train(snapshot);
+    index.adopt(trained);
+    check(index.approximate() && index.size() == 1000 &&
+              trained.size() == 1000 && !trained.approximate(),
+          "trained index adopted, old one handed back");
+    auto matches = index.nearest(far, 3);
+    check(matches.size() == 3 && matches[0].distance == 0.0f &&
+              matches[1].distance == 0.0f && matches[2].distance > 0.0f,
+          "insert and move replayed");
+    check(!index.erase(6), "erase replayed");
+  }
+
+  if (failures) {
+    std::cerr << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Test Passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (size_t i = 0; i < threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  for (size_t i = 0; i < threads; ++i)
+    threads_.emplace_back([this, i] { worker_loop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+WorkStealingPool &WorkStealingPool::shared() {
+  static WorkStealingPool pool;
+  return pool;
+}
+
+void WorkStealingPool::parallel_for(size_t count,
+                                    const std::function<void(size_t)> &body) {
+  if (count == 0)
+    return;
+
+  // About eight chunks per worker: enough slack for stealing to even out
+  // slow items without paying a queue operation per index.
+  size_t workers = queues_.size();
+  size_t chunk = std::max<size_t>(1, count / (workers * 8));
+  size_t chunks = (count + chunk - 1) / chunk;
+
+  auto job = std::make_shared<Job>();
+  job->body = &body;
+  job->remaining = chunks;
+
+  // Counted before the pushes so a fast worker never takes queued_ below 0
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    queued_ += chunks;
+  }
+  for (size_t c = 0; c < chunks; ++c) {
+    size_t begin = c * chunk;
+    Queue &queue = *queues_[c % workers];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back({job, begin, std::min(count, begin + chunk)});
+  }
+  wake_.notify_all();
+
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->done.wait(lock, [&] { return job->remaining == 0; });
+  if (job->error)
+    std::rethrow_exception(job->error);
+}
+
+bool WorkStealingPool::pop_local(size_t self, Task &task) {
+  Queue &queue = *queues_[self];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty())
+    return false;
+  task = std::move(queue.tasks.front());
+  queue.tasks.pop_front();
+  --queued_;
+  return true;
+}
+
+bool WorkStealingPool::steal(size_t self, Task &task) {
+  for (size_t k = 1; k < queues_.size(); ++k) {
+    Queue &victim = *queues_[(self + k) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty())
+      continue;
+    task = std::move(victim.tasks.back());
+    victim.tasks.pop_back();
+    --queued_;
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingPool::run(Task &task) {
+  Job &job = *task.job;
+  for (size_t i = task.begin; i < task.end; ++i) {
+    try {
+      (*job.body)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      if (!job.error)
+        job.error = std::current_exception();
+    }
+  }
+
+  if (--job.remaining == 0) {
+    // Notify under the lock so the waiting caller cannot miss the wakeup
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.done.notify_all();
+  }
+}
+
+void WorkStealingPool::worker_loop(size_t self) {
+  while (true) {
+    Task task;
+    if (pop_local(self, task) || steal(self, task)) {
+      run(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each. parallel_for splits
+// an index range into chunks spread over the deques; a worker takes chunks
+// from the front of its own deque and, once that is empty, steals from the
+// back of the others, so uneven tickers (long histories, slow models) do
+// not leave cores idle. Several callers may run parallel_for concurrently.
+class WorkStealingPool {
+public:
+  // threads = 0 uses std::thread::hardware_concurrency()
+  explicit WorkStealingPool(size_t threads = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  // Runs body(i) for every i in [0, count) and blocks until all are done.
+  // If a call throws, the remaining indices still run and the first
+  // exception is rethrown here.
+  void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+  size_t size() const { return threads_.size(); }
+
+  // Process-wide pool sized to the machine, created on first use
+  static WorkStealingPool &shared();
+
+private:
+  struct Job {
+    const std::function<void(size_t)> *body;
+    std::atomic<size_t> remaining{0}; // Chunks not yet finished
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+
+  struct Task {
+    std::shared_ptr<Job> job;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> queued_{0}; // Tasks sitting in any queue
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+
+  void worker_loop(size_t self);
+  bool pop_local(size_t self, Task &task);
+  bool steal(size_t self, Task &task);
+  void run(Task &task);
+};